@@ -1,5 +1,9 @@
 #ifndef BUFFER_GROMETRY
 #define BUFFER_GROMETRY
+#include <tool/gl_state.h>
+#include <tool/mesh_optimizer.h>
+#include <geometry/GeometryView.h>
+
 #include <glm/glm.hpp>
 #include <glm/gtx/euler_angles.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -8,12 +12,14 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <utility>
 
 using namespace std;
 
 const float PI = glm::pi<float>();
 
-// mesh.h中也定义此属性
+// mesh.h中也定义此属性，先包含 mesh.h 时使用其中的定义
+#ifndef MESH_H
 struct Vertex
 {
   glm::vec3 Position;  // 顶点位置
@@ -23,13 +29,61 @@ struct Vertex
   glm::vec3 Tangent;   // 切线
   glm::vec3 Bitangent; // 副切线
 };
+#endif
 
+// 持有 VAO/VBO/EBO，只能移动不能复制，析构时释放 GL 对象
+// 绘制时按引用传递，或者转换为 GeometryView
 class BufferGeometry
 {
 public:
   vector<Vertex> vertices;
   vector<unsigned int> indices;
-  unsigned int VAO;
+  unsigned int VAO = 0;
+
+  // 上传时记录，按保留策略释放 vertices/indices 之后仍然可用
+  GLsizei indexCount = 0;
+  GLsizei vertexCount = 0;
+  GLenum indexType = GL_UNSIGNED_INT; // 上传时按顶点数量选择，绘制时传给 glDrawElements
+  Bounds bounds;
+  vector<glm::vec3> positions; // RETAIN_POSITIONS 时保留的顶点位置
+
+  // 之后创建的几何体上传后采用的保留策略，单个几何体可以再调用 retain()
+  static inline CpuRetention defaultRetention = RETAIN_ALL;
+  // 上传前按顶点缓存重排三角形、按首次使用重排顶点（MeshOptimizer）。默认关闭：重排之后 vertices[i] 不再对应第 i 行/列，
+  // 按原始索引顺序绘制的 GL_POINTS/GL_LINE_LOOP 也会乱掉，只在绘制三角形的大网格前打开（模型见 Model::meshOptimization）
+  static inline bool optimizeIndices = false;
+
+  BufferGeometry() = default;
+  BufferGeometry(const BufferGeometry &) = delete;
+  BufferGeometry &operator=(const BufferGeometry &) = delete;
+  BufferGeometry(BufferGeometry &&other) noexcept
+  {
+    *this = std::move(other);
+  }
+  BufferGeometry &operator=(BufferGeometry &&other) noexcept
+  {
+    if (this != &other)
+    {
+      dispose();
+      vertices = std::move(other.vertices);
+      indices = std::move(other.indices);
+      positions = std::move(other.positions);
+      indexCount = other.indexCount;
+      vertexCount = other.vertexCount;
+      indexType = other.indexType;
+      bounds = other.bounds;
+      VAO = other.VAO;
+      VBO = other.VBO;
+      EBO = other.EBO;
+      other.VAO = other.VBO = other.EBO = 0;
+    }
+    return *this;
+  }
+  ~BufferGeometry()
+  {
+    if (GLState::contextCurrent())
+      dispose();
+  }
 
   void logParameters()
   {
@@ -48,28 +102,65 @@ public:
   {
   }
 
+  // 释放上传后不再需要的内存数据
+  void retain(CpuRetention retention)
+  {
+    if (retention == RETAIN_ALL)
+      return;
+    if (retention == RETAIN_POSITIONS)
+    {
+      positions.resize(vertices.size());
+      for (size_t i = 0; i < vertices.size(); i++)
+        positions[i] = vertices[i].Position;
+    }
+    else
+      vector<unsigned int>().swap(indices);
+    vector<Vertex>().swap(vertices);
+  }
+
+  // 常驻内存的字节数
+  size_t cpuBytes() const
+  {
+    return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int) + positions.capacity() * sizeof(glm::vec3);
+  }
+  // 显存中顶点、索引缓冲的字节数
+  size_t gpuBytes() const
+  {
+    return (size_t)vertexCount * sizeof(Vertex) + (size_t)indexCount * indexSize(indexType);
+  }
+
+  // 释放 GL 对象，可以重复调用
   void dispose()
   {
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    if (VAO == 0 && VBO == 0 && EBO == 0)
+      return;
+    // 删除缓冲就够了；不解绑 GL_ELEMENT_ARRAY_BUFFER，GLState 开启时它会改动仍然绑定着的其他 VAO
+    GLState::forgetVertexArray(VAO);
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
+    VAO = VBO = EBO = 0;
   }
 
 private:
   glm::mat4 matrix = glm::mat4(1.0f);
 
 protected:
-  unsigned int VBO, EBO;
+  unsigned int VBO = 0, EBO = 0;
 
   void setupBuffers()
   {
+    if (optimizeIndices && !indices.empty())
+    {
+      MeshOptimizer::optimizeVertexCache(indices.data(), indices.size(), vertices.size());
+      MeshOptimizer::optimizeVertexFetch(vertices, indices.data(), indices.size());
+    }
+
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
 
-    glBindVertexArray(VAO);
+    GLState::bindVertexArray(VAO);
 
     // vertex attribute
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
@@ -77,7 +168,8 @@ protected:
 
     // indixes
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+    indexType = indexTypeFor(vertices.size());
+    uploadIndices(indices.data(), indices.size(), indexType);
 
     // 设置顶点属性指针
     // Position
@@ -93,7 +185,12 @@ protected:
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, TexCoords));
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GLState::bindVertexArray(0);
+
+    indexCount = (GLsizei)indices.size();
+    vertexCount = (GLsizei)vertices.size();
+    bounds = Bounds::of(vertices);
+    retain(defaultRetention);
   }
 };
 #endif
@@ -0,0 +1,121 @@
+#ifndef GEOMETRY_VIEW
+#define GEOMETRY_VIEW
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstddef>
+
+// 顶点、索引上传到 GPU 之后，内存中还保留哪些数据
+enum CpuRetention
+{
+  RETAIN_ALL,       // 全部保留（默认）
+  RETAIN_POSITIONS, // 只保留位置和索引，用于拾取、剔除
+  RETAIN_NONE       // 上传后全部释放
+};
+
+// 轴对齐包围盒，上传时计算，释放顶点后仍然可用
+struct Bounds
+{
+  glm::vec3 min = glm::vec3(0.0f);
+  glm::vec3 max = glm::vec3(0.0f);
+
+  glm::vec3 center() const { return (min + max) * 0.5f; }
+  glm::vec3 extent() const { return (max - min) * 0.5f; }
+
+  template <typename VertexType>
+  static Bounds of(const VertexType *vertices, size_t count)
+  {
+    Bounds bounds;
+    if (count == 0)
+      return bounds;
+    bounds.min = bounds.max = vertices[0].Position;
+    for (size_t i = 1; i < count; i++)
+    {
+      bounds.min = glm::min(bounds.min, vertices[i].Position);
+      bounds.max = glm::max(bounds.max, vertices[i].Position);
+    }
+    return bounds;
+  }
+  template <typename VertexType>
+  static Bounds of(const std::vector<VertexType> &vertices)
+  {
+    return of(vertices.data(), vertices.size());
+  }
+};
+
+// 索引缓冲的类型：顶点不超过 65536 个时用 16 位索引，索引占用的显存和读取的带宽减半
+inline GLenum indexTypeFor(size_t vertexCount)
+{
+  return vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+inline size_t indexSize(GLenum indexType)
+{
+  return indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+}
+// 按 indexType 把索引写入当前绑定的 GL_ELEMENT_ARRAY_BUFFER，内存中的索引总是 unsigned int
+inline void uploadIndices(const unsigned int *indices, size_t count, GLenum indexType, GLenum usage = GL_STATIC_DRAW)
+{
+  if (indexType == GL_UNSIGNED_INT)
+  {
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(GLuint), indices, usage);
+    return;
+  }
+  std::vector<GLushort> narrow(count);
+  for (size_t i = 0; i < count; i++)
+    narrow[i] = (GLushort)indices[i];
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(GLushort), narrow.data(), usage);
+}
+
+// 不持有 GL 对象的绘制视图，记录 VAO、索引范围和类型，可以按值传递
+// BufferGeometry、Mesh 都可以隐式转换为 GeometryView；GeometryArena 中的 Mesh 共用 arena 的 VAO，
+// 转换时带上它在 arena 中的 firstIndex()/baseVertex()，绘制时用 glDrawElementsBaseVertex
+struct GeometryView
+{
+  unsigned int VAO;
+  GLsizei count;       // 索引数量
+  GLenum indexType;    // GL_UNSIGNED_SHORT 或 GL_UNSIGNED_INT，绘制时传给 glDrawElements
+  GLuint firstIndex;   // 第一个索引在元素缓冲中的位置（以 indexType 为单位）
+  GLint baseVertex;    // 加到每个索引上的值
+
+  GeometryView(unsigned int VAO, GLsizei count, GLenum indexType = GL_UNSIGNED_INT, GLuint firstIndex = 0, GLint baseVertex = 0)
+      : VAO(VAO), count(count), indexType(indexType), firstIndex(firstIndex), baseVertex(baseVertex) {}
+
+  template <typename Geometry>
+  GeometryView(const Geometry &geometry)
+      : VAO(geometry.VAO), count(geometry.indexCount), indexType(geometry.indexType), firstIndex(firstIndexOf(geometry, 0)), baseVertex(baseVertexOf(geometry, 0))
+  {
+  }
+
+  // glDrawElements 的 indices 参数：第一个索引的字节偏移
+  const void *indexOffset() const
+  {
+    return (const void *)((size_t)firstIndex * indexSize(indexType));
+  }
+
+private:
+  // 有 firstIndex()/baseVertex() 的类型（Mesh）取它们的值，其他类型（BufferGeometry）从 0 开始
+  template <typename Geometry>
+  static auto firstIndexOf(const Geometry &geometry, int) -> decltype((GLuint)geometry.firstIndex())
+  {
+    return geometry.firstIndex();
+  }
+  template <typename Geometry>
+  static GLuint firstIndexOf(const Geometry &, long)
+  {
+    return 0;
+  }
+  template <typename Geometry>
+  static auto baseVertexOf(const Geometry &geometry, int) -> decltype((GLint)geometry.baseVertex())
+  {
+    return geometry.baseVertex();
+  }
+  template <typename Geometry>
+  static GLint baseVertexOf(const Geometry &, long)
+  {
+    return 0;
+  }
+};
+
+#endif
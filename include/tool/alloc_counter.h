@@ -0,0 +1,57 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <atomic>
+#include <cstddef>
+
+// Counts heap allocations made through operator new, to check that a render loop does not allocate.
+// Replacing operator new has to happen in exactly one translation unit: define ALLOC_COUNTER_IMPLEMENTATION
+// before including this file in main.cpp, like STB_IMAGE_IMPLEMENTATION.
+struct AllocCounter
+{
+    static inline std::atomic<unsigned long> allocations{0};
+    static inline std::atomic<unsigned long long> bytes{0};
+
+    static void reset()
+    {
+        allocations = 0;
+        bytes = 0;
+    }
+};
+
+#ifdef ALLOC_COUNTER_IMPLEMENTATION
+#include <cstdlib>
+#include <new>
+
+void *operator new(std::size_t size)
+{
+    AllocCounter::allocations.fetch_add(1, std::memory_order_relaxed);
+    AllocCounter::bytes.fetch_add(size, std::memory_order_relaxed);
+    void *pointer = std::malloc(size != 0 ? size : 1);
+    if (pointer == nullptr)
+        throw std::bad_alloc();
+    return pointer;
+}
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+void operator delete[](void *pointer) noexcept
+{
+    std::free(pointer);
+}
+void operator delete(void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+void operator delete[](void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+#endif
+
+#endif
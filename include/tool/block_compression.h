@@ -0,0 +1,444 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <tool/thread_pool.h>
+
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+
+// GPU block compression formats, every 4x4 pixel block is stored in a fixed number of bytes
+enum BlockFormat
+{
+    BLOCK_BC1, // rgb, 8 bytes: two 565 colors and 2 bit indices. albedo without alpha
+    BLOCK_BC3, // rgba, 16 bytes: a BC4 alpha block followed by a BC1 color block
+    BLOCK_BC4, // r, 8 bytes: two 8 bit values and 3 bit indices. single channel maps
+    BLOCK_BC5, // rg, 16 bytes: two BC4 blocks. normal maps, z is rebuilt in the shader
+    BLOCK_BC7, // rgba, 16 bytes: encoded in mode 6 only (one subset, 7777+p endpoints, 4 bit indices)
+    BLOCK_RGBA8 // not compressed, plain RGBA8 texels: mip chains stored by ImageLoader
+};
+
+// CPU encoder for the block formats above, no GL involved: runs in offline tools and on ThreadPool workers.
+// Endpoints are picked along the principal axis of the block's colors and refined once by least squares,
+// which is far from what production encoders reach but already close to the source for photographic maps.
+// Input is always RGBA8; channels a format does not store are ignored.
+class BlockEncoder
+{
+public:
+    static size_t blockBytes(BlockFormat format)
+    {
+        return format == BLOCK_BC1 || format == BLOCK_BC4 ? 8 : 16;
+    }
+    static size_t encodedSize(BlockFormat format, int width, int height)
+    {
+        if (format == BLOCK_RGBA8)
+            return (size_t)width * height * 4;
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+    }
+
+    // the blocks of a whole image row by row, blocks over the edge repeat the last row/column
+    // ------------------------------------------------------------------------
+    static std::vector<unsigned char> encode(BlockFormat format, const unsigned char *rgba, int width, int height, ThreadPool *pool = nullptr)
+    {
+        if (format == BLOCK_RGBA8)
+            return std::vector<unsigned char>(rgba, rgba + encodedSize(format, width, height));
+        int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+        size_t bytes = blockBytes(format);
+        std::vector<unsigned char> encoded(encodedSize(format, width, height));
+        std::function<void(size_t)> encodeRow = [&](size_t row) {
+            unsigned char block[16 * 4];
+            for (int bx = 0; bx < blocksX; bx++)
+            {
+                for (int y = 0; y < 4; y++)
+                    for (int x = 0; x < 4; x++)
+                    {
+                        int sx = std::min(bx * 4 + x, width - 1), sy = std::min((int)row * 4 + y, height - 1);
+                        memcpy(&block[(y * 4 + x) * 4], &rgba[((size_t)sy * width + sx) * 4], 4);
+                    }
+                encodeBlock(format, block, &encoded[(row * blocksX + bx) * bytes]);
+            }
+        };
+        if (pool != nullptr)
+            pool->parallelFor(blocksY, encodeRow);
+        else
+            for (int row = 0; row < blocksY; row++)
+                encodeRow(row);
+        return encoded;
+    }
+
+    // block: 16 RGBA8 pixels in row order
+    static void encodeBlock(BlockFormat format, const unsigned char *block, unsigned char *out)
+    {
+        unsigned char channel[16];
+        switch (format)
+        {
+        case BLOCK_BC1:
+            encodeColor(block, out);
+            break;
+        case BLOCK_BC3:
+            gather(block, 3, channel);
+            encodeChannel(channel, out);
+            encodeColor(block, out + 8);
+            break;
+        case BLOCK_BC4:
+            gather(block, 0, channel);
+            encodeChannel(channel, out);
+            break;
+        case BLOCK_BC5:
+            gather(block, 0, channel);
+            encodeChannel(channel, out);
+            gather(block, 1, channel);
+            encodeChannel(channel, out + 8);
+            break;
+        case BLOCK_BC7:
+            encodeMode6(block, out);
+            break;
+        case BLOCK_RGBA8:
+            // has no blocks, encode() copies the image
+            break;
+        }
+    }
+
+private:
+    static void gather(const unsigned char *block, int c, unsigned char *channel)
+    {
+        for (int i = 0; i < 16; i++)
+            channel[i] = block[i * 4 + c];
+    }
+
+    // endpoints: the extremes of the points projected on their principal axis
+    template <int N>
+    static void principalEndpoints(const float (*points)[N], float *low, float *high)
+    {
+        float mean[N] = {};
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < N; c++)
+                mean[c] += points[i][c] / 16.0f;
+        float covariance[N][N] = {};
+        for (int i = 0; i < 16; i++)
+            for (int a = 0; a < N; a++)
+                for (int b = 0; b < N; b++)
+                    covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+        // power iteration, a handful of steps is enough for the dominant axis. it starts from the channel that varies
+        // most: a start like (1,1,1) has no component along blocks that vary across it (a red/green checker) and
+        // would converge to nothing
+        float axis[N];
+        int widest = 0;
+        for (int c = 1; c < N; c++)
+            if (covariance[c][c] > covariance[widest][widest])
+                widest = c;
+        for (int c = 0; c < N; c++)
+            axis[c] = c == widest ? 1.0f : 0.0f;
+        for (int step = 0; step < 8; step++)
+        {
+            float next[N] = {};
+            for (int a = 0; a < N; a++)
+                for (int b = 0; b < N; b++)
+                    next[a] += covariance[a][b] * axis[b];
+            float length = 0.0f;
+            for (int c = 0; c < N; c++)
+                length = std::max(length, std::fabs(next[c]));
+            if (length < 1e-8f)
+                break;
+            for (int c = 0; c < N; c++)
+                axis[c] = next[c] / length;
+        }
+        float length = 0.0f;
+        for (int c = 0; c < N; c++)
+            length += axis[c] * axis[c];
+        if (!(length > 1e-12f))
+        {
+            // degenerate, take the diagonal of the bounding box instead (zero for a flat block, both endpoints the mean)
+            length = 0.0f;
+            for (int c = 0; c < N; c++)
+            {
+                float minimum = points[0][c], maximum = points[0][c];
+                for (int i = 1; i < 16; i++)
+                {
+                    minimum = std::min(minimum, points[i][c]);
+                    maximum = std::max(maximum, points[i][c]);
+                }
+                axis[c] = maximum - minimum;
+                length += axis[c] * axis[c];
+            }
+        }
+        length = std::sqrt(length);
+        for (int c = 0; c < N; c++)
+            axis[c] = length > 0.0f ? axis[c] / length : 0.0f;
+
+        float minimum = 1e30f, maximum = -1e30f;
+        for (int i = 0; i < 16; i++)
+        {
+            float t = 0.0f;
+            for (int c = 0; c < N; c++)
+                t += (points[i][c] - mean[c]) * axis[c];
+            minimum = std::min(minimum, t);
+            maximum = std::max(maximum, t);
+        }
+        for (int c = 0; c < N; c++)
+        {
+            low[c] = mean[c] + axis[c] * minimum;
+            high[c] = mean[c] + axis[c] * maximum;
+        }
+    }
+
+    // least squares endpoints for fixed indices, weight[i] is how much of high point i takes
+    template <int N>
+    static bool refineEndpoints(const float (*points)[N], const float *weight, float *low, float *high)
+    {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[N] = {}, bx[N] = {};
+        for (int i = 0; i < 16; i++)
+        {
+            float b = weight[i], a = 1.0f - b;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int c = 0; c < N; c++)
+            {
+                ax[c] += a * points[i][c];
+                bx[c] += b * points[i][c];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) < 1e-6f)
+            return false;
+        for (int c = 0; c < N; c++)
+        {
+            low[c] = std::min(std::max((bb * ax[c] - ab * bx[c]) / determinant, 0.0f), 255.0f);
+            high[c] = std::min(std::max((aa * bx[c] - ab * ax[c]) / determinant, 0.0f), 255.0f);
+        }
+        return true;
+    }
+
+    // BC1 color block, always in 4 color mode
+    // ------------------------------------------------------------------------
+    static void encodeColor(const unsigned char *block, unsigned char *out)
+    {
+        float points[16][3];
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < 3; c++)
+                points[i][c] = block[i * 4 + c];
+        float low[3], high[3];
+        principalEndpoints<3>(points, low, high);
+
+        uint16_t best0 = 0, best1 = 0;
+        uint32_t bestIndices = 0;
+        float bestError = 1e30f;
+        for (int pass = 0; pass < 2; pass++)
+        {
+            uint16_t c0 = pack565(high), c1 = pack565(low);
+            uint32_t indices;
+            float error = colorIndices(points, c0, c1, indices);
+            if (error < bestError)
+            {
+                bestError = error;
+                best0 = c0;
+                best1 = c1;
+                bestIndices = indices;
+            }
+            // index i -> weight of c0: 0 -> 1, 1 -> 0, 2 -> 2/3, 3 -> 1/3
+            static const float weightOfHigh[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+            float weight[16];
+            for (int i = 0; i < 16; i++)
+                weight[i] = weightOfHigh[(indices >> (i * 2)) & 3];
+            if (!refineEndpoints<3>(points, weight, low, high))
+                break;
+        }
+
+        // c0 > c1 selects the 4 color mode, swapping the endpoints swaps index 0/1 and 2/3
+        if (best0 < best1)
+        {
+            std::swap(best0, best1);
+            bestIndices ^= 0x55555555;
+        }
+        else if (best0 == best1)
+            bestIndices = 0;
+        out[0] = best0 & 0xFF;
+        out[1] = best0 >> 8;
+        out[2] = best1 & 0xFF;
+        out[3] = best1 >> 8;
+        for (int i = 0; i < 4; i++)
+            out[4 + i] = (bestIndices >> (i * 8)) & 0xFF;
+    }
+
+    static uint16_t pack565(const float *color)
+    {
+        int r = (int)std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+        int g = (int)std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+        int b = (int)std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+        return (uint16_t)((r << 11) | (g << 5) | b);
+    }
+    static void unpack565(uint16_t packed, float *color)
+    {
+        int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = (float)((r << 3) | (r >> 2));
+        color[1] = (float)((g << 2) | (g >> 4));
+        color[2] = (float)((b << 3) | (b >> 2));
+    }
+
+    static float colorIndices(const float (*points)[3], uint16_t c0, uint16_t c1, uint32_t &indices)
+    {
+        float palette[4][3];
+        unpack565(c0, palette[0]);
+        unpack565(c1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+        indices = 0;
+        float total = 0.0f;
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0;
+            float bestError = 1e30f;
+            for (int p = 0; p < 4; p++)
+            {
+                float error = 0.0f;
+                for (int c = 0; c < 3; c++)
+                    error += (points[i][c] - palette[p][c]) * (points[i][c] - palette[p][c]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (i * 2);
+            total += bestError;
+        }
+        return total;
+    }
+
+    // BC4 block, 8 value mode (first endpoint greater)
+    // ------------------------------------------------------------------------
+    static void encodeChannel(const unsigned char *values, unsigned char *out)
+    {
+        unsigned char high = *std::max_element(values, values + 16);
+        unsigned char low = *std::min_element(values, values + 16);
+        out[0] = high;
+        out[1] = low;
+        uint64_t indices = 0;
+        if (high > low)
+        {
+            // palette: 0 -> high, 1 -> low, 2..7 -> (7-k)/7 high + k/7 low for k = 1..6
+            for (int i = 0; i < 16; i++)
+            {
+                int step = (int)std::lround((float)(high - values[i]) * 7.0f / (high - low));
+                int index = step == 0 ? 0 : (step == 7 ? 1 : step + 1);
+                indices |= (uint64_t)index << (i * 3);
+            }
+        }
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = (indices >> (i * 8)) & 0xFF;
+    }
+
+    // BC7 mode 6: 7 bit RGBA endpoints with one shared low bit each, 16 weights
+    // ------------------------------------------------------------------------
+    static void encodeMode6(const unsigned char *block, unsigned char *out)
+    {
+        static const int weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+        float points[16][4];
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < 4; c++)
+                points[i][c] = block[i * 4 + c];
+        float low[4], high[4];
+        principalEndpoints<4>(points, low, high);
+
+        int bestEndpoints[2][4] = {};
+        int bestIndices[16] = {};
+        float bestError = 1e30f;
+        for (int pass = 0; pass < 2; pass++)
+        {
+            int endpoints[2][4];
+            quantizeMode6(low, endpoints[0]);
+            quantizeMode6(high, endpoints[1]);
+            int indices[16];
+            float error = 0.0f;
+            for (int i = 0; i < 16; i++)
+            {
+                float pixelError = 1e30f;
+                for (int w = 0; w < 16; w++)
+                {
+                    float e = 0.0f;
+                    for (int c = 0; c < 4; c++)
+                    {
+                        float value = (float)(((64 - weights[w]) * endpoints[0][c] + weights[w] * endpoints[1][c] + 32) >> 6);
+                        e += (points[i][c] - value) * (points[i][c] - value);
+                    }
+                    if (e < pixelError)
+                    {
+                        pixelError = e;
+                        indices[i] = w;
+                    }
+                }
+                error += pixelError;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                memcpy(bestEndpoints, endpoints, sizeof(endpoints));
+                memcpy(bestIndices, indices, sizeof(indices));
+            }
+            float weight[16];
+            for (int i = 0; i < 16; i++)
+                weight[i] = weights[indices[i]] / 64.0f;
+            if (!refineEndpoints<4>(points, weight, low, high))
+                break;
+        }
+
+        // the top bit of the first index is implied 0
+        if (bestIndices[0] >= 8)
+        {
+            for (int c = 0; c < 4; c++)
+                std::swap(bestEndpoints[0][c], bestEndpoints[1][c]);
+            for (int i = 0; i < 16; i++)
+                bestIndices[i] = 15 - bestIndices[i];
+        }
+
+        memset(out, 0, 16);
+        int bit = 0;
+        writeBits(out, bit, 1 << 6, 7);
+        for (int c = 0; c < 4; c++)
+            for (int e = 0; e < 2; e++)
+                writeBits(out, bit, bestEndpoints[e][c] >> 1, 7);
+        writeBits(out, bit, bestEndpoints[0][0] & 1, 1);
+        writeBits(out, bit, bestEndpoints[1][0] & 1, 1);
+        for (int i = 0; i < 16; i++)
+            writeBits(out, bit, bestIndices[i], i == 0 ? 3 : 4);
+    }
+
+    // 8 bit endpoint values whose low bit (the p bit) is the same in all four channels
+    static void quantizeMode6(const float *color, int *endpoint)
+    {
+        float bestError = 1e30f;
+        for (int p = 0; p < 2; p++)
+        {
+            int candidate[4];
+            float error = 0.0f;
+            for (int c = 0; c < 4; c++)
+            {
+                int high = (int)std::lround((std::min(std::max(color[c], 0.0f), 255.0f) - p) / 2.0f);
+                candidate[c] = (std::min(std::max(high, 0), 127) << 1) | p;
+                error += (candidate[c] - color[c]) * (candidate[c] - color[c]);
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                memcpy(endpoint, candidate, sizeof(candidate));
+            }
+        }
+    }
+
+    static void writeBits(unsigned char *out, int &bit, int value, int count)
+    {
+        for (int i = 0; i < count; i++, bit++)
+            if ((value >> i) & 1)
+                out[bit >> 3] |= (unsigned char)(1 << (bit & 7));
+    }
+};
+
+#endif
@@ -5,6 +5,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <tool/frustum.h>
+
 #include <vector>
 
 // Defines several possible options for camera movement. Used as abstraction to stay away from window-system specific input methods
@@ -66,6 +68,24 @@ public:
 		return glm::lookAt(Position, Position + Front, Up);
 	}
 
+	// returns the perspective projection for the current zoom, like the samples build it
+	glm::mat4 GetProjectionMatrix(float aspect, float nearPlane = 0.1f, float farPlane = 100.0f)
+	{
+		return glm::perspective(glm::radians(Zoom), aspect, nearPlane, farPlane);
+	}
+
+	// returns the planes of the view volume, for culling what is not on screen (same projection as GetProjectionMatrix)
+	Frustum GetFrustum(float aspect, float nearPlane = 0.1f, float farPlane = 100.0f)
+	{
+		return Frustum::fromMatrix(GetProjectionMatrix(aspect, nearPlane, farPlane) * GetViewMatrix());
+	}
+
+	// returns how many pixels one unit covers at distance 1 on a screen of the given height, for picking levels of detail
+	float GetPixelScale(float screenHeight)
+	{
+		return screenHeight / (2.0f * tan(glm::radians(Zoom) * 0.5f));
+	}
+
 	// processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
 	void ProcessKeyboard(Camera_Movement direction, float deltaTime)
 	{
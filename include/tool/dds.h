@@ -0,0 +1,312 @@
+#ifndef DDS_H
+#define DDS_H
+
+#include <glad/glad.h>
+
+#include <tool/block_compression.h>
+#include <tool/mapped_file.h>
+#include <tool/gl_state.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+
+// S3TC is an extension (GL_EXT_texture_compression_s3tc), the glad loader only has the core enums
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// DirectDraw Surface container for block compressed textures with their mip chain. Files are written with the
+// DX10 extension header (needed for BC7), the legacy DXT1/DXT5/ATI1/ATI2 codes are read as well.
+//   DdsFile::save()    write the levels produced by BlockEncoder, level 0 first
+//   DdsFile::open()    map a file, levels point into the mapping
+//   DdsFile::upload()  create a GL texture from the levels with glCompressedTexImage2D
+// The color space is not taken from the file: upload() stores sRGB formats when asked for gamma, like TextureFromFile.
+class DdsFile
+{
+public:
+    struct Level
+    {
+        int width = 0;
+        int height = 0;
+        const unsigned char *data = nullptr;
+        size_t size = 0;
+    };
+
+    BlockFormat format = BLOCK_BC1;
+    int width = 0;
+    int height = 0;
+    std::vector<Level> levels;
+
+    // false when the file is missing, not a DDS or holds a format other than BC1/3/4/5/7 or RGBA8
+    // ------------------------------------------------------------------------
+    bool open(const std::string &path)
+    {
+        levels.clear();
+        if (!file.open(path))
+            return false;
+        if (file.size() < 4 + sizeof(Header) || memcmp(file.data(), "DDS ", 4) != 0)
+            return reject();
+        Header header;
+        memcpy(&header, file.data() + 4, sizeof(header));
+        size_t offset = 4 + sizeof(Header);
+        uint32_t fourCC = header.pixelFormat.fourCC;
+        if (fourCC == code("DX10"))
+        {
+            if (file.size() < offset + sizeof(HeaderDX10))
+                return reject();
+            HeaderDX10 extension;
+            memcpy(&extension, file.data() + offset, sizeof(extension));
+            offset += sizeof(HeaderDX10);
+            if (!fromDxgi(extension.dxgiFormat, format))
+                return reject();
+        }
+        else if (fourCC == code("DXT1"))
+            format = BLOCK_BC1;
+        else if (fourCC == code("DXT5"))
+            format = BLOCK_BC3;
+        else if (fourCC == code("ATI1") || fourCC == code("BC4U"))
+            format = BLOCK_BC4;
+        else if (fourCC == code("ATI2") || fourCC == code("BC5U"))
+            format = BLOCK_BC5;
+        else
+            return reject();
+
+        width = (int)header.width;
+        height = (int)header.height;
+        int count = header.mipMapCount > 0 ? (int)header.mipMapCount : 1;
+        int levelWidth = width, levelHeight = height;
+        for (int i = 0; i < count; i++)
+        {
+            Level level;
+            level.width = levelWidth;
+            level.height = levelHeight;
+            level.size = BlockEncoder::encodedSize(format, levelWidth, levelHeight);
+            if (offset + level.size > file.size())
+                return reject();
+            level.data = file.data() + offset;
+            offset += level.size;
+            levels.push_back(level);
+            levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+            levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+        }
+        return width > 0 && height > 0 ? true : reject();
+    }
+
+    // levels[0] is width x height, every following level half the size of the previous one
+    // ------------------------------------------------------------------------
+    static bool save(const std::string &path, BlockFormat format, int width, int height, const std::vector<std::vector<unsigned char>> &levels)
+    {
+        std::vector<Level> views;
+        for (const std::vector<unsigned char> &level : levels)
+        {
+            Level view;
+            view.data = level.data();
+            view.size = level.size();
+            views.push_back(view);
+        }
+        return save(path, format, width, height, views);
+    }
+    static bool save(const std::string &path, BlockFormat format, int width, int height, const std::vector<Level> &levels)
+    {
+        Header header;
+        memset(&header, 0, sizeof(header));
+        header.size = sizeof(Header);
+        header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // caps, height, width, pixel format, mip count, linear size
+        header.height = (uint32_t)height;
+        header.width = (uint32_t)width;
+        header.pitchOrLinearSize = levels.empty() ? 0 : (uint32_t)levels[0].size;
+        header.mipMapCount = (uint32_t)levels.size();
+        header.pixelFormat.size = sizeof(PixelFormat);
+        header.pixelFormat.flags = 0x4; // fourCC
+        header.pixelFormat.fourCC = code("DX10");
+        header.caps = 0x1000 | (levels.size() > 1 ? 0x400000 | 0x8 : 0); // texture, mipmap, complex
+        HeaderDX10 extension;
+        memset(&extension, 0, sizeof(extension));
+        extension.dxgiFormat = toDxgi(format);
+        extension.resourceDimension = 3; // texture 2D
+        extension.arraySize = 1;
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        out.write("DDS ", 4);
+        out.write((const char *)&header, sizeof(header));
+        out.write((const char *)&extension, sizeof(extension));
+        for (const Level &level : levels)
+            out.write((const char *)level.data, level.size);
+        return (bool)out;
+    }
+
+    // GL internal format of the blocks, 0 when the driver cannot sample it
+    static GLenum glFormat(BlockFormat format, bool gamma)
+    {
+        switch (format)
+        {
+        case BLOCK_BC1:
+            if (!hasS3tc())
+                return 0;
+            return gamma ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        case BLOCK_BC3:
+            if (!hasS3tc())
+                return 0;
+            return gamma ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BLOCK_BC4:
+            return GL_COMPRESSED_RED_RGTC1;
+        case BLOCK_BC5:
+            return GL_COMPRESSED_RG_RGTC2;
+        case BLOCK_BC7:
+            return gamma ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+        case BLOCK_RGBA8:
+            return gamma ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+        }
+        return 0;
+    }
+
+    // texture with every level of the file, 0 when the format is not supported by the driver
+    // ------------------------------------------------------------------------
+    GLuint upload(bool gamma = false, GLenum wrap = GL_REPEAT) const
+    {
+        GLenum internalFormat = glFormat(format, gamma);
+        if (internalFormat == 0 || levels.empty())
+            return 0;
+        GLuint texture;
+        glGenTextures(1, &texture);
+        GLState::bindTexture(0, GL_TEXTURE_2D, texture);
+        for (size_t i = 0; i < levels.size(); i++)
+            if (format == BLOCK_RGBA8)
+                glTexImage2D(GL_TEXTURE_2D, (GLint)i, internalFormat, levels[i].width, levels[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, levels[i].data);
+            else
+                glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, internalFormat, levels[i].width, levels[i].height, 0, (GLsizei)levels[i].size, levels[i].data);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return texture;
+    }
+
+    // bytes of all levels, what the texture takes in video memory
+    size_t dataSize() const
+    {
+        size_t bytes = 0;
+        for (const Level &level : levels)
+            bytes += level.size;
+        return bytes;
+    }
+
+    static bool hasS3tc()
+    {
+        static const bool supported = []() {
+            GLint count = 0;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+            for (GLint i = 0; i < count; i++)
+            {
+                const char *name = (const char *)glGetStringi(GL_EXTENSIONS, i);
+                if (name != nullptr && strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+                    return true;
+            }
+            return false;
+        }();
+        return supported;
+    }
+
+private:
+    struct PixelFormat
+    {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t fourCC;
+        uint32_t rgbBitCount;
+        uint32_t masks[4];
+    };
+    struct Header
+    {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t height;
+        uint32_t width;
+        uint32_t pitchOrLinearSize;
+        uint32_t depth;
+        uint32_t mipMapCount;
+        uint32_t reserved1[11];
+        PixelFormat pixelFormat;
+        uint32_t caps;
+        uint32_t caps2;
+        uint32_t caps3;
+        uint32_t caps4;
+        uint32_t reserved2;
+    };
+    struct HeaderDX10
+    {
+        uint32_t dxgiFormat;
+        uint32_t resourceDimension;
+        uint32_t miscFlag;
+        uint32_t arraySize;
+        uint32_t miscFlags2;
+    };
+
+    MappedFile file;
+
+    bool reject()
+    {
+        levels.clear();
+        file.close();
+        return false;
+    }
+
+    static uint32_t code(const char *fourCC)
+    {
+        return (uint32_t)fourCC[0] | ((uint32_t)fourCC[1] << 8) | ((uint32_t)fourCC[2] << 16) | ((uint32_t)fourCC[3] << 24);
+    }
+    // DXGI_FORMAT_BC*_UNORM and R8G8B8A8_UNORM, the _SRGB variants follow each of them
+    static uint32_t toDxgi(BlockFormat format)
+    {
+        static const uint32_t values[] = {71, 77, 80, 83, 98, 28};
+        return values[format];
+    }
+    static bool fromDxgi(uint32_t dxgi, BlockFormat &format)
+    {
+        switch (dxgi)
+        {
+        case 70: // typeless
+        case 71:
+        case 72:
+            format = BLOCK_BC1;
+            return true;
+        case 76:
+        case 77:
+        case 78:
+            format = BLOCK_BC3;
+            return true;
+        case 79:
+        case 80:
+            format = BLOCK_BC4;
+            return true;
+        case 82:
+        case 83:
+            format = BLOCK_BC5;
+            return true;
+        case 97:
+        case 98:
+        case 99:
+            format = BLOCK_BC7;
+            return true;
+        case 27:
+        case 28:
+        case 29:
+            format = BLOCK_RGBA8;
+            return true;
+        }
+        return false;
+    }
+};
+
+#endif
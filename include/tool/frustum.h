@@ -0,0 +1,231 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <geometry/GeometryView.h>
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_SSE
+#include <xmmintrin.h>
+#endif
+#if defined(__AVX__)
+#define FRUSTUM_AVX
+#include <immintrin.h>
+#endif
+
+// The six planes of a view frustum, taken from a projection * view matrix (Gribb/Hartmann).
+// Planes point inwards and are normalized: dot(plane.xyz, p) + plane.w is the signed distance of p, >= 0 inside.
+// A box is kept when it is not completely behind one of the planes, so a few boxes near the corners pass
+// although they are outside (conservative, never drops something visible).
+struct Frustum
+{
+    glm::vec4 planes[6]; // left, right, bottom, top, near, far
+
+    static Frustum fromMatrix(const glm::mat4 &viewProjection)
+    {
+        // rows of the matrix, glm stores columns
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++)
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        Frustum frustum;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            frustum.planes[axis * 2] = rows[3] + rows[axis];
+            frustum.planes[axis * 2 + 1] = rows[3] - rows[axis];
+        }
+        for (glm::vec4 &plane : frustum.planes)
+            plane /= glm::length(glm::vec3(plane));
+        return frustum;
+    }
+
+    // box in world space
+    bool intersects(const Bounds &bounds) const
+    {
+        glm::vec3 center = bounds.center(), extent = bounds.extent();
+        for (const glm::vec4 &plane : planes)
+        {
+            glm::vec3 normal(plane);
+            if (glm::dot(normal, center) + glm::dot(glm::abs(normal), extent) + plane.w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+    // box in the space of the model matrix
+    bool intersects(const Bounds &bounds, const glm::mat4 &model) const
+    {
+        return intersects(transform(bounds, model));
+    }
+
+    // world space box around a box moved by an affine matrix (Arvo)
+    static Bounds transform(const Bounds &bounds, const glm::mat4 &model)
+    {
+        glm::vec3 center = glm::vec3(model * glm::vec4(bounds.center(), 1.0f));
+        glm::vec3 extent = bounds.extent();
+        glm::vec3 worldExtent = glm::abs(glm::vec3(model[0])) * extent.x + glm::abs(glm::vec3(model[1])) * extent.y + glm::abs(glm::vec3(model[2])) * extent.z;
+        Bounds world;
+        world.min = center - worldExtent;
+        world.max = center + worldExtent;
+        return world;
+    }
+};
+
+// Many world space boxes stored as structure of arrays (centers and half extents per axis), culled 4 at a time
+// with SSE or 8 at a time with AVX when the build enables it (-mavx). Meant for large sets that barely change,
+// like the instances of a static field: fill once, cull every frame.
+//   add()/set()      store the box of object i
+//   cull()           indices of the boxes that intersect the frustum, in ascending order
+//   cullScalar()     the same one box at a time, as a reference
+class CullSet
+{
+public:
+    size_t size() const
+    {
+        return components[0].size();
+    }
+    void clear()
+    {
+        for (std::vector<float> &component : components)
+            component.clear();
+    }
+    void reserve(size_t count)
+    {
+        for (std::vector<float> &component : components)
+            component.reserve(count);
+    }
+    uint32_t add(const Bounds &bounds)
+    {
+        for (std::vector<float> &component : components)
+            component.push_back(0.0f);
+        set(size() - 1, bounds);
+        return (uint32_t)size() - 1;
+    }
+    void set(size_t index, const Bounds &bounds)
+    {
+        glm::vec3 center = bounds.center(), extent = bounds.extent();
+        for (int axis = 0; axis < 3; axis++)
+        {
+            components[axis][index] = center[axis];
+            components[3 + axis][index] = extent[axis];
+        }
+    }
+
+    // visible is resized to the number of boxes kept, which is returned
+    // ------------------------------------------------------------------------
+    size_t cull(const Frustum &frustum, std::vector<uint32_t> &visible) const
+    {
+        visible.resize(size());
+        uint32_t *out = visible.data();
+        size_t count = 0, i = 0;
+#ifdef FRUSTUM_SSE
+        const float *centerX = components[0].data(), *centerY = components[1].data(), *centerZ = components[2].data();
+        const float *extentX = components[3].data(), *extentY = components[4].data(), *extentZ = components[5].data();
+#endif
+#ifdef FRUSTUM_AVX
+        {
+            __m256 nx[6], ny[6], nz[6], ax[6], ay[6], az[6], w[6];
+            const __m256 sign = _mm256_set1_ps(-0.0f);
+            for (int p = 0; p < 6; p++)
+            {
+                nx[p] = _mm256_set1_ps(frustum.planes[p].x);
+                ny[p] = _mm256_set1_ps(frustum.planes[p].y);
+                nz[p] = _mm256_set1_ps(frustum.planes[p].z);
+                w[p] = _mm256_set1_ps(frustum.planes[p].w);
+                ax[p] = _mm256_andnot_ps(sign, nx[p]);
+                ay[p] = _mm256_andnot_ps(sign, ny[p]);
+                az[p] = _mm256_andnot_ps(sign, nz[p]);
+            }
+            const __m256 zero = _mm256_setzero_ps();
+            for (; i + 8 <= size(); i += 8)
+            {
+                __m256 cx = _mm256_loadu_ps(&centerX[i]), cy = _mm256_loadu_ps(&centerY[i]), cz = _mm256_loadu_ps(&centerZ[i]);
+                __m256 ex = _mm256_loadu_ps(&extentX[i]), ey = _mm256_loadu_ps(&extentY[i]), ez = _mm256_loadu_ps(&extentZ[i]);
+                int mask = 0xFF;
+                for (int p = 0; p < 6; p++)
+                {
+                    __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], cx), _mm256_mul_ps(ny[p], cy)), _mm256_add_ps(_mm256_mul_ps(nz[p], cz), w[p]));
+                    __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax[p], ex), _mm256_mul_ps(ay[p], ey)), _mm256_mul_ps(az[p], ez));
+                    mask &= _mm256_movemask_ps(_mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+                }
+                count = compact(mask, 8, (uint32_t)i, out, count);
+            }
+        }
+#endif
+#ifdef FRUSTUM_SSE
+        {
+            __m128 nx[6], ny[6], nz[6], ax[6], ay[6], az[6], w[6];
+            const __m128 sign = _mm_set1_ps(-0.0f);
+            for (int p = 0; p < 6; p++)
+            {
+                nx[p] = _mm_set1_ps(frustum.planes[p].x);
+                ny[p] = _mm_set1_ps(frustum.planes[p].y);
+                nz[p] = _mm_set1_ps(frustum.planes[p].z);
+                w[p] = _mm_set1_ps(frustum.planes[p].w);
+                ax[p] = _mm_andnot_ps(sign, nx[p]);
+                ay[p] = _mm_andnot_ps(sign, ny[p]);
+                az[p] = _mm_andnot_ps(sign, nz[p]);
+            }
+            const __m128 zero = _mm_setzero_ps();
+            for (; i + 4 <= size(); i += 4)
+            {
+                __m128 cx = _mm_loadu_ps(&centerX[i]), cy = _mm_loadu_ps(&centerY[i]), cz = _mm_loadu_ps(&centerZ[i]);
+                __m128 ex = _mm_loadu_ps(&extentX[i]), ey = _mm_loadu_ps(&extentY[i]), ez = _mm_loadu_ps(&extentZ[i]);
+                int mask = 0xF;
+                for (int p = 0; p < 6; p++)
+                {
+                    __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)), _mm_add_ps(_mm_mul_ps(nz[p], cz), w[p]));
+                    __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+                    mask &= _mm_movemask_ps(_mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+                }
+                count = compact(mask, 4, (uint32_t)i, out, count);
+            }
+        }
+#endif
+        for (; i < size(); i++)
+            if (inside(frustum, i))
+                out[count++] = (uint32_t)i;
+        visible.resize(count);
+        return count;
+    }
+    size_t cullScalar(const Frustum &frustum, std::vector<uint32_t> &visible) const
+    {
+        visible.clear();
+        for (size_t i = 0; i < size(); i++)
+            if (inside(frustum, i))
+                visible.push_back((uint32_t)i);
+        return visible.size();
+    }
+
+private:
+    // center x, y, z and half extent x, y, z
+    std::vector<float> components[6];
+
+    bool inside(const Frustum &frustum, size_t i) const
+    {
+        for (const glm::vec4 &plane : frustum.planes)
+        {
+            float distance = plane.x * components[0][i] + plane.y * components[1][i] + plane.z * components[2][i] + plane.w;
+            float radius = std::fabs(plane.x) * components[3][i] + std::fabs(plane.y) * components[4][i] + std::fabs(plane.z) * components[5][i];
+            if (distance + radius < 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+    // append the indices of the set bits without branching on them
+    static size_t compact(int mask, int lanes, uint32_t base, uint32_t *out, size_t count)
+    {
+        for (int lane = 0; lane < lanes; lane++)
+        {
+            out[count] = base + (uint32_t)lane;
+            count += (size_t)((mask >> lane) & 1);
+        }
+        return count;
+    }
+};
+
+#endif
@@ -0,0 +1,425 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <glad/glad.h>
+
+#include <geometry/GeometryView.h>
+
+#include <tool/gl_state.h>
+#include <tool/vertex_format.h>
+
+#include <map>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+// Vertex and index ranges of many meshes in one vertex buffer and one element buffer, all under one VAO.
+// Meshes of the same VertexFormat are sub-allocated from it and drawn with glDrawElementsBaseVertex, so switching
+// between them needs no VAO change and a queue or batch can draw them back to back.
+//   vertices  in whole vertices of format.stride() bytes, the offset of a range is its base vertex
+//   indices   in bytes padded to 4, every range picks its own index type (indexTypeFor its vertex count)
+// Free space is kept in first-fit free lists that merge neighbouring ranges. When a range does not fit, the arena
+// defragments if the free space would be enough, otherwise it grows the buffer to twice its size (copied on the GPU).
+// defragment() moves the live ranges to the front of the buffers, so all free space is one block at the end again.
+// Handles stay valid across both; the offsets are looked up through range() at draw time.
+// The arena has to outlive the meshes allocated from it.
+class GeometryArena
+{
+public:
+    typedef uint32_t Handle;
+    static const Handle INVALID_HANDLE = ~0u;
+
+    // where an allocation lies in the buffers, ready for glDrawElementsBaseVertex
+    struct Range
+    {
+        GLint baseVertex = 0;   // added to every index of the range
+        GLuint firstIndex = 0;  // in indices of indexType, the byte offset is firstIndex * indexSize(indexType)
+        GLsizei indexCount = 0;
+        GLsizei vertexCount = 0;
+        GLenum indexType = GL_UNSIGNED_INT;
+    };
+    struct Stats
+    {
+        size_t vertexBytes = 0; // in use
+        size_t vertexCapacity = 0;
+        size_t indexBytes = 0;
+        size_t indexCapacity = 0;
+        unsigned int allocations = 0;
+        unsigned int freeRanges = 0; // blocks in both free lists, 2 when nothing is fragmented
+        unsigned int growths = 0;
+        unsigned int defragmentations = 0;
+    };
+
+    // layout of every vertex in the arena, the shaders drawing it are compiled with format.defines()
+    const VertexFormat format;
+
+    // initial capacities in vertices and in 32 bit indices
+    GeometryArena(VertexFormat format = VertexFormat(), size_t vertexCapacity = 65536, size_t indexCapacity = 262144)
+        : format(format), stride(format.stride())
+    {
+        vertexBuffer = createBuffer(vertexCapacity * stride);
+        indexBuffer = createBuffer(indexCapacity * sizeof(GLuint));
+        vertexSpace.reset(vertexCapacity);
+        indexSpace.reset(indexCapacity * sizeof(GLuint));
+        this->vertexCapacity = vertexCapacity;
+        this->indexCapacity = indexCapacity * sizeof(GLuint);
+
+        glGenVertexArrays(1, &VAO);
+        bindBuffers();
+    }
+    GeometryArena(const GeometryArena &) = delete;
+    GeometryArena &operator=(const GeometryArena &) = delete;
+    ~GeometryArena()
+    {
+        if (!GLState::contextCurrent())
+            return;
+        GLState::forgetVertexArray(VAO);
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &vertexBuffer);
+        glDeleteBuffers(1, &indexBuffer);
+    }
+
+    // copy vertexCount vertices already encoded in the format (format.encode) and the indices into the arena.
+    // the indices count from 0 within the mesh, the base vertex of the range is added when drawing
+    // ------------------------------------------------------------------------
+    Handle allocate(const void *vertexData, GLsizei vertexCount, const unsigned int *indices, GLsizei indexCount)
+    {
+        Allocation allocation;
+        allocation.vertexCount = vertexCount;
+        allocation.indexCount = indexCount;
+        allocation.indexType = indexTypeFor(vertexCount);
+        size_t indexBytes = allocation.indexBytes();
+        if (!reserve(vertexCount, indexBytes, allocation.vertexOffset, allocation.indexOffset))
+            return INVALID_HANDLE;
+        allocation.live = true;
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.vertexOffset * stride, (size_t)vertexCount * stride, vertexData);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+        if (allocation.indexType == GL_UNSIGNED_INT)
+            glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.indexOffset, (size_t)indexCount * sizeof(GLuint), indices);
+        else
+        {
+            std::vector<GLushort> narrow(indices, indices + indexCount);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.indexOffset, (size_t)indexCount * sizeof(GLushort), narrow.data());
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        Handle handle;
+        if (!freeHandles.empty())
+        {
+            handle = freeHandles.back();
+            freeHandles.pop_back();
+            allocations[handle] = allocation;
+        }
+        else
+        {
+            handle = (Handle)allocations.size();
+            allocations.push_back(allocation);
+        }
+        usedVertices += vertexCount;
+        usedIndexBytes += indexBytes;
+        return handle;
+    }
+
+    // give the ranges back, the handle may be handed out again by a later allocate()
+    // ------------------------------------------------------------------------
+    void free(Handle handle)
+    {
+        if (handle >= allocations.size() || !allocations[handle].live)
+            return;
+        Allocation &allocation = allocations[handle];
+        size_t indexBytes = allocation.indexBytes();
+        vertexSpace.release(allocation.vertexOffset, allocation.vertexCount);
+        indexSpace.release(allocation.indexOffset, indexBytes);
+        usedVertices -= allocation.vertexCount;
+        usedIndexBytes -= indexBytes;
+        allocation.live = false;
+        freeHandles.push_back(handle);
+    }
+
+    Range range(Handle handle) const
+    {
+        Range range;
+        if (handle >= allocations.size() || !allocations[handle].live)
+            return range;
+        const Allocation &allocation = allocations[handle];
+        range.baseVertex = (GLint)allocation.vertexOffset;
+        range.firstIndex = (GLuint)(allocation.indexOffset / indexSize(allocation.indexType));
+        range.indexCount = allocation.indexCount;
+        range.vertexCount = allocation.vertexCount;
+        range.indexType = allocation.indexType;
+        return range;
+    }
+
+    // the VAO over both buffers, the same for every allocation and across growth
+    GLuint vertexArray() const
+    {
+        return VAO;
+    }
+
+    // move every live range to the front of new buffers, in the order they lie in the old ones
+    // ------------------------------------------------------------------------
+    void defragment()
+    {
+        std::vector<Allocation *> live;
+        for (Allocation &allocation : allocations)
+            if (allocation.live)
+                live.push_back(&allocation);
+
+        GLuint vertices = createBuffer(vertexCapacity * stride);
+        GLuint indices = createBuffer(indexCapacity);
+
+        std::sort(live.begin(), live.end(), [](const Allocation *a, const Allocation *b) { return a->vertexOffset < b->vertexOffset; });
+        glBindBuffer(GL_COPY_READ_BUFFER, vertexBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertices);
+        size_t vertexEnd = 0;
+        for (Allocation *allocation : live)
+        {
+            if (allocation->vertexCount > 0)
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, allocation->vertexOffset * stride, vertexEnd * stride,
+                                    (size_t)allocation->vertexCount * stride);
+            allocation->vertexOffset = vertexEnd;
+            vertexEnd += allocation->vertexCount;
+        }
+
+        std::sort(live.begin(), live.end(), [](const Allocation *a, const Allocation *b) { return a->indexOffset < b->indexOffset; });
+        glBindBuffer(GL_COPY_READ_BUFFER, indexBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, indices);
+        size_t indexEnd = 0;
+        for (Allocation *allocation : live)
+        {
+            size_t bytes = allocation->indexBytes();
+            if (bytes > 0)
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, allocation->indexOffset, indexEnd, bytes);
+            allocation->indexOffset = indexEnd;
+            indexEnd += bytes;
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        replaceBuffers(vertices, indices);
+        vertexSpace.reset(vertexCapacity);
+        vertexSpace.take(0, vertexEnd);
+        indexSpace.reset(indexCapacity);
+        indexSpace.take(0, indexEnd);
+        defragmentations++;
+    }
+
+    Stats stats() const
+    {
+        Stats stats;
+        stats.vertexBytes = usedVertices * stride;
+        stats.vertexCapacity = vertexCapacity * stride;
+        stats.indexBytes = usedIndexBytes;
+        stats.indexCapacity = indexCapacity;
+        stats.allocations = (unsigned int)(allocations.size() - freeHandles.size());
+        stats.freeRanges = (unsigned int)(vertexSpace.blockCount() + indexSpace.blockCount());
+        stats.growths = growths;
+        stats.defragmentations = defragmentations;
+        return stats;
+    }
+
+private:
+    // ranges of the element buffer are padded to 4 bytes, so 16 and 32 bit ranges both start aligned
+    static const size_t INDEX_ALIGNMENT = 4;
+
+    struct Allocation
+    {
+        size_t vertexOffset = 0; // in vertices
+        size_t indexOffset = 0;  // in bytes
+        GLsizei vertexCount = 0;
+        GLsizei indexCount = 0;
+        GLenum indexType = GL_UNSIGNED_INT;
+        bool live = false;
+
+        // padded to INDEX_ALIGNMENT
+        size_t indexBytes() const
+        {
+            return alignUp((size_t)indexCount * indexSize(indexType), INDEX_ALIGNMENT);
+        }
+    };
+
+    // free blocks by offset, neighbours are merged when a range comes back
+    class FreeList
+    {
+    public:
+        void reset(size_t capacity)
+        {
+            blocks.clear();
+            if (capacity > 0)
+                blocks[0] = capacity;
+        }
+        // the first block that holds size units
+        bool allocate(size_t size, size_t &offset)
+        {
+            for (const std::pair<const size_t, size_t> &block : blocks)
+                if (block.second >= size)
+                {
+                    offset = block.first;
+                    take(offset, size);
+                    return true;
+                }
+            return false;
+        }
+        // cut [offset, offset + size) out of the block containing it
+        void take(size_t offset, size_t size)
+        {
+            if (size == 0)
+                return;
+            std::map<size_t, size_t>::iterator block = blocks.upper_bound(offset);
+            --block;
+            size_t begin = block->first, end = block->first + block->second;
+            blocks.erase(block);
+            if (offset > begin)
+                blocks[begin] = offset - begin;
+            if (offset + size < end)
+                blocks[offset + size] = end - offset - size;
+        }
+        void release(size_t offset, size_t size)
+        {
+            if (size == 0)
+                return;
+            std::map<size_t, size_t>::iterator block = blocks.insert({offset, size}).first;
+            std::map<size_t, size_t>::iterator next = std::next(block);
+            if (next != blocks.end() && offset + block->second == next->first)
+            {
+                block->second += next->second;
+                blocks.erase(next);
+            }
+            if (block != blocks.begin())
+            {
+                std::map<size_t, size_t>::iterator previous = std::prev(block);
+                if (previous->first + previous->second == offset)
+                {
+                    previous->second += block->second;
+                    blocks.erase(block);
+                }
+            }
+        }
+        bool fits(size_t size) const
+        {
+            for (const std::pair<const size_t, size_t> &block : blocks)
+                if (block.second >= size)
+                    return true;
+            return false;
+        }
+        size_t total() const
+        {
+            size_t size = 0;
+            for (const std::pair<const size_t, size_t> &block : blocks)
+                size += block.second;
+            return size;
+        }
+        size_t blockCount() const
+        {
+            return blocks.size();
+        }
+
+    private:
+        std::map<size_t, size_t> blocks;
+    };
+
+    GLsizei stride;
+    GLuint VAO = 0, vertexBuffer = 0, indexBuffer = 0;
+    size_t vertexCapacity = 0, indexCapacity = 0; // in vertices / bytes
+    FreeList vertexSpace, indexSpace;
+    std::vector<Allocation> allocations;
+    std::vector<Handle> freeHandles;
+    size_t usedVertices = 0, usedIndexBytes = 0;
+    unsigned int growths = 0, defragmentations = 0;
+
+    static size_t alignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // find room for both ranges: defragment when the free space is enough but split up, grow when it is not
+    bool reserve(size_t vertexCount, size_t indexBytes, size_t &vertexOffset, size_t &indexOffset)
+    {
+        for (int attempt = 0; attempt < 3; attempt++)
+        {
+            if (vertexSpace.allocate(vertexCount, vertexOffset))
+            {
+                if (indexSpace.allocate(indexBytes, indexOffset))
+                    return true;
+                vertexSpace.release(vertexOffset, vertexCount);
+            }
+            bool fragmented = vertexSpace.total() >= vertexCount && indexSpace.total() >= indexBytes;
+            if (attempt == 0 && fragmented && vertexSpace.blockCount() + indexSpace.blockCount() > 2)
+                defragment();
+            else
+                grow(vertexCount, indexBytes);
+        }
+        return false;
+    }
+
+    // at least double the buffers that are too small, the used part is copied over on the GPU
+    void grow(size_t vertexCount, size_t indexBytes)
+    {
+        size_t vertices = vertexCapacity, indices = indexCapacity;
+        if (!vertexSpace.fits(vertexCount))
+            vertices = std::max(vertexCapacity * 2, vertexCapacity + vertexCount);
+        if (!indexSpace.fits(indexBytes))
+            indices = std::max(indexCapacity * 2, indexCapacity + indexBytes);
+
+        GLuint newVertices = vertexBuffer, newIndices = indexBuffer;
+        if (vertices != vertexCapacity)
+            newVertices = copyBuffer(vertexBuffer, vertexCapacity * stride, vertices * stride);
+        if (indices != indexCapacity)
+            newIndices = copyBuffer(indexBuffer, indexCapacity, indices);
+        replaceBuffers(newVertices, newIndices);
+        vertexSpace.release(vertexCapacity, vertices - vertexCapacity);
+        indexSpace.release(indexCapacity, indices - indexCapacity);
+        vertexCapacity = vertices;
+        indexCapacity = indices;
+        growths++;
+    }
+
+    static GLuint createBuffer(size_t bytes)
+    {
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        // bound to the copy target, GL_ELEMENT_ARRAY_BUFFER would change the element buffer of the bound VAO
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return buffer;
+    }
+
+    static GLuint copyBuffer(GLuint source, size_t bytes, size_t newBytes)
+    {
+        GLuint buffer = createBuffer(newBytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, source);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, bytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return buffer;
+    }
+
+    void replaceBuffers(GLuint vertices, GLuint indices)
+    {
+        if (vertices != vertexBuffer)
+            glDeleteBuffers(1, &vertexBuffer);
+        if (indices != indexBuffer)
+            glDeleteBuffers(1, &indexBuffer);
+        vertexBuffer = vertices;
+        indexBuffer = indices;
+        bindBuffers();
+    }
+
+    // point the attributes of the VAO at the vertex buffer and make the index buffer its element buffer
+    void bindBuffers()
+    {
+        GLState::bindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        format.setupAttributes();
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        GLState::bindVertexArray(0);
+    }
+};
+
+#endif
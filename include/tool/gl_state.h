@@ -0,0 +1,258 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+// Shadow copy of the GL bindings and fixed function state the samples change around every draw
+// (program, VAO, textures per unit, framebuffers, blend/depth/cull state).
+// When enabled, a call that would set the state to the value it already has is dropped.
+// Disabled by default: calls are always issued, so samples that still call GL directly keep working.
+// A sample that turns it on has to route its binds through GLState, or call invalidate() after direct GL calls.
+class GLState
+{
+public:
+    static const unsigned int MAX_TEXTURE_UNITS = 32;
+
+    static inline bool enabled = false;
+    // calls passed to the driver / dropped as redundant since the counters were last reset
+    static inline unsigned long issued = 0;
+    static inline unsigned long elided = 0;
+
+    static void resetCounters()
+    {
+        issued = 0;
+        elided = 0;
+    }
+    // GL objects may only be deleted while a context is current. the samples end main() with glfwTerminate(),
+    // so the destructors of their locals run after the context is gone and must skip the delete:
+    // call contextDestroyed() right before glfwTerminate(), contextCurrent() is false from then on.
+    static bool contextCurrent()
+    {
+        return contextAlive;
+    }
+    static void contextDestroyed()
+    {
+        contextAlive = false;
+        invalidate();
+    }
+    // forget everything, the next call of each kind is issued again
+    static void invalidate()
+    {
+        current = Shadow();
+    }
+
+    static void useProgram(GLuint program)
+    {
+        if (changed(current.program, program))
+            glUseProgram(program);
+    }
+    static void bindVertexArray(GLuint vao)
+    {
+        if (changed(current.vertexArray, vao))
+            glBindVertexArray(vao);
+    }
+    // the "leave VAO 0 bound after drawing" habit, only kept when state tracking is off
+    static void unbindVertexArray()
+    {
+        if (enabled)
+            elided++;
+        else
+            bindVertexArray(0);
+    }
+    static void activeTexture(GLenum unit)
+    {
+        if (changed(current.activeUnit, unit))
+            glActiveTexture(unit);
+    }
+    // the "switch back to GL_TEXTURE0 after drawing" habit, only kept when state tracking is off
+    static void resetActiveTexture()
+    {
+        if (enabled)
+            elided++;
+        else
+            activeTexture(GL_TEXTURE0);
+    }
+    // bind texture to a unit, the active unit only changes when the binding does
+    static void bindTexture(unsigned int unit, GLenum target, GLuint texture)
+    {
+        int slot = textureSlot(target);
+        if (slot >= 0 && unit < MAX_TEXTURE_UNITS)
+        {
+            if (!changed(current.textures[unit][slot], texture))
+                return;
+        }
+        else
+            issued++;
+        activeTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+    }
+    // GL_FRAMEBUFFER sets both the read and the draw framebuffer
+    static void bindFramebuffer(GLenum target, GLuint framebuffer)
+    {
+        if (target == GL_FRAMEBUFFER)
+        {
+            if (enabled && current.readFramebuffer == framebuffer && current.drawFramebuffer == framebuffer)
+            {
+                elided++;
+                return;
+            }
+            current.readFramebuffer = framebuffer;
+            current.drawFramebuffer = framebuffer;
+            issued++;
+            glBindFramebuffer(target, framebuffer);
+            return;
+        }
+        if (changed(target == GL_READ_FRAMEBUFFER ? current.readFramebuffer : current.drawFramebuffer, framebuffer))
+            glBindFramebuffer(target, framebuffer);
+    }
+
+    static void enable(GLenum capability)
+    {
+        setCapability(capability, true);
+    }
+    static void disable(GLenum capability)
+    {
+        setCapability(capability, false);
+    }
+    static void depthFunc(GLenum func)
+    {
+        if (changed(current.depthFunc, func))
+            glDepthFunc(func);
+    }
+    static void depthMask(GLboolean flag)
+    {
+        if (changed(current.depthMask, (GLenum)flag))
+            glDepthMask(flag);
+    }
+    static void cullFace(GLenum mode)
+    {
+        if (changed(current.cullFace, mode))
+            glCullFace(mode);
+    }
+    static void blendFunc(GLenum sfactor, GLenum dfactor)
+    {
+        if (enabled && current.blendSrc == sfactor && current.blendDst == dfactor)
+        {
+            elided++;
+            return;
+        }
+        current.blendSrc = sfactor;
+        current.blendDst = dfactor;
+        issued++;
+        glBlendFunc(sfactor, dfactor);
+    }
+
+    // names of deleted objects can be handed out again, so drop them from the shadow
+    // ------------------------------------------------------------------------
+    static void forgetProgram(GLuint program)
+    {
+        if (current.program == program)
+            current.program = UNKNOWN;
+    }
+    static void forgetVertexArray(GLuint vao)
+    {
+        if (current.vertexArray == vao)
+            current.vertexArray = UNKNOWN;
+    }
+    static void forgetTexture(GLuint texture)
+    {
+        for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+            for (GLuint &bound : current.textures[unit])
+                if (bound == texture)
+                    bound = UNKNOWN;
+    }
+
+private:
+    static const GLuint UNKNOWN = 0xFFFFFFFF;
+    static const int TEXTURE_TARGETS = 4;
+    static const int CAPABILITIES = 4;
+
+    struct Shadow
+    {
+        GLuint program = UNKNOWN;
+        GLuint vertexArray = UNKNOWN;
+        GLenum activeUnit = UNKNOWN;
+        GLuint textures[MAX_TEXTURE_UNITS][TEXTURE_TARGETS];
+        GLuint readFramebuffer = UNKNOWN;
+        GLuint drawFramebuffer = UNKNOWN;
+        GLenum capabilities[CAPABILITIES];
+        GLenum depthFunc = UNKNOWN;
+        GLenum depthMask = UNKNOWN;
+        GLenum cullFace = UNKNOWN;
+        GLenum blendSrc = UNKNOWN;
+        GLenum blendDst = UNKNOWN;
+
+        Shadow()
+        {
+            for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+                for (GLuint &bound : textures[unit])
+                    bound = UNKNOWN;
+            for (GLenum &capability : capabilities)
+                capability = UNKNOWN;
+        }
+    };
+    static inline Shadow current;
+    static inline bool contextAlive = true;
+
+    // true when the call has to be issued. the shadow is kept up to date even when tracking is off.
+    static bool changed(GLuint &shadow, GLuint value)
+    {
+        if (enabled && shadow == value)
+        {
+            elided++;
+            return false;
+        }
+        shadow = value;
+        issued++;
+        return true;
+    }
+
+    static int textureSlot(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_TEXTURE_2D:
+            return 0;
+        case GL_TEXTURE_CUBE_MAP:
+            return 1;
+        case GL_TEXTURE_2D_MULTISAMPLE:
+            return 2;
+        case GL_TEXTURE_2D_ARRAY:
+            return 3;
+        }
+        return -1;
+    }
+
+    static void setCapability(GLenum capability, bool on)
+    {
+        int slot = -1;
+        switch (capability)
+        {
+        case GL_DEPTH_TEST:
+            slot = 0;
+            break;
+        case GL_BLEND:
+            slot = 1;
+            break;
+        case GL_CULL_FACE:
+            slot = 2;
+            break;
+        case GL_STENCIL_TEST:
+            slot = 3;
+            break;
+        }
+        if (slot >= 0)
+        {
+            if (!changed(current.capabilities[slot], on ? GL_TRUE : GL_FALSE))
+                return;
+        }
+        else
+            issued++;
+        if (on)
+            glEnable(capability);
+        else
+            glDisable(capability);
+    }
+};
+
+#endif
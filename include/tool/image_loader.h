@@ -0,0 +1,187 @@
+#ifndef IMAGE_LOADER_H
+#define IMAGE_LOADER_H
+
+#include <glad/glad.h>
+
+#include <tool/thread_pool.h>
+#include <tool/mipmap.h>
+#include <tool/dds.h>
+#include <tool/mapped_file.h>
+#include <tool/staging_pool.h>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <filesystem>
+#include <functional>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+
+// An image with all of its mip levels as RGBA8, ready to go to glTexImage2D level by level.
+// The levels point either into staging (decoded pixels followed by the levels built from them) or into the mapped
+// mip cache file, GL reads them from there without another copy.
+struct LoadedImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<DdsFile::Level> levels;
+    bool fromCache = false;
+
+    StagingPool::Buffer staging;
+    DdsFile cached;
+
+    // levels point into the members, moving keeps them valid but a copy would not
+    LoadedImage() = default;
+    LoadedImage(const LoadedImage &) = delete;
+    LoadedImage &operator=(const LoadedImage &) = delete;
+    LoadedImage(LoadedImage &&) = default;
+    LoadedImage &operator=(LoadedImage &&) = default;
+
+    bool valid() const
+    {
+        return !levels.empty();
+    }
+    size_t dataSize() const
+    {
+        size_t bytes = 0;
+        for (const DdsFile::Level &level : levels)
+            bytes += level.size;
+        return bytes;
+    }
+};
+
+// Turns an image file into a LoadedImage off the GL thread: decode, build the mip chain with MipChain (sRGB aware
+// for colors, renormalized for normal maps) and store the chain in cacheDir as an RGBA8 .dds, so later loads map
+// that file and neither decode nor filter. A cache file is used while it is not older than the image.
+// The source file is mapped and decoded with stbi_load_from_memory (no stdio reads). stb_image returns its own
+// allocation, the pixels are moved once into a StagingPool buffer sized for the whole chain and the levels are
+// filtered in place behind them; the buffer returns to the pool when the LoadedImage is dropped after upload.
+//   load()    on a ThreadPool worker, sets the stb flip flag of that thread only
+//   upload()  on the GL thread, every level into a new texture, no glGenerateMipmap
+class ImageLoader
+{
+public:
+    static inline std::string cacheDir = "./output/texture_cache/";
+    static inline bool cacheMips = true;
+    // false reads the source with stbi_load (stdio), for comparisons
+    static inline bool mapSources = true;
+    // how the levels are filtered, MIP_KAISER is sharper and a few times slower
+    static inline MipFilter mipFilter = MIP_BOX;
+
+    // the key covers what changes the stored texels: the path, flip and how the levels are filtered
+    static std::string cachePath(const std::string &source, bool flip, TextureKind kind)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        std::string key = source + (flip ? "|f" : "|n") + std::to_string((int)kind) + (mipFilter == MIP_KAISER ? "|k" : "");
+        for (unsigned char c : key)
+        {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        char suffix[18];
+        snprintf(suffix, sizeof(suffix), "-%016llx", (unsigned long long)hash);
+        return cacheDir + std::filesystem::path(source).filename().string() + suffix + ".dds";
+    }
+
+    // not valid() when the file cannot be decoded
+    // ------------------------------------------------------------------------
+    static LoadedImage load(const std::string &path, bool flip, TextureKind kind, ThreadPool *pool = nullptr)
+    {
+        LoadedImage image;
+        std::string cache = cachePath(path, flip, kind);
+        if (cacheMips && upToDate(cache, path) && image.cached.open(cache) && image.cached.format == BLOCK_RGBA8)
+        {
+            image.width = image.cached.width;
+            image.height = image.cached.height;
+            image.levels = image.cached.levels;
+            image.fromCache = true;
+            return image;
+        }
+
+        int channels;
+        unsigned char *pixels = nullptr;
+        stbi_set_flip_vertically_on_load_thread(flip);
+        if (mapSources)
+        {
+            MappedFile source;
+            if (source.open(path) && source.size() <= (size_t)INT_MAX)
+                pixels = stbi_load_from_memory(source.data(), (int)source.size(), &image.width, &image.height, &channels, 4);
+        }
+        else
+            pixels = stbi_load(path.c_str(), &image.width, &image.height, &channels, 4);
+        if (pixels == nullptr)
+            return image;
+        image.staging = StagingPool::shared().acquire(MipChain::chainBytes(image.width, image.height));
+        memcpy(image.staging.data(), pixels, (size_t)image.width * image.height * 4);
+        stbi_image_free(pixels);
+        MipChain::buildInPlace(image.staging.data(), image.width, image.height, kind, pool, mipFilter);
+
+        size_t offset = 0;
+        int width = image.width, height = image.height;
+        for (int i = MipChain::levelCount(image.width, image.height); i > 0; i--)
+        {
+            DdsFile::Level level;
+            level.width = width;
+            level.height = height;
+            level.data = image.staging.data() + offset;
+            level.size = (size_t)width * height * 4;
+            image.levels.push_back(level);
+            offset += level.size;
+            width = std::max(width / 2, 1);
+            height = std::max(height / 2, 1);
+        }
+        if (cacheMips)
+            store(cache, image);
+        return image;
+    }
+
+    // texture with every level of image, parameters like TextureFromFile
+    // ------------------------------------------------------------------------
+    static GLuint upload(const LoadedImage &image, bool gamma, GLenum wrap)
+    {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        GLState::bindTexture(0, GL_TEXTURE_2D, texture);
+        GLenum internalFormat = gamma ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+        for (size_t i = 0; i < image.levels.size(); i++)
+            glTexImage2D(GL_TEXTURE_2D, (GLint)i, internalFormat, image.levels[i].width, image.levels[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.levels[i].data);
+        setParameters(image, wrap);
+        return texture;
+    }
+    // filtering and wrap of a texture whose levels are all defined
+    static void setParameters(const LoadedImage &image, GLenum wrap)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.levels.empty() ? 0 : (GLint)image.levels.size() - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+
+private:
+    static bool upToDate(const std::string &cache, const std::string &source)
+    {
+        std::error_code error;
+        std::filesystem::file_time_type cacheTime = std::filesystem::last_write_time(cache, error);
+        if (error)
+            return false;
+        std::filesystem::file_time_type sourceTime = std::filesystem::last_write_time(source, error);
+        return !error && cacheTime >= sourceTime;
+    }
+
+    // several workers may store the same image, each writes its own temporary file and renames it
+    static void store(const std::string &cache, const LoadedImage &image)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(cacheDir, error);
+        std::string temporary = cache + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+        if (DdsFile::save(temporary, BLOCK_RGBA8, image.width, image.height, image.levels))
+            std::filesystem::rename(temporary, cache, error);
+        else
+            std::filesystem::remove(temporary, error);
+    }
+};
+
+#endif
@@ -0,0 +1,378 @@
+#ifndef INSTANCE_CULLER_H
+#define INSTANCE_CULLER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <geometry/GeometryView.h>
+
+#include <tool/shader.h>
+#include <tool/mesh.h>
+#include <tool/frustum.h>
+#include <tool/gl_state.h>
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+
+// One level of detail of the instanced mesh: an index range of its element buffer and how far it is used
+struct InstanceLod
+{
+    GLsizei count;     // indices of this level
+    GLuint firstIndex; // first index of the level in the element buffer
+    GLint baseVertex;
+    float distance; // used while the bounding sphere is closer to the camera than this, the last level is the draw distance
+};
+
+// Instances culled on the GPU. All model matrices are uploaded once into a buffer texture together with a world
+// space bounding sphere per instance; every frame a cull pass tests the spheres against the frustum, picks a level by
+// distance and writes the indices of the surviving instances, bucketed by level. The draw then reads one index per
+// instance (attribute INDEX_LOCATION, see static/shader/instance_data.glsl) and fetches its matrix, so the vertex work
+// follows the visible instances and nothing goes through the CPU per instance.
+//   COMPUTE             GL 4.3: one dispatch fills the index buckets and the instance counts of the indirect draw
+//                       commands, drawn with one glMultiDrawElementsIndirect; nothing is read back
+//   TRANSFORM_FEEDBACK  GL 3.3: one rasterizer discarded point draw per level captures the indices of that level, the
+//                       counts come from a query that is read before the draws (waits for the cull pass)
+// Level k owns the index range [k * size(), (k + 1) * size()), so every level can hold all instances.
+// The cull program is built by the caller from static/shader/instance_cull.glsl: a compute shader for COMPUTE, or a
+// vertex + geometry shader with feedbackVaryings = {"visibleIndex"} for TRANSFORM_FEEDBACK (see src/37_instancing_rock).
+class InstanceCuller
+{
+public:
+    enum Path
+    {
+        COMPUTE,
+        TRANSFORM_FEEDBACK
+    };
+
+    static const GLuint INDEX_LOCATION = 8;
+    static const unsigned int MAX_LODS = 8; // MAX_CULL_LODS in instance_cull.glsl
+
+    static Path preferredPath()
+    {
+        return GLAD_GL_VERSION_4_3 ? COMPUTE : TRANSFORM_FEEDBACK;
+    }
+
+    // the levels of detail of a mesh for instances drawn at up to the given scale: each level takes over at the distance
+    // where its error covers maxPixelError pixels (pixelScale from Camera::GetPixelScale), the last one is drawn up to
+    // drawDistance. maxPixelError 0 draws everything at full detail. a mesh in a GeometryArena has its range in there,
+    // call it again after the arena defragmented
+    static std::vector<InstanceLod> levelsOf(const Mesh &mesh, float scale, float pixelScale, float maxPixelError, float drawDistance)
+    {
+        std::vector<InstanceLod> levels;
+        for (size_t i = 0; i < mesh.lods.size() && i < MAX_LODS; i++)
+        {
+            float until = drawDistance;
+            if (i + 1 < mesh.lods.size() && maxPixelError > 0.0f)
+                until = std::min(mesh.lods[i + 1].error * scale * pixelScale / maxPixelError, drawDistance);
+            levels.push_back({mesh.lods[i].indexCount, mesh.firstIndex() + mesh.lods[i].firstIndex, mesh.baseVertex(), until});
+        }
+        return levels;
+    }
+
+    // bounds are the local bounds of the mesh, every instance gets the sphere around them moved by its matrix
+    InstanceCuller(const std::vector<glm::mat4> &matrices, const Bounds &bounds, const std::vector<InstanceLod> &lods, Path path)
+        : lods(lods), cullPath(path), instanceCount((GLuint)matrices.size())
+    {
+        if (this->lods.empty() || this->lods.size() > MAX_LODS)
+        {
+            std::cout << "ERROR::INSTANCE_CULLER::LOD_COUNT " << this->lods.size() << std::endl;
+            this->lods.resize(std::min<size_t>(std::max<size_t>(this->lods.size(), 1), MAX_LODS));
+        }
+        counts.assign(this->lods.size(), 0);
+
+        GLint maxTexels = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+        if ((size_t)instanceCount * 4 > (size_t)maxTexels)
+            std::cout << "ERROR::INSTANCE_CULLER::TOO_MANY_INSTANCES " << instanceCount << " (buffer textures hold " << maxTexels / 4 << ")" << std::endl;
+
+        std::vector<glm::vec4> spheres(instanceCount);
+        glm::vec3 center = bounds.center();
+        float radius = glm::length(bounds.extent());
+        for (size_t i = 0; i < matrices.size(); i++)
+        {
+            const glm::mat4 &model = matrices[i];
+            float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+            spheres[i] = glm::vec4(glm::vec3(model * glm::vec4(center, 1.0f)), radius * scale);
+        }
+
+        glGenBuffers(1, &matrixBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, matrixBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, matrices.size() * sizeof(glm::mat4), matrices.data(), GL_STATIC_DRAW);
+        glGenTextures(1, &matrixTexture);
+        GLState::bindTexture(0, GL_TEXTURE_BUFFER, matrixTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, matrixBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        glGenBuffers(1, &sphereBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, sphereBuffer);
+        glBufferData(GL_ARRAY_BUFFER, spheres.size() * sizeof(glm::vec4), spheres.data(), GL_STATIC_DRAW);
+
+        glGenBuffers(1, &visibleBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, visibleBuffer);
+        glBufferData(GL_ARRAY_BUFFER, (size_t)instanceCount * this->lods.size() * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+
+        if (cullPath == COMPUTE)
+        {
+            glGenBuffers(1, &commandBuffer);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, this->lods.size() * sizeof(Command), NULL, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+        else
+        {
+            glGenVertexArrays(1, &cullVAO);
+            GLState::bindVertexArray(cullVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, sphereBuffer);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void *)0);
+            GLState::bindVertexArray(0);
+            queries.resize(this->lods.size());
+            glGenQueries((GLsizei)queries.size(), queries.data());
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    InstanceCuller(const InstanceCuller &) = delete;
+    InstanceCuller &operator=(const InstanceCuller &) = delete;
+    ~InstanceCuller()
+    {
+        if (!GLState::contextCurrent())
+            return;
+        GLState::forgetTexture(matrixTexture);
+        glDeleteTextures(1, &matrixTexture);
+        GLuint buffers[4] = {matrixBuffer, sphereBuffer, visibleBuffer, commandBuffer};
+        glDeleteBuffers(4, buffers);
+        if (cullVAO != 0)
+        {
+            GLState::forgetVertexArray(cullVAO);
+            glDeleteVertexArrays(1, &cullVAO);
+        }
+        if (!queries.empty())
+            glDeleteQueries((GLsizei)queries.size(), queries.data());
+    }
+
+    Path path() const
+    {
+        return cullPath;
+    }
+    size_t size() const
+    {
+        return instanceCount;
+    }
+    const std::vector<InstanceLod> &levels() const
+    {
+        return lods;
+    }
+    // e.g. new distances, the number of levels stays what the culler was made with
+    void setLevels(const std::vector<InstanceLod> &levels)
+    {
+        for (size_t i = 0; i < lods.size() && i < levels.size(); i++)
+            lods[i] = levels[i];
+    }
+
+    // test every instance on the GPU, the next draw() uses the result
+    // ------------------------------------------------------------------------
+    void cull(Shader &program, const Frustum &frustum, const glm::vec3 &cameraPos)
+    {
+        program.use();
+        const CullUniforms &handles = cullUniforms(program);
+        for (int i = 0; i < 6; i++)
+            program.setVec4(handles.frustumPlanes[i], frustum.planes[i]);
+        program.setVec3(handles.cameraPos, cameraPos);
+        program.setInt(handles.lodCount, (int)lods.size());
+        for (size_t i = 0; i < lods.size(); i++)
+            program.setFloat(handles.lodDistances[i], lods[i].distance);
+
+        if (cullPath == COMPUTE)
+        {
+            resetCommands();
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+            glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(Command), commands.data());
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, sphereBuffer);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, visibleBuffer);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, commandBuffer);
+            program.setInt(handles.totalInstances, (int)instanceCount);
+            glDispatchCompute((instanceCount + 63) / 64, 1, 1);
+            glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+            countsKnown = false;
+            return;
+        }
+
+        GLState::bindVertexArray(cullVAO);
+        glEnable(GL_RASTERIZER_DISCARD);
+        for (size_t lod = 0; lod < lods.size(); lod++)
+        {
+            program.setInt(handles.currentLod, (int)lod);
+            glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, visibleBuffer, regionOffset(lod), instanceCount * sizeof(GLuint));
+            glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, queries[lod]);
+            glBeginTransformFeedback(GL_POINTS);
+            glDrawArrays(GL_POINTS, 0, (GLsizei)instanceCount);
+            glEndTransformFeedback();
+            glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+        }
+        glDisable(GL_RASTERIZER_DISCARD);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        GLState::bindVertexArray(0);
+        countsKnown = false;
+    }
+
+    // draw the listed instances (e.g. culled on the CPU) with the first level instead
+    // ------------------------------------------------------------------------
+    void setVisible(const std::vector<uint32_t> &indices)
+    {
+        GLuint visible = (GLuint)std::min<size_t>(indices.size(), instanceCount);
+        glBindBuffer(GL_ARRAY_BUFFER, visibleBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, visible * sizeof(GLuint), indices.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        std::fill(counts.begin(), counts.end(), 0);
+        counts[0] = visible;
+        if (cullPath == COMPUTE)
+        {
+            resetCommands();
+            commands[0].instanceCount = visible;
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+            glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(Command), commands.data());
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+        countsKnown = true;
+    }
+
+    // the matrices for instanceMatrix(), on the given texture unit
+    // ------------------------------------------------------------------------
+    void bindMatrices(Shader &shader, unsigned int unit) const
+    {
+        shader.setInt("instanceMatrices", (int)unit);
+        GLState::bindTexture(unit, GL_TEXTURE_BUFFER, matrixTexture);
+    }
+
+    // draw the mesh with the result of the last cull() or setVisible(), the shader is in use.
+    // the index attribute is set up for the draw only, the vertex array may be shared (e.g. by a GeometryArena)
+    // ------------------------------------------------------------------------
+    void draw(GeometryView mesh)
+    {
+        GLState::bindVertexArray(mesh.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, visibleBuffer);
+        glEnableVertexAttribArray(INDEX_LOCATION);
+        glVertexAttribDivisor(INDEX_LOCATION, 1);
+        if (cullPath == COMPUTE)
+        {
+            glVertexAttribIPointer(INDEX_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void *)0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, mesh.indexType, (void *)0, (GLsizei)lods.size(), 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+        else
+        {
+            // no base instance before GL 4.2, the index attribute is moved to the region of each level instead
+            readCounts();
+            for (size_t lod = 0; lod < lods.size(); lod++)
+            {
+                if (counts[lod] == 0)
+                    continue;
+                glVertexAttribIPointer(INDEX_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void *)regionOffset(lod));
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, lods[lod].count, mesh.indexType, (void *)(lods[lod].firstIndex * indexSize(mesh.indexType)),
+                                                  (GLsizei)counts[lod], lods[lod].baseVertex);
+            }
+        }
+        glDisableVertexAttribArray(INDEX_LOCATION);
+        glVertexAttribDivisor(INDEX_LOCATION, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        GLState::bindVertexArray(0);
+    }
+
+    // instances per level of the last cull; on the compute path this reads the commands back and waits for the GPU,
+    // so call it for statistics now and then, not every frame
+    // ------------------------------------------------------------------------
+    const std::vector<GLuint> &readCounts()
+    {
+        if (countsKnown)
+            return counts;
+        if (cullPath == COMPUTE)
+        {
+            commands.resize(lods.size());
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+            glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(Command), commands.data());
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            for (size_t lod = 0; lod < lods.size(); lod++)
+                counts[lod] = commands[lod].instanceCount;
+        }
+        else
+        {
+            for (size_t lod = 0; lod < lods.size(); lod++)
+                glGetQueryObjectuiv(queries[lod], GL_QUERY_RESULT, &counts[lod]);
+        }
+        countsKnown = true;
+        return counts;
+    }
+
+private:
+    // DrawElementsIndirectCommand, DrawCommand in the cull shader
+    struct Command
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // locations in the cull program, looked up again when another program (or a hot reloaded one) is passed
+    struct CullUniforms
+    {
+        GLuint program = 0;
+        unsigned int generation = 0;
+        UniformHandle frustumPlanes[6];
+        UniformHandle lodDistances[MAX_LODS];
+        UniformHandle cameraPos, lodCount, currentLod, totalInstances;
+    };
+
+    std::vector<InstanceLod> lods;
+    Path cullPath;
+    GLuint instanceCount;
+    std::vector<GLuint> counts;
+    bool countsKnown = true;
+
+    GLuint matrixBuffer = 0, matrixTexture = 0; // instance matrices, 4 RGBA32F texels each
+    GLuint sphereBuffer = 0;                    // vec4 per instance: world center and radius
+    GLuint visibleBuffer = 0;                   // indices of the visible instances, one region per level
+    GLuint commandBuffer = 0;                   // COMPUTE: one indirect command per level
+    GLuint cullVAO = 0;                         // TRANSFORM_FEEDBACK: the spheres as points
+    std::vector<GLuint> queries;                // TRANSFORM_FEEDBACK: primitives written per level
+    std::vector<Command> commands;              // COMPUTE: staging for the commands, kept between frames
+    CullUniforms uniforms;
+
+    size_t regionOffset(size_t lod) const
+    {
+        return lod * instanceCount * sizeof(GLuint);
+    }
+    // the commands with no instances yet, every level reads its own region of the visible indices
+    void resetCommands()
+    {
+        commands.resize(lods.size());
+        for (size_t lod = 0; lod < lods.size(); lod++)
+            commands[lod] = {(GLuint)lods[lod].count, 0, lods[lod].firstIndex, lods[lod].baseVertex, (GLuint)(lod * instanceCount)};
+    }
+    const CullUniforms &cullUniforms(const Shader &program)
+    {
+        if (uniforms.program == program.ID && uniforms.generation == program.generation)
+            return uniforms;
+        uniforms.program = program.ID;
+        uniforms.generation = program.generation;
+        for (int i = 0; i < 6; i++)
+            uniforms.frustumPlanes[i] = program.uniform("frustumPlanes[" + std::to_string(i) + "]");
+        for (unsigned int i = 0; i < MAX_LODS; i++)
+            uniforms.lodDistances[i] = program.uniform("lodDistances[" + std::to_string(i) + "]");
+        uniforms.cameraPos = program.uniform("cullCameraPos");
+        uniforms.lodCount = program.uniform("lodCount");
+        uniforms.currentLod = program.uniform("currentLod");
+        uniforms.totalInstances = program.uniform("totalInstances");
+        return uniforms;
+    }
+};
+
+#endif
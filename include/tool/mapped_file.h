@@ -0,0 +1,163 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A whole file mapped read-only into memory. The pages are read by the OS when they are first touched,
+// so data can be handed to glBufferData/glTexImage straight from the mapping without a copy into a buffer.
+// Move-only, the mapping is released with the object.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string &path)
+    {
+        open(path);
+    }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept
+    {
+        swap(other);
+    }
+    MappedFile &operator=(MappedFile &&other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            swap(other);
+        }
+        return *this;
+    }
+    ~MappedFile()
+    {
+        close();
+    }
+
+    // false when the file is missing or empty
+    bool open(const std::string &path)
+    {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        {
+            close();
+            return false;
+        }
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL)
+        {
+            close();
+            return false;
+        }
+        bytes = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        length = (size_t)fileSize.QuadPart;
+#else
+        descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0)
+            return false;
+        struct stat info;
+        if (fstat(descriptor, &info) != 0 || info.st_size == 0)
+        {
+            close();
+            return false;
+        }
+        void *address = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (address == MAP_FAILED)
+        {
+            close();
+            return false;
+        }
+        // the file is read front to back, let the kernel read ahead
+        madvise(address, (size_t)info.st_size, MADV_SEQUENTIAL);
+        bytes = (const unsigned char *)address;
+        length = (size_t)info.st_size;
+#endif
+        if (bytes == nullptr)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (bytes != nullptr)
+            UnmapViewOfFile(bytes);
+        if (mapping != NULL)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (bytes != nullptr)
+            munmap((void *)bytes, length);
+        if (descriptor >= 0)
+            ::close(descriptor);
+        descriptor = -1;
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+
+    bool isOpen() const
+    {
+        return bytes != nullptr;
+    }
+    const unsigned char *data() const
+    {
+        return bytes;
+    }
+    size_t size() const
+    {
+        return length;
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#else
+    int descriptor = -1;
+#endif
+    const unsigned char *bytes = nullptr;
+    size_t length = 0;
+
+    void swap(MappedFile &other)
+    {
+#ifdef _WIN32
+        std::swap(file, other.file);
+        std::swap(mapping, other.mapping);
+#else
+        std::swap(descriptor, other.descriptor);
+#endif
+        std::swap(bytes, other.bytes);
+        std::swap(length, other.length);
+    }
+};
+
+#endif
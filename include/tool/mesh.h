@@ -6,9 +6,18 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <tool/shader.h>
+#include <tool/gl_state.h>
+#include <tool/vertex_format.h>
+#include <tool/mesh_simplifier.h>
+#include <tool/mesh_optimizer.h>
+#include <tool/geometry_arena.h>
+#include <geometry/GeometryView.h>
 
 #include <string>
 #include <vector>
+#include <utility>
+#include <cstring>
+#include <unordered_map>
 
 using namespace std;
 
@@ -32,6 +41,135 @@ struct Texture
 	string path;
 };
 
+// one level of detail: a range of the element buffer and how far its surface may lie from the full mesh
+struct MeshLod
+{
+	GLuint firstIndex;
+	GLsizei indexCount;
+	float error; // model units, 0 for the full mesh
+};
+
+// the CPU side of a mesh, can be prepared on a worker thread and uploaded afterwards by the Mesh constructor
+struct MeshData
+{
+	vector<Vertex> vertices;
+	vector<unsigned int> indices; // all levels of detail back to back, see lods
+	vector<MeshLod> lods;          // empty for a mesh with only the full level
+	Bounds bounds;
+	vector<unsigned char> packed; // vertices encoded in a compressed VertexFormat
+
+	// append up to levels - 1 simplified levels to the indices, each with about ratio times the triangles of the one before.
+	// all levels use the same vertices. stops early when the simplifier cannot take away enough any more
+	void buildLods(unsigned int levels, float ratio = 0.5f)
+	{
+		GLsizei full = (GLsizei)indices.size();
+		lods.assign(1, MeshLod{0, full, 0.0f});
+		if (levels < 2 || full < 3)
+			return;
+		// Assimp writes a vertex per face corner unless it joins them, the simplifier needs triangles that share vertices
+		vector<unsigned int> remap = weldRemap();
+		vector<unsigned int> shared(indices.begin(), indices.begin() + full);
+		for (unsigned int &index : shared)
+			index = remap[index];
+		MeshSimplifier simplifier(&vertices[0].Position, vertices.size(), sizeof(Vertex), shared.data(), shared.size());
+		vector<unsigned int> level;
+		size_t target = (size_t)full;
+		for (unsigned int i = 1; i < levels; i++)
+		{
+			target = (size_t)(target * ratio) / 3 * 3;
+			float error = simplifier.simplify(target, level);
+			if (level.empty() || level.size() > (size_t)lods.back().indexCount * 9 / 10)
+				break;
+			lods.push_back(MeshLod{(GLuint)indices.size(), (GLsizei)level.size(), error});
+			indices.insert(indices.end(), level.begin(), level.end());
+		}
+	}
+
+	// MeshOptimization flags: joins equal vertices, then reorders the triangles of every level and the vertices.
+	// the vertices of a joined corner keep the average of their tangents, the duplicates are dropped with any flag
+	void optimize(unsigned int flags)
+	{
+		if (flags == 0 || indices.size() < 3)
+			return;
+		vector<unsigned int> remap = weldRemap();
+		vector<glm::vec3> tangents(vertices.size(), glm::vec3(0.0f)), bitangents(vertices.size(), glm::vec3(0.0f));
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			tangents[remap[i]] += vertices[i].Tangent;
+			bitangents[remap[i]] += vertices[i].Bitangent;
+		}
+		for (size_t i = 0; i < vertices.size(); i++)
+			if (remap[i] == i)
+			{
+				if (glm::length(tangents[i]) > 0.0f)
+					vertices[i].Tangent = glm::normalize(tangents[i]);
+				if (glm::length(bitangents[i]) > 0.0f)
+					vertices[i].Bitangent = glm::normalize(bitangents[i]);
+			}
+		for (unsigned int &index : indices)
+			index = remap[index];
+
+		vector<MeshLod> levels = lods.empty() ? vector<MeshLod>(1, MeshLod{0, (GLsizei)indices.size(), 0.0f}) : lods;
+		for (const MeshLod &level : levels)
+		{
+			if (flags & OPTIMIZE_VERTEX_CACHE)
+				MeshOptimizer::optimizeVertexCache(&indices[level.firstIndex], level.indexCount, vertices.size());
+			if (flags & OPTIMIZE_OVERDRAW)
+				MeshOptimizer::optimizeOverdraw(&indices[level.firstIndex], level.indexCount, &vertices[0].Position, sizeof(Vertex), vertices.size());
+		}
+		if (flags & OPTIMIZE_VERTEX_FETCH)
+			MeshOptimizer::optimizeVertexFetch(vertices, indices.data(), indices.size());
+		else
+			MeshOptimizer::removeUnusedVertices(vertices, indices.data(), indices.size());
+	}
+
+	// everything the upload needs apart from GL: bounds and the packed vertices
+	void prepare(const VertexFormat &format)
+	{
+		bounds = Bounds::of(vertices);
+		if (!format.isFull())
+			packed = format.encode(vertices, bounds);
+	}
+
+private:
+	// for every vertex the first one of equal position, normal and UV (tangents are ignored, they differ per face corner)
+	vector<unsigned int> weldRemap() const
+	{
+		struct Key
+		{
+			float values[8];
+			bool operator==(const Key &other) const
+			{
+				return memcmp(values, other.values, sizeof(values)) == 0;
+			}
+		};
+		struct KeyHash
+		{
+			size_t operator()(const Key &key) const
+			{
+				size_t hash = 14695981039346656037ull;
+				const unsigned char *bytes = (const unsigned char *)key.values;
+				for (size_t i = 0; i < sizeof(key.values); i++)
+					hash = (hash ^ bytes[i]) * 1099511628211ull;
+				return hash;
+			}
+		};
+		unordered_map<Key, unsigned int, KeyHash> first;
+		first.reserve(vertices.size());
+		vector<unsigned int> remap(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const Vertex &vertex = vertices[i];
+			Key key = {{vertex.Position.x, vertex.Position.y, vertex.Position.z, vertex.Normal.x, vertex.Normal.y, vertex.Normal.z,
+						vertex.TexCoords.x, vertex.TexCoords.y}};
+			remap[i] = first.insert({key, (unsigned int)i}).first->second;
+		}
+		return remap;
+	}
+};
+
+// owns its VAO/VBO/EBO: move-only, the GL objects are deleted with the mesh.
+// a mesh created with a GeometryArena owns a range of the arena instead and draws with the VAO of the arena
 class Mesh
 {
 public:
@@ -39,76 +177,326 @@ public:
 	vector<Vertex> vertices;
 	vector<unsigned int> indices;
 	vector<Texture> textures;
-	unsigned int VAO;
+	unsigned int VAO = 0;
 
-	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
-	{
-		this->vertices = vertices;
-		this->indices = indices;
-		this->textures = textures;
+	// recorded on upload, still valid after the retention policy dropped vertices/indices
+	// indexCount is the full level, indices only ever holds that one
+	GLsizei indexCount = 0;
+	GLsizei vertexCount = 0;
+	GLenum indexType = GL_UNSIGNED_INT; // of the element buffer, 16 bit up to 65536 vertices (indexTypeFor)
+	Bounds bounds;
+	vector<glm::vec3> positions; // kept by RETAIN_POSITIONS
+	// levels of detail in the element buffer, lods[0] is the full mesh
+	vector<MeshLod> lods;
+	// layout of the vertex buffer, the shader has to be compiled with format.defines()
+	VertexFormat format;
 
+	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, CpuRetention retention = RETAIN_ALL, VertexFormat format = VertexFormat(),
+		 GeometryArena *arena = nullptr)
+		: vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)), format(format), arena(arena)
+	{
 		// now that we have all the required data, set the vertex buffers and its attribute pointers.
-		setupMesh();
+		indexCount = (GLsizei)this->indices.size();
+		vertexCount = (GLsizei)this->vertices.size();
+		lods.assign(1, MeshLod{0, indexCount, 0.0f});
+		bounds = Bounds::of(this->vertices);
+		setupMesh(this->vertices.data(), this->indices.data(), indexCount);
+		retain(retention);
+	}
+	// upload data that was prepared with the same format
+	Mesh(MeshData data, vector<Texture> textures, CpuRetention retention = RETAIN_ALL, VertexFormat format = VertexFormat(), GeometryArena *arena = nullptr)
+		: vertices(std::move(data.vertices)), indices(std::move(data.indices)), textures(std::move(textures)), bounds(data.bounds),
+		  lods(std::move(data.lods)), format(format), arena(arena)
+	{
+		if (lods.empty())
+			lods.assign(1, MeshLod{0, (GLsizei)indices.size(), 0.0f});
+		indexCount = lods[0].indexCount;
+		vertexCount = (GLsizei)vertices.size();
+		setupMesh(vertices.data(), indices.data(), (GLsizei)indices.size(), &data.packed);
+		indices.resize(indexCount);
+		retain(retention);
+	}
+	// upload straight from memory owned by someone else (e.g. a memory mapped MeshCache),
+	// only what the retention policy keeps is copied. indexCount covers all levels of detail when lods are given
+	Mesh(const Vertex *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount, vector<Texture> textures,
+		 CpuRetention retention = RETAIN_ALL, VertexFormat format = VertexFormat(), vector<MeshLod> lods = vector<MeshLod>(), GeometryArena *arena = nullptr)
+		: textures(std::move(textures)), vertexCount((GLsizei)vertexCount), lods(std::move(lods)), format(format), arena(arena)
+	{
+		if (this->lods.empty())
+			this->lods.assign(1, MeshLod{0, (GLsizei)indexCount, 0.0f});
+		this->indexCount = this->lods[0].indexCount;
+		bounds = Bounds::of(vertexData, vertexCount);
+		setupMesh(vertexData, indexData, (GLsizei)indexCount);
+		if (retention != RETAIN_NONE)
+			indices.assign(indexData, indexData + this->indexCount);
+		if (retention == RETAIN_ALL)
+			vertices.assign(vertexData, vertexData + vertexCount);
+		else if (retention == RETAIN_POSITIONS)
+		{
+			positions.resize(vertexCount);
+			for (size_t i = 0; i < vertexCount; i++)
+				positions[i] = vertexData[i].Position;
+		}
+	}
+	Mesh(const Mesh &) = delete;
+	Mesh &operator=(const Mesh &) = delete;
+	Mesh(Mesh &&other) noexcept
+	{
+		*this = std::move(other);
+	}
+	Mesh &operator=(Mesh &&other) noexcept
+	{
+		if (this != &other)
+		{
+			release();
+			vertices = std::move(other.vertices);
+			indices = std::move(other.indices);
+			textures = std::move(other.textures);
+			positions = std::move(other.positions);
+			uniformCache = std::move(other.uniformCache);
+			lods = std::move(other.lods);
+			indexCount = other.indexCount;
+			vertexCount = other.vertexCount;
+			indexType = other.indexType;
+			bounds = other.bounds;
+			format = other.format;
+			VAO = other.VAO;
+			VBO = other.VBO;
+			EBO = other.EBO;
+			arena = other.arena;
+			arenaHandle = other.arenaHandle;
+			other.VAO = other.VBO = other.EBO = 0;
+			other.arena = nullptr;
+			other.arenaHandle = GeometryArena::INVALID_HANDLE;
+		}
+		return *this;
+	}
+	~Mesh()
+	{
+		if (GLState::contextCurrent())
+			release();
 	}
 	// render the mesh
 	void Draw(Shader &shader)
 	{
-		// bind appropriate textures
+		Draw(shader, 0);
+	}
+	// render one level of detail
+	void Draw(Shader &shader, unsigned int lod)
+	{
+		BindTextures(shader);
+		BindVertexFormat(shader);
+
+		// draw mesh
+		const MeshLod &level = lods[lod < lods.size() ? lod : lods.size() - 1];
+		GLState::bindVertexArray(VAO);
+		glDrawElementsBaseVertex(GL_TRIANGLES, level.indexCount, indexType, (void *)((firstIndex() + level.firstIndex) * indexSize(indexType)), baseVertex());
+		GLState::unbindVertexArray();
+
+		// always good practice to set everything back to defaults once configured.
+		// with GLState enabled the next draw simply binds what it needs instead.
+		GLState::resetActiveTexture();
+	}
+	// where the mesh starts in the element/vertex buffer, 0 unless it lives in a GeometryArena.
+	// read them again for every draw, the arena moves its ranges when it defragments
+	GLuint firstIndex() const
+	{
+		return arena != nullptr ? arena->range(arenaHandle).firstIndex : 0;
+	}
+	GLint baseVertex() const
+	{
+		return arena != nullptr ? arena->range(arenaHandle).baseVertex : 0;
+	}
+	// the coarsest level whose error covers at most maxPixelError pixels, pixelsPerUnit is the size of one model unit on screen
+	unsigned int selectLod(float pixelsPerUnit, float maxPixelError) const
+	{
+		unsigned int lod = 0;
+		while (lod + 1 < lods.size() && lods[lod + 1].error * pixelsPerUnit <= maxPixelError)
+			lod++;
+		return lod;
+	}
+	// drop the CPU copies that are no longer needed once the buffers are uploaded
+	void retain(CpuRetention retention)
+	{
+		if (retention == RETAIN_ALL)
+			return;
+		if (retention == RETAIN_POSITIONS)
+		{
+			positions.resize(vertices.size());
+			for (size_t i = 0; i < vertices.size(); i++)
+				positions[i] = vertices[i].Position;
+		}
+		else
+			vector<unsigned int>().swap(indices);
+		vector<Vertex>().swap(vertices);
+	}
+	// bytes resident in memory / in the vertex and index buffers
+	size_t cpuBytes() const
+	{
+		return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int) + positions.capacity() * sizeof(glm::vec3);
+	}
+	size_t gpuBytes() const
+	{
+		size_t indexBytes = 0;
+		for (const MeshLod &level : lods)
+			indexBytes += (size_t)level.indexCount * indexSize(indexType);
+		return (size_t)vertexCount * format.stride() + indexBytes;
+	}
+	// quantized positions are stored relative to the bounds, hand the shader what it needs to scale them back
+	void BindVertexFormat(Shader &shader) const
+	{
+		if (format.position == VertexFormat::POSITION_UNORM16)
+		{
+			const MeshUniforms &handles = uniformsOf(shader);
+			shader.setVec3(handles.positionOffset, bounds.min);
+			shader.setVec3(handles.positionScale, VertexFormat::dequantizeScale(bounds));
+		}
+	}
+	// bind the textures to units 0..n and point the texture_diffuseN/texture_specularN/... samplers at them
+	void BindTextures(Shader &shader) const
+	{
+		const MeshUniforms &handles = uniformsOf(shader);
+		for (unsigned int i = 0; i < textures.size(); i++)
+		{
+			// set the sampler to the correct texture unit
+			shader.setInt(handles.samplers[i], i);
+			// and bind the texture (activates the unit only when the binding changes)
+			GLState::bindTexture(i, GL_TEXTURE_2D, textures[i].id);
+		}
+	}
+
+private:
+	// the uniforms Bind* set in one program, looked up by name on the first draw and after a hot reload
+	struct MeshUniforms
+	{
+		GLuint program = 0;
+		unsigned int generation = 0;
+		vector<UniformHandle> samplers; // per texture: texture_diffuseN, texture_specularN, ...
+		UniformHandle positionOffset, positionScale;
+	};
+
+	// render data
+	unsigned int VBO = 0, EBO = 0;
+	GeometryArena *arena = nullptr;
+	GeometryArena::Handle arenaHandle = GeometryArena::INVALID_HANDLE;
+	// one entry per program the mesh is drawn with, usually a depth and a shading pass
+	mutable vector<MeshUniforms> uniformCache;
+
+	const MeshUniforms &uniformsOf(const Shader &shader) const
+	{
+		MeshUniforms *handles = nullptr;
+		for (MeshUniforms &entry : uniformCache)
+			if (entry.program == shader.ID)
+				handles = &entry;
+		if (handles != nullptr && handles->generation == shader.generation && handles->samplers.size() == textures.size())
+			return *handles;
+		if (handles == nullptr)
+		{
+			uniformCache.emplace_back();
+			handles = &uniformCache.back();
+		}
+		handles->program = shader.ID;
+		handles->generation = shader.generation;
+		handles->positionOffset = shader.uniform("positionOffset");
+		handles->positionScale = shader.uniform("positionScale");
+		// the N in texture_diffuseN counts the textures of each type
 		unsigned int diffuseNr = 1;
 		unsigned int specularNr = 1;
 		unsigned int normalNr = 1;
 		unsigned int heightNr = 1;
-		for (unsigned int i = 0; i < textures.size(); i++)
+		handles->samplers.clear();
+		for (const Texture &texture : textures)
 		{
-			glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-																				// retrieve texture number (the N in diffuse_textureN)
 			string number;
-			string name = textures[i].type;
-			if (name == "texture_diffuse")
+			if (texture.type == "texture_diffuse")
 				number = std::to_string(diffuseNr++);
-			else if (name == "texture_specular")
-				number = std::to_string(specularNr++); // transfer unsigned int to stream
-			else if (name == "texture_normal")
-				number = std::to_string(normalNr++); // transfer unsigned int to stream
-			else if (name == "texture_height")
-				number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-			// now set the sampler to the correct texture unit
-			glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-			// and finally bind the texture
-			glBindTexture(GL_TEXTURE_2D, textures[i].id);
+			else if (texture.type == "texture_specular")
+				number = std::to_string(specularNr++);
+			else if (texture.type == "texture_normal")
+				number = std::to_string(normalNr++);
+			else if (texture.type == "texture_height")
+				number = std::to_string(heightNr++);
+			handles->samplers.push_back(shader.uniform(texture.type + number));
 		}
-
-		// draw mesh
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
-
-		// always good practice to set everything back to defaults once configured.
-		glActiveTexture(GL_TEXTURE0);
+		return *handles;
 	}
 
-private:
-	// render data
-	unsigned int VBO, EBO;
+	// textures are shared between meshes and owned by the model, only the buffers belong to the mesh
+	void release()
+	{
+		if (arena != nullptr)
+		{
+			// the VAO belongs to the arena
+			arena->free(arenaHandle);
+			arena = nullptr;
+			arenaHandle = GeometryArena::INVALID_HANDLE;
+			VAO = 0;
+			return;
+		}
+		if (VAO == 0 && VBO == 0 && EBO == 0)
+			return;
+		GLState::forgetVertexArray(VAO);
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+		glDeleteBuffers(1, &EBO);
+		VAO = VBO = EBO = 0;
+	}
 
-	void setupMesh()
+	// bounds have to be set, packed are the vertices already encoded in the format (encoded here when missing)
+	void setupMesh(const Vertex *vertexData, const unsigned int *indexData, GLsizei indexTotal, const vector<unsigned char> *packed = nullptr)
 	{
+		// an arena of another layout cannot take the mesh, it gets buffers of its own
+		if (arena != nullptr && !(arena->format == format))
+			arena = nullptr;
+		if (arena != nullptr)
+		{
+			// the arena stores every format encoded, the full one included
+			vector<unsigned char> encoded;
+			bool prepared = packed != nullptr && !packed->empty();
+			if (!prepared)
+				encoded = format.encode(vertexData, vertexCount, bounds);
+			GeometryArena::Handle handle = arena->allocate(prepared ? packed->data() : encoded.data(), vertexCount, indexData, indexTotal);
+			if (handle != GeometryArena::INVALID_HANDLE)
+			{
+				arenaHandle = handle;
+				indexType = arena->range(arenaHandle).indexType;
+				VAO = arena->vertexArray();
+				return;
+			}
+			// the arena could not make room (e.g. out of memory while growing), the mesh gets buffers of its own
+			arena = nullptr;
+		}
+
 		// create buffers/arrays
 		glGenVertexArrays(1, &VAO);
 		glGenBuffers(1, &VBO);
 		glGenBuffers(1, &EBO);
 
-		glBindVertexArray(VAO);
+		GLState::bindVertexArray(VAO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		indexType = indexTypeFor(vertexCount);
+		uploadIndices(indexData, indexTotal, indexType);
+
 		// load data into vertex buffers
 		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		if (!format.isFull())
+		{
+			// packed attributes, see VertexFormat
+			vector<unsigned char> encoded;
+			if (packed == nullptr || packed->empty())
+			{
+				encoded = format.encode(vertexData, vertexCount, bounds);
+				packed = &encoded;
+			}
+			glBufferData(GL_ARRAY_BUFFER, packed->size(), packed->data(), GL_STATIC_DRAW);
+			format.setupAttributes();
+			GLState::bindVertexArray(0);
+			return;
+		}
 		// A great thing about structs is that their memory layout is sequential for all its items.
 		// The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
 		// again translates to 3/2 floats which translates to a byte array.
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertexData, GL_STATIC_DRAW);
 
 		// set the vertex attribute pointers
 		// vertex Positions
@@ -127,7 +515,7 @@ private:
 		glEnableVertexAttribArray(4);
 		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Bitangent));
 
-		glBindVertexArray(0);
+		GLState::bindVertexArray(0);
 	}
 };
 
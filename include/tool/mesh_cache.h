@@ -0,0 +1,356 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <tool/mesh.h>
+#include <tool/mapped_file.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <filesystem>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+
+// Binary container for an imported model, written after the first Assimp import and memory mapped on later
+// loads so the vertex and index data go to glBufferData straight from the mapping.
+// Layout, every section starts 16 byte aligned:
+//   MeshCacheHeader
+//   MeshCacheMesh     [meshCount]       ranges into the vertex, index and level tables, material index
+//   MeshCacheMaterial [materialCount]   range into the texture table
+//   MeshCacheTexture  [textureCount]    sampler type and path relative to the model directory, ranges into the strings
+//   MeshCacheLod      [lodCount]        levels of detail of each mesh, index ranges inside the mesh's indices
+//   Vertex            [vertexCount]     all meshes back to back, after Triangulate/GenSmoothNormals/CalcTangentSpace
+//   uint32            [indexCount]      all levels of each mesh back to back
+//   char              [stringSize]      the texture types and paths back to back, not terminated
+// A file is only used when version, Vertex size, import flags, number of levels built, mesh optimizations and the
+// size/modification time of the source match.
+struct MeshCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t vertexSize;
+    uint32_t importFlags;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint32_t meshCount;
+    uint32_t materialCount;
+    uint32_t textureCount;
+    uint32_t lodLevels;    // levels asked for at import, meshes may have fewer
+    uint32_t optimization; // MeshOptimization flags applied at import
+    uint32_t reserved;
+    uint64_t meshOffset;
+    uint64_t materialOffset;
+    uint64_t textureOffset;
+    uint64_t lodOffset;
+    uint64_t lodCount;
+    uint64_t vertexOffset;
+    uint64_t vertexCount;
+    uint64_t indexOffset;
+    uint64_t indexCount;
+    uint64_t stringOffset;
+    uint64_t stringSize;
+    uint64_t fileSize;
+};
+
+struct MeshCacheMesh
+{
+    uint64_t firstVertex;
+    uint64_t firstIndex;
+    uint32_t vertexCount;
+    uint32_t indexCount; // all levels
+    uint32_t material;
+    uint32_t firstLod;
+    uint32_t lodCount;
+    uint32_t reserved;
+};
+
+struct MeshCacheMaterial
+{
+    uint32_t firstTexture;
+    uint32_t textureCount;
+};
+
+// any length of path, read them with MeshCache::textureType/texturePath
+struct MeshCacheTexture
+{
+    uint32_t typeOffset; // in the string section
+    uint32_t typeLength;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+};
+
+struct MeshCacheLod
+{
+    uint32_t firstIndex; // relative to the first index of the mesh
+    uint32_t indexCount;
+    float error;
+    uint32_t reserved;
+};
+
+class MeshCache
+{
+public:
+    static const uint32_t VERSION = 4;
+    static inline std::string cacheDir = "./output/mesh_cache/";
+    static inline bool enabled = true;
+
+    // cache file of a model: file name plus a hash of the full path, models in different folders may share a name
+    static std::string cachePath(const std::string &source)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (unsigned char c : source)
+        {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        char suffix[18];
+        snprintf(suffix, sizeof(suffix), "-%016llx", (unsigned long long)hash);
+        return cacheDir + std::filesystem::path(source).filename().string() + suffix + ".mesh";
+    }
+
+    // map the cache of source, false when there is none or it is stale
+    // ------------------------------------------------------------------------
+    bool open(const std::string &source, uint32_t importFlags, uint32_t lodLevels = 1, uint32_t optimization = 0)
+    {
+        if (!enabled || !file.open(cachePath(source)))
+            return false;
+        MeshCacheHeader expected = describe(source, importFlags, lodLevels, optimization);
+        if (file.size() < sizeof(MeshCacheHeader))
+            return reject();
+        const MeshCacheHeader &header = this->header();
+        if (memcmp(header.magic, expected.magic, 4) != 0 || header.version != VERSION || header.vertexSize != sizeof(Vertex) ||
+            header.importFlags != importFlags || header.lodLevels != lodLevels || header.optimization != optimization ||
+            header.sourceSize != expected.sourceSize || header.sourceTime != expected.sourceTime ||
+            header.fileSize != file.size())
+            return reject();
+        // the tables have to lie inside the file
+        if (header.meshOffset + header.meshCount * sizeof(MeshCacheMesh) > file.size() ||
+            header.materialOffset + header.materialCount * sizeof(MeshCacheMaterial) > file.size() ||
+            header.textureOffset + header.textureCount * sizeof(MeshCacheTexture) > file.size() ||
+            header.lodOffset + header.lodCount * sizeof(MeshCacheLod) > file.size() ||
+            header.vertexOffset + header.vertexCount * sizeof(Vertex) > file.size() ||
+            header.indexOffset + header.indexCount * sizeof(uint32_t) > file.size() ||
+            header.stringOffset + header.stringSize > file.size())
+            return reject();
+        for (uint32_t i = 0; i < header.meshCount; i++)
+        {
+            const MeshCacheMesh &entry = mesh(i);
+            if (entry.firstVertex + entry.vertexCount > header.vertexCount || entry.firstIndex + entry.indexCount > header.indexCount ||
+                entry.material >= header.materialCount || (uint64_t)entry.firstLod + entry.lodCount > header.lodCount)
+                return reject();
+            for (uint32_t j = 0; j < entry.lodCount; j++)
+                if ((uint64_t)lods(entry)[j].firstIndex + lods(entry)[j].indexCount > entry.indexCount)
+                    return reject();
+        }
+        for (uint32_t i = 0; i < header.materialCount; i++)
+            if ((uint64_t)material(i).firstTexture + material(i).textureCount > header.textureCount)
+                return reject();
+        for (uint32_t i = 0; i < header.textureCount; i++)
+            if ((uint64_t)texture(i).typeOffset + texture(i).typeLength > header.stringSize ||
+                (uint64_t)texture(i).pathOffset + texture(i).pathLength > header.stringSize)
+                return reject();
+        return true;
+    }
+    void close()
+    {
+        file.close();
+    }
+
+    const MeshCacheHeader &header() const
+    {
+        return *(const MeshCacheHeader *)file.data();
+    }
+    const MeshCacheMesh &mesh(uint32_t index) const
+    {
+        return ((const MeshCacheMesh *)(file.data() + header().meshOffset))[index];
+    }
+    const MeshCacheMaterial &material(uint32_t index) const
+    {
+        return ((const MeshCacheMaterial *)(file.data() + header().materialOffset))[index];
+    }
+    const MeshCacheTexture &texture(uint32_t index) const
+    {
+        return ((const MeshCacheTexture *)(file.data() + header().textureOffset))[index];
+    }
+    std::string textureType(uint32_t index) const
+    {
+        return stringAt(texture(index).typeOffset, texture(index).typeLength);
+    }
+    std::string texturePath(uint32_t index) const
+    {
+        return stringAt(texture(index).pathOffset, texture(index).pathLength);
+    }
+    // lodCount entries, none for a mesh stored with only the full level
+    const MeshCacheLod *lods(const MeshCacheMesh &entry) const
+    {
+        return (const MeshCacheLod *)(file.data() + header().lodOffset) + entry.firstLod;
+    }
+    const Vertex *vertices(const MeshCacheMesh &entry) const
+    {
+        return (const Vertex *)(file.data() + header().vertexOffset) + entry.firstVertex;
+    }
+    const unsigned int *indices(const MeshCacheMesh &entry) const
+    {
+        return (const unsigned int *)(file.data() + header().indexOffset) + entry.firstIndex;
+    }
+
+    // collects the meshes of an import and writes them as a cache file
+    // ------------------------------------------------------------------------
+    class Writer
+    {
+    public:
+        // materials are identified by the index the importer gave them, each is stored once
+        uint32_t addMaterial(unsigned int sourceIndex, const std::vector<Texture> &textures)
+        {
+            std::map<unsigned int, uint32_t>::iterator found = materialIds.find(sourceIndex);
+            if (found != materialIds.end())
+                return found->second;
+            MeshCacheMaterial entry;
+            entry.firstTexture = (uint32_t)textureTable.size();
+            entry.textureCount = (uint32_t)textures.size();
+            for (const Texture &texture : textures)
+            {
+                MeshCacheTexture record;
+                record.typeOffset = addString(texture.type);
+                record.typeLength = (uint32_t)texture.type.size();
+                record.pathOffset = addString(texture.path);
+                record.pathLength = (uint32_t)texture.path.size();
+                textureTable.push_back(record);
+            }
+            uint32_t id = (uint32_t)materials.size();
+            materials.push_back(entry);
+            materialIds[sourceIndex] = id;
+            return id;
+        }
+        // meshIndices holds all levels of detail, lods the ranges (MeshData layout)
+        void addMesh(const std::vector<Vertex> &meshVertices, const std::vector<unsigned int> &meshIndices, uint32_t material,
+                     const std::vector<MeshLod> &meshLods = std::vector<MeshLod>())
+        {
+            MeshCacheMesh entry;
+            memset(&entry, 0, sizeof(entry));
+            entry.firstVertex = vertices.size();
+            entry.firstIndex = indices.size();
+            entry.vertexCount = (uint32_t)meshVertices.size();
+            entry.indexCount = (uint32_t)meshIndices.size();
+            entry.material = material;
+            entry.firstLod = (uint32_t)lods.size();
+            entry.lodCount = (uint32_t)meshLods.size();
+            for (const MeshLod &level : meshLods)
+                lods.push_back({level.firstIndex, (uint32_t)level.indexCount, level.error, 0});
+            meshes.push_back(entry);
+            vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+            indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+        }
+
+        bool save(const std::string &source, uint32_t importFlags, uint32_t lodLevels = 1, uint32_t optimization = 0) const
+        {
+            MeshCacheHeader header = describe(source, importFlags, lodLevels, optimization);
+            header.meshCount = (uint32_t)meshes.size();
+            header.materialCount = (uint32_t)materials.size();
+            header.textureCount = (uint32_t)textureTable.size();
+            header.lodCount = lods.size();
+            header.vertexCount = vertices.size();
+            header.indexCount = indices.size();
+            header.stringSize = strings.size();
+            header.meshOffset = align(sizeof(MeshCacheHeader));
+            header.materialOffset = align(header.meshOffset + meshes.size() * sizeof(MeshCacheMesh));
+            header.textureOffset = align(header.materialOffset + materials.size() * sizeof(MeshCacheMaterial));
+            header.lodOffset = align(header.textureOffset + textureTable.size() * sizeof(MeshCacheTexture));
+            header.vertexOffset = align(header.lodOffset + lods.size() * sizeof(MeshCacheLod));
+            header.indexOffset = align(header.vertexOffset + vertices.size() * sizeof(Vertex));
+            header.stringOffset = align(header.indexOffset + indices.size() * sizeof(uint32_t));
+            header.fileSize = header.stringOffset + strings.size();
+
+            std::error_code error;
+            std::filesystem::create_directories(cacheDir, error);
+            // written under a temporary name first, an interrupted write never leaves a half file behind
+            std::string path = cachePath(source);
+            std::string temporary = path + ".tmp";
+            {
+                std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+                if (!out)
+                    return false;
+                writeSection(out, &header, sizeof(header), 0);
+                writeSection(out, meshes.data(), meshes.size() * sizeof(MeshCacheMesh), header.meshOffset);
+                writeSection(out, materials.data(), materials.size() * sizeof(MeshCacheMaterial), header.materialOffset);
+                writeSection(out, textureTable.data(), textureTable.size() * sizeof(MeshCacheTexture), header.textureOffset);
+                writeSection(out, lods.data(), lods.size() * sizeof(MeshCacheLod), header.lodOffset);
+                writeSection(out, vertices.data(), vertices.size() * sizeof(Vertex), header.vertexOffset);
+                writeSection(out, indices.data(), indices.size() * sizeof(uint32_t), header.indexOffset);
+                writeSection(out, strings.data(), strings.size(), header.stringOffset);
+                if (!out)
+                    return false;
+            }
+            std::filesystem::rename(temporary, path, error);
+            return !error;
+        }
+
+    private:
+        std::vector<MeshCacheMesh> meshes;
+        std::vector<MeshCacheMaterial> materials;
+        std::vector<MeshCacheTexture> textureTable;
+        std::vector<MeshCacheLod> lods;
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        std::string strings;
+        std::map<unsigned int, uint32_t> materialIds;
+
+        uint32_t addString(const std::string &text)
+        {
+            uint32_t offset = (uint32_t)strings.size();
+            strings += text;
+            return offset;
+        }
+
+        static uint64_t align(uint64_t offset)
+        {
+            return (offset + 15) & ~(uint64_t)15;
+        }
+        static void writeSection(std::ofstream &out, const void *data, size_t size, uint64_t offset)
+        {
+            static const char zeros[16] = {0};
+            uint64_t position = (uint64_t)out.tellp();
+            if (offset > position)
+                out.write(zeros, offset - position);
+            if (size > 0)
+                out.write((const char *)data, size);
+        }
+    };
+
+private:
+    MappedFile file;
+
+    std::string stringAt(uint32_t offset, uint32_t length) const
+    {
+        return std::string((const char *)file.data() + header().stringOffset + offset, length);
+    }
+
+    bool reject()
+    {
+        file.close();
+        return false;
+    }
+
+    // the header fields that identify the source and the import settings
+    static MeshCacheHeader describe(const std::string &source, uint32_t importFlags, uint32_t lodLevels, uint32_t optimization)
+    {
+        MeshCacheHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "MSHC", 4);
+        header.version = VERSION;
+        header.vertexSize = sizeof(Vertex);
+        header.importFlags = importFlags;
+        header.lodLevels = lodLevels;
+        header.optimization = optimization;
+        std::error_code error;
+        header.sourceSize = std::filesystem::file_size(source, error);
+        std::filesystem::file_time_type time = std::filesystem::last_write_time(source, error);
+        if (!error)
+            header.sourceTime = (int64_t)time.time_since_epoch().count();
+        return header;
+    }
+};
+
+#endif
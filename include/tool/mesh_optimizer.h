@@ -0,0 +1,300 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// What MeshData::optimize / Model::meshOptimization do to a mesh after import
+enum MeshOptimization
+{
+    OPTIMIZE_VERTEX_CACHE = 1, // triangle order for the post-transform vertex cache
+    OPTIMIZE_OVERDRAW = 2,     // clusters of that order sorted so the outer surfaces come first
+    OPTIMIZE_VERTEX_FETCH = 4  // vertices in the order the triangles first use them, unused ones dropped
+};
+
+// How often a triangle order makes the GPU transform a vertex, simulated with a FIFO cache
+struct VertexCacheStats
+{
+    float acmr = 0.0f; // average cache miss ratio: vertices transformed per triangle, 0.5 at best, 3 without sharing
+    float atvr = 0.0f; // average transform to vertex ratio: transformed per referenced vertex, 1 at best
+};
+
+// Reordering of indexed triangle lists for faster drawing, the triangles themselves stay the same.
+//   optimizeVertexCache()  Tipsify (Sander, Nehab, Barczak 2007): fans around the vertex that keeps the most of a
+//                          cacheSize entry FIFO useful, linear in the number of triangles
+//   optimizeOverdraw()     splits that order into clusters where it restarts anyway (or costs at most threshold
+//                          times the misses) and sorts them facing outwards first, so the depth test rejects more
+//                          of what lies behind (same paper)
+//   optimizeVertexFetch()  renumbers the vertices by first use, fetching them walks the vertex buffer forwards
+//   removeUnusedVertices() only drops the vertices no index uses, the others keep their order
+// The cache size is a guess at the hardware: 16 fits older GPUs, larger caches only profit.
+class MeshOptimizer
+{
+public:
+    static const unsigned int CACHE_SIZE = 16;
+
+    static VertexCacheStats analyze(const unsigned int *indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = CACHE_SIZE)
+    {
+        VertexCacheStats stats;
+        size_t triangleCount = indexCount / 3;
+        if (triangleCount == 0)
+            return stats;
+        // a vertex is in the FIFO while fewer than cacheSize misses happened since it was loaded
+        std::vector<size_t> loadedAt(vertexCount, 0);
+        size_t misses = 0, referenced = 0;
+        for (size_t i = 0; i < triangleCount * 3; i++)
+        {
+            unsigned int vertex = indices[i];
+            if (loadedAt[vertex] == 0)
+                referenced++;
+            if (loadedAt[vertex] == 0 || misses + 1 - loadedAt[vertex] > cacheSize)
+                loadedAt[vertex] = ++misses;
+        }
+        stats.acmr = (float)misses / (float)triangleCount;
+        stats.atvr = (float)misses / (float)referenced;
+        return stats;
+    }
+
+    // ------------------------------------------------------------------------
+    static void optimizeVertexCache(unsigned int *indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = CACHE_SIZE)
+    {
+        size_t triangleCount = indexCount / 3;
+        if (triangleCount == 0)
+            return;
+        // triangles around each vertex and how many of them are not written yet
+        std::vector<unsigned int> live(vertexCount, 0), first(vertexCount + 1, 0);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+            live[indices[i]]++;
+        for (size_t v = 0; v < vertexCount; v++)
+            first[v + 1] = first[v] + live[v];
+        std::vector<unsigned int> around(triangleCount * 3), fill(first.begin(), first.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+            around[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+        std::vector<unsigned int> output, deadEnd, candidates;
+        output.reserve(triangleCount * 3);
+        std::vector<unsigned int> timestamps(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        unsigned int time = cacheSize + 1;
+        size_t cursor = 0;
+        int64_t fan = indices[0];
+        while (fan >= 0)
+        {
+            // write every remaining triangle around the fanning vertex
+            candidates.clear();
+            for (unsigned int a = first[fan]; a < first[fan + 1]; a++)
+            {
+                unsigned int triangle = around[a];
+                if (emitted[triangle])
+                    continue;
+                emitted[triangle] = true;
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int vertex = indices[triangle * 3 + k];
+                    output.push_back(vertex);
+                    deadEnd.push_back(vertex);
+                    candidates.push_back(vertex);
+                    live[vertex]--;
+                    if (time - timestamps[vertex] > cacheSize)
+                        timestamps[vertex] = time++;
+                }
+            }
+            fan = nextFan(candidates, deadEnd, live, timestamps, time, cacheSize, cursor);
+        }
+        std::copy(output.begin(), output.end(), indices);
+    }
+
+    // positions are read with the given stride in bytes, e.g. &vertices[0].Position and sizeof(Vertex)
+    // ------------------------------------------------------------------------
+    static void optimizeOverdraw(unsigned int *indices, size_t indexCount, const glm::vec3 *positions, size_t stride, size_t vertexCount,
+                                 float threshold = 1.05f, unsigned int cacheSize = CACHE_SIZE)
+    {
+        size_t triangleCount = indexCount / 3;
+        if (triangleCount < 2)
+            return;
+        auto position = [&](unsigned int vertex) -> const glm::vec3 & {
+            return *(const glm::vec3 *)((const unsigned char *)positions + vertex * stride);
+        };
+
+        // hard boundaries: the order starts over where a triangle misses the cache with all three corners
+        std::vector<size_t> hard(1, 0);
+        {
+            std::vector<size_t> loadedAt(vertexCount, 0);
+            size_t misses = 0;
+            for (size_t t = 0; t < triangleCount; t++)
+            {
+                int missed = 0;
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int vertex = indices[t * 3 + k];
+                    if (loadedAt[vertex] == 0 || misses + 1 - loadedAt[vertex] > cacheSize)
+                    {
+                        loadedAt[vertex] = ++misses;
+                        missed++;
+                    }
+                }
+                if (missed == 3 && t > 0)
+                    hard.push_back(t);
+            }
+        }
+        hard.push_back(triangleCount);
+
+        // soft boundaries: inside a hard cluster, cut where the part so far costs at most threshold times its misses
+        std::vector<size_t> clusters;
+        for (size_t h = 0; h + 1 < hard.size(); h++)
+        {
+            size_t begin = hard[h], end = hard[h + 1];
+            float target = analyze(indices + begin * 3, (end - begin) * 3, vertexCount, cacheSize).acmr * threshold;
+            std::vector<size_t> loadedAt;
+            size_t start = begin, misses = 0;
+            clusters.push_back(begin);
+            for (size_t t = begin; t < end; t++)
+            {
+                if (t == start)
+                {
+                    loadedAt.assign(vertexCount, 0);
+                    misses = 0;
+                }
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int vertex = indices[t * 3 + k];
+                    if (loadedAt[vertex] == 0 || misses + 1 - loadedAt[vertex] > cacheSize)
+                        loadedAt[vertex] = ++misses;
+                }
+                if (t + 1 < end && (float)misses / (float)(t + 1 - start) <= target)
+                {
+                    start = t + 1;
+                    clusters.push_back(start);
+                }
+            }
+        }
+        clusters.push_back(triangleCount);
+
+        // sort the clusters by how far their area weighted center lies out along their normal
+        glm::dvec3 meshCenter(0.0);
+        double meshArea = 0.0;
+        std::vector<glm::dvec3> centers(clusters.size() - 1), normals(clusters.size() - 1);
+        for (size_t c = 0; c + 1 < clusters.size(); c++)
+        {
+            glm::dvec3 center(0.0), normal(0.0);
+            double area = 0.0;
+            for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+            {
+                glm::dvec3 a = position(indices[t * 3]), b = position(indices[t * 3 + 1]), d = position(indices[t * 3 + 2]);
+                glm::dvec3 cross = glm::cross(b - a, d - a);
+                double triangleArea = glm::length(cross) * 0.5;
+                center += (a + b + d) * (triangleArea / 3.0);
+                normal += cross;
+                area += triangleArea;
+            }
+            meshCenter += center;
+            meshArea += area;
+            centers[c] = area > 0.0 ? center / area : glm::dvec3(position(indices[clusters[c] * 3]));
+            normals[c] = glm::length(normal) > 0.0 ? glm::normalize(normal) : glm::dvec3(0.0);
+        }
+        if (meshArea > 0.0)
+            meshCenter /= meshArea;
+        std::vector<double> keys(centers.size());
+        std::vector<size_t> order(centers.size());
+        for (size_t c = 0; c < centers.size(); c++)
+        {
+            keys[c] = glm::dot(centers[c] - meshCenter, normals[c]);
+            order[c] = c;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+        std::vector<unsigned int> sorted;
+        sorted.reserve(triangleCount * 3);
+        for (size_t c : order)
+            sorted.insert(sorted.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+        std::copy(sorted.begin(), sorted.end(), indices);
+    }
+
+    // vertices are reordered in place and the ones no index uses removed, returns how many are left
+    // ------------------------------------------------------------------------
+    template <typename VertexType>
+    static size_t optimizeVertexFetch(std::vector<VertexType> &vertices, unsigned int *indices, size_t indexCount)
+    {
+        const unsigned int UNUSED = ~0u;
+        std::vector<unsigned int> remap(vertices.size(), UNUSED);
+        std::vector<VertexType> ordered;
+        ordered.reserve(vertices.size());
+        for (size_t i = 0; i < indexCount; i++)
+        {
+            unsigned int &vertex = remap[indices[i]];
+            if (vertex == UNUSED)
+            {
+                vertex = (unsigned int)ordered.size();
+                ordered.push_back(vertices[indices[i]]);
+            }
+            indices[i] = vertex;
+        }
+        vertices.swap(ordered);
+        return vertices.size();
+    }
+
+    // vertices no index uses are removed in place, the indices renumbered; returns how many are left
+    // ------------------------------------------------------------------------
+    template <typename VertexType>
+    static size_t removeUnusedVertices(std::vector<VertexType> &vertices, unsigned int *indices, size_t indexCount)
+    {
+        const unsigned int UNUSED = ~0u;
+        std::vector<unsigned int> remap(vertices.size(), UNUSED);
+        for (size_t i = 0; i < indexCount; i++)
+            remap[indices[i]] = 0;
+        size_t kept = 0;
+        for (size_t i = 0; i < vertices.size(); i++)
+            if (remap[i] != UNUSED)
+            {
+                remap[i] = (unsigned int)kept;
+                vertices[kept++] = vertices[i];
+            }
+        vertices.resize(kept);
+        for (size_t i = 0; i < indexCount; i++)
+            indices[i] = remap[indices[i]];
+        return kept;
+    }
+
+private:
+    // the candidate that stays in the cache longest while its remaining triangles are written, else the most
+    // recent vertex that still has some, else the next one in vertex order; -1 when everything is written
+    static int64_t nextFan(const std::vector<unsigned int> &candidates, std::vector<unsigned int> &deadEnd, const std::vector<unsigned int> &live,
+                           const std::vector<unsigned int> &timestamps, unsigned int time, unsigned int cacheSize, size_t &cursor)
+    {
+        int64_t best = -1;
+        int bestPriority = -1;
+        for (unsigned int vertex : candidates)
+        {
+            if (live[vertex] == 0)
+                continue;
+            int priority = 0;
+            if (time - timestamps[vertex] + 2 * live[vertex] <= cacheSize)
+                priority = (int)(time - timestamps[vertex]);
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                best = vertex;
+            }
+        }
+        if (best >= 0)
+            return best;
+        while (!deadEnd.empty())
+        {
+            unsigned int vertex = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[vertex] > 0)
+                return vertex;
+        }
+        for (; cursor < live.size(); cursor++)
+            if (live[cursor] > 0)
+                return (int64_t)cursor;
+        return -1;
+    }
+};
+
+#endif
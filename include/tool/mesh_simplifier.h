@@ -0,0 +1,393 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <queue>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Quadric error simplification (Garland & Heckbert) for building discrete levels of detail of a triangle mesh.
+// Edges are collapsed onto one of their ends (half edge collapse), so the simplified triangles still reference
+// vertices of the original vertex buffer: all levels share it and only the index ranges differ.
+// The topology is built on vertices welded by position. Where a position has several vertices (a UV or normal seam)
+// it only slides along the seam, taking each of its vertices to the vertex of the same side at the other end; vertices
+// on open borders only slide along the border, and collapses that flip a triangle or would make the surface non
+// manifold are skipped, so a level may end above the requested size.
+//   simplify(target, out)  collapse the cheapest edges until at most target indices remain and write them to out;
+//                          returns the largest error of a collapse so far, as a distance in model units.
+//                          Call it again with a lower target for the next level, the work continues from there.
+class MeshSimplifier
+{
+public:
+    // positions are read with the given stride in bytes, e.g. &vertices[0].Position and sizeof(Vertex)
+    MeshSimplifier(const glm::vec3 *positions, size_t vertexCount, size_t stride, const unsigned int *indices, size_t indexCount)
+        : corners(indices, indices + indexCount - indexCount % 3)
+    {
+        // weld by position, the first vertex of a position stands for all of them
+        remap.resize(vertexCount);
+        std::unordered_map<PositionKey, unsigned int, PositionHash> welded;
+        welded.reserve(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            const glm::vec3 &position = *(const glm::vec3 *)((const unsigned char *)positions + i * stride);
+            std::pair<std::unordered_map<PositionKey, unsigned int, PositionHash>::iterator, bool> found =
+                welded.insert({PositionKey{position.x, position.y, position.z}, (unsigned int)points.size()});
+            if (found.second)
+                points.push_back(position);
+            remap[i] = found.first->second;
+        }
+        size_t pointCount = points.size();
+        flags.assign(pointCount, 0);
+        quadrics.assign(pointCount, Quadric());
+        versions.assign(pointCount, 0);
+        pointTriangles.resize(pointCount);
+
+        size_t triangleCount = corners.size() / 3;
+        removed.assign(triangleCount, false);
+        std::unordered_map<uint64_t, Edge> edges;
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            unsigned int a = point(t, 0), b = point(t, 1), c = point(t, 2);
+            if (a == b || b == c || c == a)
+            {
+                removed[t] = true;
+                continue;
+            }
+            liveTriangles++;
+            for (int k = 0; k < 3; k++)
+            {
+                pointTriangles[point(t, k)].push_back((unsigned int)t);
+                // the vertices at both ends, ordered by point: a second triangle using other ones is across a seam
+                unsigned int from = corners[t * 3 + k], to = corners[t * 3 + (k + 1) % 3];
+                if (remap[from] > remap[to])
+                    std::swap(from, to);
+                Edge &edge = edges[edgeKey(remap[from], remap[to])];
+                if (edge.uses++ == 0)
+                {
+                    edge.triangle = (unsigned int)t;
+                    edge.from = from;
+                    edge.to = to;
+                }
+                else if (edge.from != from || edge.to != to)
+                    edge.seam = true;
+            }
+            // plane of the triangle weighted by its area
+            glm::dvec3 p0 = points[a], p1 = points[b], p2 = points[c];
+            glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+            double area = glm::length(normal) * 0.5;
+            if (area <= 0.0)
+                continue;
+            normal = glm::normalize(normal);
+            Quadric plane = Quadric::plane(normal, -glm::dot(normal, p0), area);
+            quadrics[a].add(plane);
+            quadrics[b].add(plane);
+            quadrics[c].add(plane);
+        }
+
+        // edges of one triangle are open borders, of more than two are not manifold.
+        // a plane through a border or seam edge, perpendicular to the triangle, keeps the outline and the seam in place
+        for (const std::pair<const uint64_t, Edge> &entry : edges)
+        {
+            const Edge &edge = entry.second;
+            unsigned int from = remap[edge.from], to = remap[edge.to];
+            if (edge.uses > 2)
+            {
+                flags[from] |= LOCKED;
+                flags[to] |= LOCKED;
+                continue;
+            }
+            if (edge.uses == 1)
+            {
+                flags[from] |= BORDER;
+                flags[to] |= BORDER;
+            }
+            else if (!edge.seam)
+                continue;
+            unsigned int opposite = point(edge.triangle, 0) + point(edge.triangle, 1) + point(edge.triangle, 2) - from - to;
+            glm::dvec3 p0 = points[from], p1 = points[to], p2 = points[opposite];
+            glm::dvec3 direction = p1 - p0;
+            glm::dvec3 normal = glm::cross(direction, glm::cross(direction, p2 - p0));
+            double length = glm::length(normal);
+            if (length <= 0.0)
+                continue;
+            normal /= length;
+            Quadric constraint = Quadric::plane(normal, -glm::dot(normal, p0), glm::dot(direction, direction) * EDGE_WEIGHT);
+            quadrics[from].add(constraint);
+            quadrics[to].add(constraint);
+        }
+
+        for (size_t t = 0; t < triangleCount; t++)
+            if (!removed[t])
+                for (int k = 0; k < 3; k++)
+                    pushCandidate(point(t, k), point(t, (k + 1) % 3));
+    }
+
+    float simplify(size_t targetIndexCount, std::vector<unsigned int> &out)
+    {
+        while (liveTriangles * 3 > targetIndexCount && !candidates.empty())
+        {
+            Candidate candidate = candidates.top();
+            candidates.pop();
+            if (versions[candidate.from] != candidate.fromVersion || versions[candidate.to] != candidate.toVersion)
+                continue;
+            if (collapse(candidate.from, candidate.to))
+                maxError = std::max(maxError, candidate.cost);
+        }
+        out.clear();
+        out.reserve(liveTriangles * 3);
+        for (size_t t = 0; t < removed.size(); t++)
+            if (!removed[t])
+                out.insert(out.end(), corners.begin() + t * 3, corners.begin() + t * 3 + 3);
+        return (float)std::sqrt(maxError);
+    }
+
+    size_t triangles() const
+    {
+        return liveTriangles;
+    }
+
+private:
+    enum Flags
+    {
+        BORDER = 1,   // only moves along the border
+        LOCKED = 2,   // never moves (non manifold)
+        COLLAPSED = 4 // moved onto a neighbour, gone
+    };
+
+    // border and seam planes count this much more than surface planes of the same area
+    static constexpr double EDGE_WEIGHT = 10.0;
+    // collapses turning a triangle further than this (cosine between the normals) are rejected
+    static constexpr double MIN_NORMAL_COSINE = 0.2;
+
+    struct Edge
+    {
+        unsigned int uses = 0;
+        unsigned int triangle = 0;   // the first triangle using it
+        unsigned int from = 0, to = 0; // vertices of the first triangle at the ends
+        bool seam = false;
+    };
+
+    // plane distance squared summed over planes, a symmetric 4x4 matrix as 10 values, plus the total weight
+    struct Quadric
+    {
+        double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0, b0 = 0, b1 = 0, b2 = 0, c = 0, weight = 0;
+
+        static Quadric plane(const glm::dvec3 &n, double d, double weight)
+        {
+            Quadric q;
+            q.a00 = n.x * n.x * weight;
+            q.a01 = n.x * n.y * weight;
+            q.a02 = n.x * n.z * weight;
+            q.a11 = n.y * n.y * weight;
+            q.a12 = n.y * n.z * weight;
+            q.a22 = n.z * n.z * weight;
+            q.b0 = n.x * d * weight;
+            q.b1 = n.y * d * weight;
+            q.b2 = n.z * d * weight;
+            q.c = d * d * weight;
+            q.weight = weight;
+            return q;
+        }
+        void add(const Quadric &q)
+        {
+            a00 += q.a00, a01 += q.a01, a02 += q.a02, a11 += q.a11, a12 += q.a12, a22 += q.a22;
+            b0 += q.b0, b1 += q.b1, b2 += q.b2, c += q.c, weight += q.weight;
+        }
+        // weighted mean of the squared distances of p to the planes
+        double error(const glm::dvec3 &p) const
+        {
+            double sum = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z + 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z) +
+                         2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+            return weight > 0.0 ? std::max(sum, 0.0) / weight : 0.0;
+        }
+    };
+
+    struct Candidate
+    {
+        double cost;
+        unsigned int from, to;
+        unsigned int fromVersion, toVersion;
+        bool operator>(const Candidate &other) const
+        {
+            return cost > other.cost;
+        }
+    };
+
+    struct PositionKey
+    {
+        float x, y, z;
+        bool operator==(const PositionKey &other) const
+        {
+            return x == other.x && y == other.y && z == other.z;
+        }
+    };
+    struct PositionHash
+    {
+        size_t operator()(const PositionKey &key) const
+        {
+            std::hash<float> hash;
+            return hash(key.x) * 73856093u ^ hash(key.y) * 19349663u ^ hash(key.z) * 83492791u;
+        }
+    };
+
+    std::vector<unsigned int> corners;       // the triangles, as indices of the original vertices
+    std::vector<bool> removed;               // per triangle
+    std::vector<unsigned int> remap;         // vertex -> welded point
+    std::vector<glm::vec3> points;           // welded positions
+    std::vector<unsigned char> flags;        // per point
+    std::vector<Quadric> quadrics;           // per point
+    std::vector<unsigned int> versions;      // per point, bumped when its candidates go stale
+    std::vector<std::vector<unsigned int>> pointTriangles; // triangles around each point, removed ones included
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+    size_t liveTriangles = 0;
+    double maxError = 0.0;
+
+    unsigned int point(size_t triangle, int corner) const
+    {
+        return remap[corners[triangle * 3 + corner]];
+    }
+    static uint64_t edgeKey(unsigned int a, unsigned int b)
+    {
+        return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+    }
+
+    void pushCandidate(unsigned int from, unsigned int to)
+    {
+        if (flags[from] & (LOCKED | COLLAPSED))
+            return;
+        Quadric sum = quadrics[from];
+        sum.add(quadrics[to]);
+        candidates.push({sum.error(points[to]), from, to, versions[from], versions[to]});
+    }
+
+    static unsigned int partner(const std::vector<std::pair<unsigned int, unsigned int>> &partners, unsigned int vertex)
+    {
+        for (const std::pair<unsigned int, unsigned int> &pair : partners)
+            if (pair.first == vertex)
+                return pair.second;
+        return UINT32_MAX;
+    }
+
+    bool contains(size_t triangle, unsigned int p) const
+    {
+        return point(triangle, 0) == p || point(triangle, 1) == p || point(triangle, 2) == p;
+    }
+
+    // move point from onto point to, false when the collapse is not allowed
+    bool collapse(unsigned int from, unsigned int to)
+    {
+        // the triangles on the edge disappear. each of them pairs a vertex of the moving end with the vertex of the same
+        // side at the other end; every vertex of the moving end needs exactly one such partner, otherwise the collapse
+        // would move a seam corner or drag a seam across the surface
+        unsigned int shared = 0;
+        std::vector<std::pair<unsigned int, unsigned int>> partners;
+        std::vector<unsigned int> fromNeighbours, toNeighbours;
+        for (unsigned int t : pointTriangles[from])
+        {
+            if (removed[t])
+                continue;
+            for (int k = 0; k < 3; k++)
+                fromNeighbours.push_back(point(t, k));
+            if (!contains(t, to))
+                continue;
+            shared++;
+            unsigned int fromVertex = 0, toVertex = 0;
+            for (int k = 0; k < 3; k++)
+            {
+                if (point(t, k) == from)
+                    fromVertex = corners[t * 3 + k];
+                else if (point(t, k) == to)
+                    toVertex = corners[t * 3 + k];
+            }
+            partners.push_back({fromVertex, toVertex});
+        }
+        if (shared == 0 || ((flags[from] & BORDER) && shared != 1))
+            return false;
+        std::sort(partners.begin(), partners.end());
+        partners.erase(std::unique(partners.begin(), partners.end()), partners.end());
+        for (size_t i = 1; i < partners.size(); i++)
+            if (partners[i].first == partners[i - 1].first)
+                return false;
+        for (unsigned int t : pointTriangles[from])
+            if (!removed[t])
+                for (int k = 0; k < 3; k++)
+                    if (point(t, k) == from && partner(partners, corners[t * 3 + k]) == UINT32_MAX)
+                        return false;
+
+        for (unsigned int t : pointTriangles[to])
+            if (!removed[t])
+                for (int k = 0; k < 3; k++)
+                    toNeighbours.push_back(point(t, k));
+        // link condition: the two ends may only share the neighbours across the collapsed triangles
+        std::sort(fromNeighbours.begin(), fromNeighbours.end());
+        fromNeighbours.erase(std::unique(fromNeighbours.begin(), fromNeighbours.end()), fromNeighbours.end());
+        std::sort(toNeighbours.begin(), toNeighbours.end());
+        toNeighbours.erase(std::unique(toNeighbours.begin(), toNeighbours.end()), toNeighbours.end());
+        std::vector<unsigned int> common;
+        std::set_intersection(fromNeighbours.begin(), fromNeighbours.end(), toNeighbours.begin(), toNeighbours.end(), std::back_inserter(common));
+        if (common.size() != shared + 2) // both ends are in both lists
+            return false;
+
+        // no remaining triangle may flip or collapse to a sliver
+        glm::dvec3 target = points[to];
+        for (unsigned int t : pointTriangles[from])
+        {
+            if (removed[t] || contains(t, to))
+                continue;
+            glm::dvec3 before[3], after[3];
+            for (int k = 0; k < 3; k++)
+            {
+                before[k] = points[point(t, k)];
+                after[k] = point(t, k) == from ? target : before[k];
+            }
+            glm::dvec3 oldNormal = glm::cross(before[1] - before[0], before[2] - before[0]);
+            glm::dvec3 newNormal = glm::cross(after[1] - after[0], after[2] - after[0]);
+            double oldLength = glm::length(oldNormal), newLength = glm::length(newNormal);
+            if (newLength <= 0.0 || glm::dot(oldNormal, newNormal) < MIN_NORMAL_COSINE * oldLength * newLength)
+                return false;
+        }
+
+        for (unsigned int t : pointTriangles[from])
+        {
+            if (removed[t])
+                continue;
+            if (contains(t, to))
+            {
+                removed[t] = true;
+                liveTriangles--;
+                continue;
+            }
+            for (int k = 0; k < 3; k++)
+                if (point(t, k) == from)
+                    corners[t * 3 + k] = partner(partners, corners[t * 3 + k]);
+            pointTriangles[to].push_back(t);
+        }
+        quadrics[to].add(quadrics[from]);
+        flags[from] |= COLLAPSED;
+        versions[from]++;
+        versions[to]++;
+        std::vector<unsigned int>().swap(pointTriangles[from]);
+        // drop the removed triangles from the list of the surviving end and offer its edges again
+        std::vector<unsigned int> &around = pointTriangles[to];
+        around.erase(std::remove_if(around.begin(), around.end(), [&](unsigned int t) { return removed[t]; }), around.end());
+        toNeighbours.insert(toNeighbours.end(), fromNeighbours.begin(), fromNeighbours.end());
+        std::sort(toNeighbours.begin(), toNeighbours.end());
+        toNeighbours.erase(std::unique(toNeighbours.begin(), toNeighbours.end()), toNeighbours.end());
+        for (unsigned int neighbour : toNeighbours)
+        {
+            if (neighbour == to || neighbour == from)
+                continue;
+            pushCandidate(to, neighbour);
+            pushCandidate(neighbour, to);
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,571 @@
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+#include <tool/thread_pool.h>
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIPMAP_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define MIPMAP_AVX2
+#include <immintrin.h>
+#endif
+
+// What the pixels of a texture mean, decides how its mip levels are filtered
+enum TextureKind
+{
+    TEXTURE_COLOR,  // sRGB colors (albedo, diffuse): averaged in linear light
+    TEXTURE_DATA,   // plain values (roughness, metallic, ao, height): averaged as stored
+    TEXTURE_NORMAL  // tangent space normals in rgb: averaged, then rescaled to unit length
+};
+
+// How a level is reduced to the next one
+enum MipFilter
+{
+    MIP_BOX,   // average of 2x2 texels, cheap, slightly blurry
+    MIP_KAISER // separable Kaiser windowed sinc over 3 texels of the smaller level, sharper; clamps at the edges
+};
+
+struct MipLevel
+{
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels; // RGBA8, rows tightly packed
+};
+
+struct MipLevelFloat
+{
+    int width = 0;
+    int height = 0;
+    std::vector<float> pixels; // RGBA32F, rows tightly packed
+};
+
+// Builds the full mip chain of an RGBA8 or RGBA32F image on the CPU, level 0 is the image itself.
+//   MIP_BOX     2x2 average, odd sizes drop the last row/column like glGenerateMipmap. Rows are filtered with SSE2
+//               (AVX2 when the build enables it, -mavx2)
+//   MIP_KAISER  windowed sinc (alpha 4), rows then columns through a float buffer, taps summed with SSE2. Rings a
+//               little at hard edges, results are clamped to the range of the format
+// With a ThreadPool the rows of a level are spread over the workers.
+// Float images are taken as linear, TEXTURE_COLOR only changes how 8 bit images are averaged.
+class MipChain
+{
+public:
+    static std::vector<MipLevel> build(const unsigned char *rgba, int width, int height, TextureKind kind, ThreadPool *pool = nullptr, MipFilter filter = MIP_BOX)
+    {
+        std::vector<MipLevel> levels(1);
+        levels[0].width = width;
+        levels[0].height = height;
+        levels[0].pixels.assign(rgba, rgba + (size_t)width * height * 4);
+        while (levels.back().width > 1 || levels.back().height > 1)
+            levels.push_back(downsample(levels.back(), kind, pool, filter));
+        return levels;
+    }
+    static std::vector<MipLevelFloat> build(const float *rgba, int width, int height, TextureKind kind, ThreadPool *pool = nullptr, MipFilter filter = MIP_BOX)
+    {
+        std::vector<MipLevelFloat> levels(1);
+        levels[0].width = width;
+        levels[0].height = height;
+        levels[0].pixels.assign(rgba, rgba + (size_t)width * height * 4);
+        while (levels.back().width > 1 || levels.back().height > 1)
+            levels.push_back(downsample(levels.back(), kind, pool, filter));
+        return levels;
+    }
+
+    // RGBA8 chain stored back to back, level 0 first: chain holds chainBytes() and starts with the image,
+    // the other levels are filtered in place behind it. Used for staging memory that goes to GL as it is.
+    static void buildInPlace(unsigned char *chain, int width, int height, TextureKind kind, ThreadPool *pool = nullptr, MipFilter filter = MIP_BOX)
+    {
+        while (width > 1 || height > 1)
+        {
+            unsigned char *next = chain + (size_t)width * height * 4;
+            downsample(chain, width, height, next, kind, pool, filter);
+            chain = next;
+            width = std::max(width / 2, 1);
+            height = std::max(height / 2, 1);
+        }
+    }
+    static size_t chainBytes(int width, int height)
+    {
+        size_t bytes = 0;
+        for (int i = levelCount(width, height); i > 0; i--)
+        {
+            bytes += (size_t)width * height * 4;
+            width = std::max(width / 2, 1);
+            height = std::max(height / 2, 1);
+        }
+        return bytes;
+    }
+
+    static int levelCount(int width, int height)
+    {
+        int count = 1;
+        while (width > 1 || height > 1)
+        {
+            width = std::max(width / 2, 1);
+            height = std::max(height / 2, 1);
+            count++;
+        }
+        return count;
+    }
+
+    static MipLevel downsample(const MipLevel &source, TextureKind kind, ThreadPool *pool = nullptr, MipFilter filter = MIP_BOX)
+    {
+        MipLevel level;
+        level.width = std::max(source.width / 2, 1);
+        level.height = std::max(source.height / 2, 1);
+        level.pixels.resize((size_t)level.width * level.height * 4);
+        downsample(source.pixels.data(), source.width, source.height, level.pixels.data(), kind, pool, filter);
+        return level;
+    }
+    // RGBA8 source into target, which holds max(width / 2, 1) x max(height / 2, 1) pixels
+    static void downsample(const unsigned char *source, int width, int height, unsigned char *target, TextureKind kind, ThreadPool *pool = nullptr,
+                           MipFilter filter = MIP_BOX)
+    {
+        int targetWidth = std::max(width / 2, 1);
+        if (filter == MIP_KAISER)
+        {
+            // colors in linear light like the box filter, the table holds value / 255 for alpha and other kinds
+            const float *toLinear = linearTable();
+            const unsigned char *toSrgb = srgbTable();
+            const int table[4] = {kind == TEXTURE_COLOR ? 0 : 768, kind == TEXTURE_COLOR ? 256 : 768, kind == TEXTURE_COLOR ? 512 : 768, 768};
+            kaiserFilter(
+                width, height,
+                [&](int y, float *row) {
+                    const unsigned char *texels = source + (size_t)y * width * 4;
+                    for (int i = 0; i < width * 4; i++)
+                        row[i] = toLinear[table[i & 3] + texels[i]];
+                },
+                [&](int y, float *row) {
+                    unsigned char *texels = target + (size_t)y * targetWidth * 4;
+                    for (int x = 0; x < targetWidth; x++)
+                    {
+                        float *texel = row + x * 4;
+                        if (kind == TEXTURE_NORMAL)
+                        {
+                            for (int c = 0; c < 3; c++)
+                                texel[c] = std::min(std::max(texel[c], 0.0f), 1.0f);
+                            renormalize(texel);
+                        }
+                        for (int c = 0; c < 4; c++)
+                            texels[x * 4 + c] = kind == TEXTURE_COLOR && c < 3 ? toSrgb[(int)(std::min(std::max(texel[c], 0.0f), 1.0f) * (SRGB_STEPS - 1) + 0.5f)]
+                                                                               : toByte(texel[c]);
+                    }
+                },
+                pool);
+            return;
+        }
+        forEachRow(std::max(height / 2, 1), pool, [&](int y) {
+            const unsigned char *row0 = source + (size_t)std::min(y * 2, height - 1) * width * 4;
+            const unsigned char *row1 = source + (size_t)std::min(y * 2 + 1, height - 1) * width * 4;
+            unsigned char *row = target + (size_t)y * targetWidth * 4;
+            if (width == 1)
+                filterColumn(row0, row1, row, kind);
+            else if (kind == TEXTURE_COLOR)
+                filterColorRow(row0, row1, row, targetWidth);
+            else
+                filterDataRow(row0, row1, row, targetWidth, kind == TEXTURE_NORMAL);
+        });
+    }
+
+    static MipLevelFloat downsample(const MipLevelFloat &source, TextureKind kind, ThreadPool *pool = nullptr, MipFilter filter = MIP_BOX)
+    {
+        MipLevelFloat level;
+        level.width = std::max(source.width / 2, 1);
+        level.height = std::max(source.height / 2, 1);
+        level.pixels.resize((size_t)level.width * level.height * 4);
+        if (filter == MIP_KAISER)
+        {
+            kaiserFilter(
+                source.width, source.height,
+                [&](int y, float *row) { memcpy(row, &source.pixels[(size_t)y * source.width * 4], (size_t)source.width * 4 * sizeof(float)); },
+                [&](int y, float *row) {
+                    float *texels = &level.pixels[(size_t)y * level.width * 4];
+                    for (int x = 0; x < level.width; x++)
+                    {
+                        float *texel = row + x * 4;
+                        // no negative light from the lobes of the sinc
+                        for (int c = 0; kind == TEXTURE_COLOR && c < 3; c++)
+                            texel[c] = std::max(texel[c], 0.0f);
+                        if (kind == TEXTURE_NORMAL)
+                            renormalize(texel);
+                    }
+                    memcpy(texels, row, (size_t)level.width * 4 * sizeof(float));
+                },
+                pool);
+            return level;
+        }
+        forEachRow(level.height, pool, [&](int y) {
+            const float *row0 = &source.pixels[(size_t)std::min(y * 2, source.height - 1) * source.width * 4];
+            const float *row1 = &source.pixels[(size_t)std::min(y * 2 + 1, source.height - 1) * source.width * 4];
+            float *target = &level.pixels[(size_t)y * level.width * 4];
+            filterFloatRow(row0, row1, target, level.width, source.width == 1 ? 0 : 4, kind == TEXTURE_NORMAL);
+        });
+        return level;
+    }
+
+private:
+    // rows of small levels are not worth handing out
+    template <typename Body>
+    static void forEachRow(int rows, ThreadPool *pool, const Body &body)
+    {
+        if (pool != nullptr && rows >= 64)
+            pool->parallelFor((size_t)rows, [&](size_t y) { body((int)y); });
+        else
+            for (int y = 0; y < rows; y++)
+                body(y);
+    }
+
+    // Kaiser window over KAISER_RADIUS texels of the smaller level on each side, the sinc is in those texels too
+    static constexpr float KAISER_RADIUS = 3.0f;
+    static constexpr float KAISER_ALPHA = 4.0f;
+
+    // for every target texel the clamped source indices and normalized weights, count of each
+    struct KaiserTaps
+    {
+        int count = 0;
+        std::vector<int> index;
+        std::vector<float> weight;
+    };
+    static KaiserTaps kaiserTaps(int sourceSize, int targetSize)
+    {
+        KaiserTaps taps;
+        float scale = (float)sourceSize / (float)targetSize; // 2, a bit more for odd sizes, 1 for a side that stays 1
+        taps.count = (int)std::ceil(KAISER_RADIUS * scale) * 2 + 1;
+        taps.index.resize((size_t)targetSize * taps.count);
+        taps.weight.resize((size_t)targetSize * taps.count);
+        for (int x = 0; x < targetSize; x++)
+        {
+            float center = (x + 0.5f) * scale;
+            int first = (int)std::floor(center - KAISER_RADIUS * scale);
+            float total = 0.0f;
+            for (int k = 0; k < taps.count; k++)
+            {
+                int i = first + k;
+                float t = (i + 0.5f - center) / scale;
+                float weight = 0.0f;
+                if (std::fabs(t) < KAISER_RADIUS)
+                {
+                    float ratio = t / KAISER_RADIUS;
+                    weight = sinc(t) * besselI0(KAISER_ALPHA * std::sqrt(1.0f - ratio * ratio)) / besselI0(KAISER_ALPHA);
+                }
+                taps.index[(size_t)x * taps.count + k] = std::min(std::max(i, 0), sourceSize - 1);
+                taps.weight[(size_t)x * taps.count + k] = weight;
+                total += weight;
+            }
+            for (int k = 0; k < taps.count; k++)
+                taps.weight[(size_t)x * taps.count + k] /= total;
+        }
+        return taps;
+    }
+    static float sinc(float x)
+    {
+        const float pi = 3.14159265358979f;
+        return std::fabs(x) < 1e-6f ? 1.0f : std::sin(pi * x) / (pi * x);
+    }
+    // modified Bessel function of the first kind, order 0, as a power series
+    static float besselI0(float x)
+    {
+        float sum = 1.0f, term = 1.0f, quarter = x * x * 0.25f;
+        for (int k = 1; k < 32 && term > sum * 1e-8f; k++)
+        {
+            term *= quarter / (float)(k * k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    // weighted sum of RGBA texels base[index[k] * stride]
+    static void convolve(const float *base, size_t stride, const int *index, const float *weight, int count, float *target)
+    {
+#ifdef MIPMAP_SSE2
+        __m128 sum = _mm_setzero_ps();
+        for (int k = 0; k < count; k++)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(base + index[k] * stride), _mm_set1_ps(weight[k])));
+        _mm_storeu_ps(target, sum);
+#else
+        float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (int k = 0; k < count; k++)
+            for (int c = 0; c < 4; c++)
+                sum[c] += base[index[k] * stride + c] * weight[k];
+        memcpy(target, sum, sizeof(sum));
+#endif
+    }
+
+    // decode(y, row) fills source row y as width RGBA floats, encode(y, row) stores target row y from the filtered
+    // floats (and may change them); rows are filtered first, into a buffer of height x targetWidth texels
+    template <typename Decode, typename Encode>
+    static void kaiserFilter(int width, int height, const Decode &decode, const Encode &encode, ThreadPool *pool)
+    {
+        int targetWidth = std::max(width / 2, 1), targetHeight = std::max(height / 2, 1);
+        KaiserTaps columns = kaiserTaps(width, targetWidth), rows = kaiserTaps(height, targetHeight);
+        std::vector<float> filtered((size_t)height * targetWidth * 4);
+        forEachRow(height, pool, [&](int y) {
+            thread_local std::vector<float> row;
+            row.resize((size_t)width * 4);
+            decode(y, row.data());
+            for (int x = 0; x < targetWidth; x++)
+                convolve(row.data(), 4, &columns.index[(size_t)x * columns.count], &columns.weight[(size_t)x * columns.count], columns.count,
+                         &filtered[((size_t)y * targetWidth + x) * 4]);
+        });
+        forEachRow(targetHeight, pool, [&](int y) {
+            thread_local std::vector<float> row;
+            row.resize((size_t)targetWidth * 4);
+            for (int x = 0; x < targetWidth; x++)
+                convolve(&filtered[(size_t)x * 4], (size_t)targetWidth * 4, &rows.index[(size_t)y * rows.count], &rows.weight[(size_t)y * rows.count], rows.count,
+                         &row[(size_t)x * 4]);
+            encode(y, row.data());
+        });
+    }
+
+    // 1 pixel wide source, both "columns" are the same pixel
+    static void filterColumn(const unsigned char *row0, const unsigned char *row1, unsigned char *target, TextureKind kind)
+    {
+        unsigned char texels[8];
+        memcpy(texels, row0, 4);
+        memcpy(texels + 4, row1, 4);
+        unsigned char wide0[8], wide1[8];
+        memcpy(wide0, texels, 4);
+        memcpy(wide0 + 4, texels, 4);
+        memcpy(wide1, texels + 4, 4);
+        memcpy(wide1 + 4, texels + 4, 4);
+        if (kind == TEXTURE_COLOR)
+            filterColorRow(wide0, wide1, target, 1);
+        else
+            filterDataRow(wide0, wide1, target, 1, kind == TEXTURE_NORMAL);
+    }
+
+    // data rows: plain average with rounding, normal rows: average rescaled to unit length
+    // ------------------------------------------------------------------------
+    static void filterDataRow(const unsigned char *row0, const unsigned char *row1, unsigned char *target, int width, bool normalize)
+    {
+        int x = 0;
+#ifdef MIPMAP_AVX2
+        if (!normalize)
+        {
+            // 8 output pixels from 16 source pixels of each row
+            const __m256i zero = _mm256_setzero_si256(), two = _mm256_set1_epi16(2);
+            for (; x + 8 <= width; x += 8)
+            {
+                __m256i a0 = _mm256_loadu_si256((const __m256i *)(row0 + x * 8));
+                __m256i a1 = _mm256_loadu_si256((const __m256i *)(row0 + x * 8 + 32));
+                __m256i b0 = _mm256_loadu_si256((const __m256i *)(row1 + x * 8));
+                __m256i b1 = _mm256_loadu_si256((const __m256i *)(row1 + x * 8 + 32));
+                // per 128 bit lane: low = pixels 0,1 high = pixels 2,3 as 16 bit channels
+                __m256i low0 = _mm256_add_epi16(_mm256_unpacklo_epi8(a0, zero), _mm256_unpacklo_epi8(b0, zero));
+                __m256i high0 = _mm256_add_epi16(_mm256_unpackhi_epi8(a0, zero), _mm256_unpackhi_epi8(b0, zero));
+                __m256i low1 = _mm256_add_epi16(_mm256_unpacklo_epi8(a1, zero), _mm256_unpacklo_epi8(b1, zero));
+                __m256i high1 = _mm256_add_epi16(_mm256_unpackhi_epi8(a1, zero), _mm256_unpackhi_epi8(b1, zero));
+                __m256i sum0 = _mm256_add_epi16(_mm256_unpacklo_epi64(low0, high0), _mm256_unpackhi_epi64(low0, high0));
+                __m256i sum1 = _mm256_add_epi16(_mm256_unpacklo_epi64(low1, high1), _mm256_unpackhi_epi64(low1, high1));
+                sum0 = _mm256_srli_epi16(_mm256_add_epi16(sum0, two), 2);
+                sum1 = _mm256_srli_epi16(_mm256_add_epi16(sum1, two), 2);
+                // packus works per lane: (sum0.lo, sum1.lo, sum0.hi, sum1.hi), put the quarters back in order
+                __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(sum0, sum1), 0xD8);
+                _mm256_storeu_si256((__m256i *)(target + x * 4), packed);
+            }
+        }
+#endif
+#ifdef MIPMAP_SSE2
+        // 4 output pixels from 8 source pixels of each row
+        const __m128i zero = _mm_setzero_si128(), two = _mm_set1_epi16(2);
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i a0 = _mm_loadu_si128((const __m128i *)(row0 + x * 8));
+            __m128i a1 = _mm_loadu_si128((const __m128i *)(row0 + x * 8 + 16));
+            __m128i b0 = _mm_loadu_si128((const __m128i *)(row1 + x * 8));
+            __m128i b1 = _mm_loadu_si128((const __m128i *)(row1 + x * 8 + 16));
+            __m128i low0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+            __m128i high0 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+            __m128i low1 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+            __m128i high1 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+            // sums of the 4 texels of pixels 0,1 and 2,3
+            __m128i sum0 = _mm_add_epi16(_mm_unpacklo_epi64(low0, high0), _mm_unpackhi_epi64(low0, high0));
+            __m128i sum1 = _mm_add_epi16(_mm_unpacklo_epi64(low1, high1), _mm_unpackhi_epi64(low1, high1));
+            if (!normalize)
+            {
+                sum0 = _mm_srli_epi16(_mm_add_epi16(sum0, two), 2);
+                sum1 = _mm_srli_epi16(_mm_add_epi16(sum1, two), 2);
+                _mm_storeu_si128((__m128i *)(target + x * 4), _mm_packus_epi16(sum0, sum1));
+                continue;
+            }
+            const __m128 scale = _mm_set1_ps(0.25f / 255.0f), byte = _mm_set1_ps(255.0f), half = _mm_set1_ps(0.5f);
+            __m128i texels[4];
+            const __m128i sums[4] = {_mm_unpacklo_epi16(sum0, zero), _mm_unpackhi_epi16(sum0, zero), _mm_unpacklo_epi16(sum1, zero), _mm_unpackhi_epi16(sum1, zero)};
+            for (int i = 0; i < 4; i++)
+            {
+                __m128 texel = normalizeTexel(_mm_mul_ps(_mm_cvtepi32_ps(sums[i]), scale));
+                texels[i] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(texel, byte), half));
+            }
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(texels[0], texels[1]), _mm_packs_epi32(texels[2], texels[3]));
+            _mm_storeu_si128((__m128i *)(target + x * 4), packed);
+        }
+#endif
+        for (; x < width; x++)
+        {
+            const unsigned char *p0 = row0 + x * 8, *p1 = row1 + x * 8;
+            if (!normalize)
+            {
+                for (int c = 0; c < 4; c++)
+                    target[x * 4 + c] = (unsigned char)((p0[c] + p0[c + 4] + p1[c] + p1[c + 4] + 2) >> 2);
+                continue;
+            }
+            float sum[4];
+            for (int c = 0; c < 4; c++)
+                sum[c] = (p0[c] + p0[c + 4] + p1[c] + p1[c + 4]) * (0.25f / 255.0f);
+            renormalize(sum);
+            for (int c = 0; c < 4; c++)
+                target[x * 4 + c] = toByte(sum[c]);
+        }
+    }
+
+    // sRGB rows: each texel to linear through a table, averaged, back to sRGB through a second table
+    // ------------------------------------------------------------------------
+    static void filterColorRow(const unsigned char *row0, const unsigned char *row1, unsigned char *target, int width)
+    {
+        const float *toLinear = linearTable();
+        const unsigned char *toSrgb = srgbTable();
+        for (int x = 0; x < width; x++)
+        {
+            const unsigned char *p0 = row0 + x * 8, *p1 = row1 + x * 8;
+            alignas(16) float sum[4];
+#if defined(MIPMAP_AVX2)
+            // channel c of a texel is looked up at c * 256 + value, the alpha table is value / 255
+            const __m256i offsets = _mm256_setr_epi32(0, 256, 512, 768, 0, 256, 512, 768);
+            __m256i index0 = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p0)), offsets);
+            __m256i index1 = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p1)), offsets);
+            __m256 both = _mm256_add_ps(_mm256_i32gather_ps(toLinear, index0, 4), _mm256_i32gather_ps(toLinear, index1, 4));
+            __m128 total = _mm_add_ps(_mm256_castps256_ps128(both), _mm256_extractf128_ps(both, 1));
+            _mm_store_ps(sum, _mm_mul_ps(total, _mm_set1_ps(0.25f)));
+#elif defined(MIPMAP_SSE2)
+            __m128 a = _mm_set_ps(toLinear[768 + p0[3]], toLinear[512 + p0[2]], toLinear[256 + p0[1]], toLinear[p0[0]]);
+            __m128 b = _mm_set_ps(toLinear[768 + p0[7]], toLinear[512 + p0[6]], toLinear[256 + p0[5]], toLinear[p0[4]]);
+            __m128 c = _mm_set_ps(toLinear[768 + p1[3]], toLinear[512 + p1[2]], toLinear[256 + p1[1]], toLinear[p1[0]]);
+            __m128 d = _mm_set_ps(toLinear[768 + p1[7]], toLinear[512 + p1[6]], toLinear[256 + p1[5]], toLinear[p1[4]]);
+            _mm_store_ps(sum, _mm_mul_ps(_mm_add_ps(_mm_add_ps(a, b), _mm_add_ps(c, d)), _mm_set1_ps(0.25f)));
+#else
+            for (int c = 0; c < 4; c++)
+                sum[c] = (toLinear[c * 256 + p0[c]] + toLinear[c * 256 + p0[c + 4]] + toLinear[c * 256 + p1[c]] + toLinear[c * 256 + p1[c + 4]]) * 0.25f;
+#endif
+            for (int c = 0; c < 3; c++)
+                target[x * 4 + c] = toSrgb[(int)(std::min(sum[c], 1.0f) * (SRGB_STEPS - 1) + 0.5f)];
+            target[x * 4 + 3] = toByte(sum[3]);
+        }
+    }
+
+    // float rows, step is 4 floats between the two texels of a row (0 for a 1 pixel wide source)
+    // ------------------------------------------------------------------------
+    static void filterFloatRow(const float *row0, const float *row1, float *target, int width, int step, bool normalize)
+    {
+        int x = 0;
+        if (!normalize && step == 4)
+        {
+#ifdef MIPMAP_AVX2
+            const __m256 quarter = _mm256_set1_ps(0.25f);
+            for (; x + 2 <= width; x += 2)
+            {
+                // [p0 p1] [p2 p3] of each row, the two outputs are p0+p1 and p2+p3
+                __m256 s0 = _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8), _mm256_loadu_ps(row1 + x * 8));
+                __m256 s1 = _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8 + 8), _mm256_loadu_ps(row1 + x * 8 + 8));
+                __m256 sum = _mm256_add_ps(_mm256_permute2f128_ps(s0, s1, 0x20), _mm256_permute2f128_ps(s0, s1, 0x31));
+                _mm256_storeu_ps(target + x * 4, _mm256_mul_ps(sum, quarter));
+            }
+#endif
+        }
+#ifdef MIPMAP_SSE2
+        if (step == 4)
+        {
+            const __m128 quarter = _mm_set1_ps(0.25f);
+            for (; x < width; x++)
+            {
+                __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x * 8), _mm_loadu_ps(row0 + x * 8 + 4)),
+                                        _mm_add_ps(_mm_loadu_ps(row1 + x * 8), _mm_loadu_ps(row1 + x * 8 + 4)));
+                sum = _mm_mul_ps(sum, quarter);
+                _mm_storeu_ps(target + x * 4, normalize ? normalizeTexel(sum) : sum);
+            }
+        }
+#endif
+        for (; x < width; x++)
+        {
+            const float *p0 = row0 + x * 2 * step, *p1 = row1 + x * 2 * step;
+            float sum[4];
+            for (int c = 0; c < 4; c++)
+                sum[c] = (p0[c] + p0[c + step] + p1[c] + p1[c + step]) * 0.25f;
+            if (normalize)
+                renormalize(sum);
+            memcpy(target + x * 4, sum, sizeof(sum));
+        }
+    }
+
+#ifdef MIPMAP_SSE2
+    // renormalize() on one RGBA texel
+    static __m128 normalizeTexel(__m128 texel)
+    {
+        const __m128 rgb = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)), half = _mm_set1_ps(0.5f);
+        __m128 n = _mm_sub_ps(_mm_add_ps(texel, texel), _mm_set1_ps(1.0f));
+        __m128 square = _mm_and_ps(_mm_mul_ps(n, n), rgb);
+        square = _mm_add_ps(square, _mm_shuffle_ps(square, square, _MM_SHUFFLE(2, 3, 0, 1)));
+        square = _mm_add_ps(square, _mm_shuffle_ps(square, square, _MM_SHUFFLE(1, 0, 3, 2)));
+        __m128 unit = _mm_add_ps(_mm_mul_ps(_mm_div_ps(n, _mm_sqrt_ps(square)), half), half);
+        // rgb of the unit vector when there is a direction, alpha stays the average
+        __m128 use = _mm_and_ps(_mm_cmpgt_ps(square, _mm_set1_ps(1e-12f)), rgb);
+        return _mm_or_ps(_mm_and_ps(use, unit), _mm_andnot_ps(use, texel));
+    }
+#endif
+
+    // rgb in [0, 1] holding a normal as n * 0.5 + 0.5
+    static void renormalize(float *rgb)
+    {
+        float n[3] = {rgb[0] * 2.0f - 1.0f, rgb[1] * 2.0f - 1.0f, rgb[2] * 2.0f - 1.0f};
+        float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length > 1e-6f)
+            for (int c = 0; c < 3; c++)
+                rgb[c] = n[c] / length * 0.5f + 0.5f;
+    }
+    static unsigned char toByte(float value)
+    {
+        return (unsigned char)std::min(std::max(value * 255.0f + 0.5f, 0.0f), 255.0f);
+    }
+
+    // linear value -> sRGB byte, fine enough that every byte survives a round trip
+    static const int SRGB_STEPS = 16384;
+
+    // 4 x 256 entries: sRGB -> linear for r, g, b and value / 255 for alpha
+    static const float *linearTable()
+    {
+        static const std::vector<float> table = []() {
+            std::vector<float> values(1024);
+            for (int i = 0; i < 256; i++)
+            {
+                float c = i / 255.0f;
+                float linear = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                values[i] = values[256 + i] = values[512 + i] = linear;
+                values[768 + i] = c;
+            }
+            return values;
+        }();
+        return table.data();
+    }
+    static const unsigned char *srgbTable()
+    {
+        static const std::vector<unsigned char> table = []() {
+            std::vector<unsigned char> values(SRGB_STEPS);
+            for (int i = 0; i < SRGB_STEPS; i++)
+            {
+                float c = (float)i / (SRGB_STEPS - 1);
+                float srgb = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+                values[i] = toByte(srgb);
+            }
+            return values;
+        }();
+        return table.data();
+    }
+};
+
+#endif
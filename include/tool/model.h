@@ -5,75 +5,280 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <tool/render_queue.h>
+#include <tool/mesh_cache.h>
+#include <tool/thread_pool.h>
+#include <tool/texture_streamer.h>
+#include <tool/texture_cache.h>
+#include <tool/frustum.h>
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <vector>
+#include <chrono>
 using namespace std;
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
 class Model
 {
 public:
-	vector<Texture> textures_loaded; // stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+	vector<Texture> textures_loaded; // the textures of this model, each acquired once from TextureCache::shared() and released with the model
 	vector<Mesh> meshes;
 	string directory;
 	bool gammaCorrection;
+	// what the meshes keep in memory after their buffers are uploaded
+	CpuRetention retention;
+	// vertex layout of the meshes, the shaders drawing them are compiled with format.defines()
+	VertexFormat format;
+	// box around all meshes in model space, each mesh has its own in Mesh::bounds
+	Bounds bounds;
+	// how the last load went: meshes mapped from the MeshCache or imported with Assimp,
+	// time spent on geometry (import/mapping and upload) and on textures
+	bool loadedFromCache = false;
+	double geometryMilliseconds = 0.0;
+	double textureMilliseconds = 0.0;
+
+	// convert the meshes of an Assimp import on ThreadPool::shared() instead of one after another
+	static inline bool parallelImport = true;
+
+	// levels of detail built per mesh at import (MeshData::buildLods), 1 keeps only the full mesh; cached with the meshes
+	static inline unsigned int lodLevels = 1;
+
+	// MeshOptimization flags applied to every mesh after that (MeshData::optimize), also part of the cache key
+	static inline unsigned int meshOptimization = OPTIMIZE_VERTEX_CACHE | OPTIMIZE_VERTEX_FETCH;
+
+	// when set, the meshes of models with the format of the arena are sub-allocated from it and share its VAO, models of
+	// other formats keep buffers of their own. has to outlive the models
+	static inline GeometryArena *geometryArena = nullptr;
 
-	Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+	// when set, textures are requested from the streamer and arrive over the next frames (placeholders until then)
+	static inline TextureStreamer *textureStreamer = nullptr;
+
+	// post processing applied by Assimp, part of the mesh cache key
+	static const unsigned int IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+	Model(string const &path, bool gamma = false, CpuRetention retention = RETAIN_ALL, VertexFormat format = VertexFormat())
+		: gammaCorrection(gamma), retention(retention), format(format)
 	{
 		loadModel(path);
 	}
+	Model(const Model &) = delete;
+	Model &operator=(const Model &) = delete;
+	~Model()
+	{
+		for (const Texture &texture : textures_loaded)
+			TextureCache::shared().release(texture.id);
+	}
 
 	void Draw(Shader &shader)
 	{
 		for (unsigned int i = 0; i < meshes.size(); i++)
 			meshes[i].Draw(shader);
 	}
+	// draw only the meshes whose bounds, moved by the model matrix, intersect the frustum; returns how many were drawn
+	unsigned int Draw(Shader &shader, const Frustum &frustum, const glm::mat4 &model)
+	{
+		if (!frustum.intersects(bounds, model))
+			return 0;
+		unsigned int drawn = 0;
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			if (meshes.size() == 1 || frustum.intersects(meshes[i].bounds, model))
+			{
+				meshes[i].Draw(shader);
+				drawn++;
+			}
+		return drawn;
+	}
+	// the same, each mesh at the coarsest level of detail whose error stays below maxPixelError pixels on screen.
+	// pixelScale is Camera::GetPixelScale(): pixels covered by one unit at distance 1. returns the triangles submitted
+	size_t Draw(Shader &shader, const Frustum &frustum, const glm::mat4 &model, const glm::vec3 &viewPos, float pixelScale, float maxPixelError = 1.0f)
+	{
+		if (!frustum.intersects(bounds, model))
+			return 0;
+		float scale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		size_t triangles = 0;
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			Mesh &mesh = meshes[i];
+			if (meshes.size() > 1 && !frustum.intersects(mesh.bounds, model))
+				continue;
+			// distance to the bounding sphere, inside it the full level is used
+			glm::vec3 center = glm::vec3(model * glm::vec4(mesh.bounds.center(), 1.0f));
+			float distance = glm::length(center - viewPos) - glm::length(mesh.bounds.extent()) * scale;
+			unsigned int lod = distance > 0.0f ? mesh.selectLod(scale * pixelScale / distance, maxPixelError) : 0;
+			mesh.Draw(shader, lod);
+			triangles += mesh.lods[lod].indexCount / 3;
+		}
+		return triangles;
+	}
+	// bytes held in memory and in vertex/index buffers by all meshes
+	size_t cpuBytes() const
+	{
+		size_t bytes = textures_loaded.capacity() * sizeof(Texture);
+		for (const Mesh &mesh : meshes)
+			bytes += mesh.cpuBytes() + mesh.textures.capacity() * sizeof(Texture);
+		return bytes;
+	}
+	size_t gpuBytes() const
+	{
+		size_t bytes = 0;
+		for (const Mesh &mesh : meshes)
+			bytes += mesh.gpuBytes();
+		return bytes;
+	}
+	void printMemoryReport() const
+	{
+		static const char *policies[] = {"keep all", "keep positions", "drop"};
+		size_t vertexCount = 0, triangleCount = 0;
+		for (const Mesh &mesh : meshes)
+		{
+			vertexCount += mesh.vertexCount;
+			triangleCount += mesh.indexCount / 3;
+		}
+		cout << "MODEL::MEMORY " << directory << " (" << policies[retention] << "): " << meshes.size() << " meshes, "
+			 << vertexCount << " vertices, " << triangleCount << " triangles, resident " << cpuBytes() / 1024 << " KB, buffers "
+			 << gpuBytes() / 1024 << " KB (" << format.stride() << " bytes per vertex)" << endl;
+	}
+	// queue the meshes instead of drawing them right away, the queue orders them by state
+	void Submit(RenderQueue &queue, Shader &shader, const glm::mat4 &model)
+	{
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			queue.add(shader, meshes[i], model);
+	}
+	void Submit(RenderQueue &queue, Shader &shader, const glm::mat4 &model, const Frustum &frustum)
+	{
+		if (!frustum.intersects(bounds, model))
+			return;
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			if (meshes.size() == 1 || frustum.intersects(meshes[i].bounds, model))
+				queue.add(shader, meshes[i], model);
+	}
 
 private:
+	// path in the material -> index in textures_loaded
+	unordered_map<string, size_t> loadedIndex;
+
 	void loadModel(string const &path)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		// retrieve the directory path of the filepath
+		directory = path.substr(0, path.find_last_of('/'));
+
+		loadedFromCache = loadCachedModel(path);
+		if (!loadedFromCache)
+			importModel(path);
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			bounds.min = i == 0 ? meshes[i].bounds.min : glm::min(bounds.min, meshes[i].bounds.min);
+			bounds.max = i == 0 ? meshes[i].bounds.max : glm::max(bounds.max, meshes[i].bounds.max);
+		}
+
+		geometryMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() - textureMilliseconds;
+	}
+
+	void importModel(string const &path)
 	{
 		// read file via ASSIMP
 		Assimp::Importer importer;
-		const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+		const aiScene *scene = importer.ReadFile(path, IMPORT_FLAGS);
 		// check for errors
 		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
 		{
 			cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
 			return;
 		}
-		// retrieve the directory path of the filepath
-		directory = path.substr(0, path.find_last_of('/'));
 
-		// process ASSIMP's root node recursively
-		processNode(scene->mRootNode, scene);
+		// collect the meshes of ASSIMP's node tree in drawing order
+		vector<aiMesh *> sceneMeshes;
+		processNode(scene->mRootNode, scene, sceneMeshes);
+
+		// CPU stage: convert the meshes on the thread pool, no GL calls in here
+		vector<MeshData> converted(sceneMeshes.size());
+		auto convert = [&](size_t i) {
+			converted[i] = processMesh(sceneMeshes[i]);
+			converted[i].buildLods(lodLevels);
+			converted[i].optimize(meshOptimization);
+			converted[i].prepare(format);
+		};
+		if (parallelImport)
+			ThreadPool::shared().parallelFor(sceneMeshes.size(), convert);
+		else
+			for (size_t i = 0; i < sceneMeshes.size(); i++)
+				convert(i);
+
+		// GL stage: textures and buffers on the thread owning the context, recording the meshes for the next start
+		MeshCache::Writer writer;
+		meshes.reserve(sceneMeshes.size());
+		for (size_t i = 0; i < sceneMeshes.size(); i++)
+		{
+			vector<Texture> textures = loadMeshTextures(sceneMeshes[i], scene);
+			if (MeshCache::enabled)
+				writer.addMesh(converted[i].vertices, converted[i].indices, writer.addMaterial(sceneMeshes[i]->mMaterialIndex, textures), converted[i].lods);
+			meshes.push_back(Mesh(std::move(converted[i]), std::move(textures), retention, format, geometryArena));
+		}
+		if (MeshCache::enabled && !writer.save(path, IMPORT_FLAGS, lodLevels, meshOptimization))
+			cout << "ERROR::MESH_CACHE::WRITE_FAILED " << MeshCache::cachePath(path) << endl;
+	}
+
+	// create the meshes from a mapped cache file, the buffers are filled straight from the mapping
+	bool loadCachedModel(string const &path)
+	{
+		MeshCache cache;
+		if (!cache.open(path, IMPORT_FLAGS, lodLevels, meshOptimization))
+			return false;
+		const MeshCacheHeader &header = cache.header();
+
+		vector<vector<Texture>> materials(header.materialCount);
+		for (uint32_t i = 0; i < header.materialCount; i++)
+		{
+			const MeshCacheMaterial &material = cache.material(i);
+			for (uint32_t j = 0; j < material.textureCount; j++)
+			{
+				uint32_t texture = material.firstTexture + j;
+				materials[i].push_back(loadTexture(cache.texturePath(texture).c_str(), cache.textureType(texture)));
+			}
+		}
+		meshes.reserve(header.meshCount);
+		for (uint32_t i = 0; i < header.meshCount; i++)
+		{
+			const MeshCacheMesh &entry = cache.mesh(i);
+			vector<MeshLod> lods;
+			for (uint32_t j = 0; j < entry.lodCount; j++)
+				lods.push_back(MeshLod{cache.lods(entry)[j].firstIndex, (GLsizei)cache.lods(entry)[j].indexCount, cache.lods(entry)[j].error});
+			meshes.push_back(Mesh(cache.vertices(entry), entry.vertexCount, cache.indices(entry), entry.indexCount, materials[entry.material], retention, format, std::move(lods),
+								  geometryArena));
+		}
+		return true;
 	}
 
-	// processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-	void processNode(aiNode *node, const aiScene *scene)
+	// processes a node in a recursive fashion. Collects each individual mesh located at the node and repeats this process on its children nodes (if any).
+	void processNode(aiNode *node, const aiScene *scene, vector<aiMesh *> &sceneMeshes)
 	{
-		// process each mesh located at the current node
+		// collect each mesh located at the current node
 		for (unsigned int i = 0; i < node->mNumMeshes; i++)
 		{
 			// the node object only contains indices to index the actual objects in the scene.
 			// the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-			aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-			meshes.push_back(processMesh(mesh, scene));
+			sceneMeshes.push_back(scene->mMeshes[node->mMeshes[i]]);
 		}
 		// after we've processed all of the meshes (if any) we then recursively process each of the children nodes
 		for (unsigned int i = 0; i < node->mNumChildren; i++)
 		{
-			processNode(node->mChildren[i], scene);
+			processNode(node->mChildren[i], scene, sceneMeshes);
 		}
 	}
-	Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+	// converts the vertices and faces of a mesh, runs on a worker thread
+	static MeshData processMesh(const aiMesh *mesh)
 	{
 		// data to fill
-		vector<Vertex> vertices;
-		vector<unsigned int> indices;
-		vector<Texture> textures;
+		MeshData data;
+		vector<Vertex> &vertices = data.vertices;
+		vector<unsigned int> &indices = data.indices;
+		vertices.reserve(mesh->mNumVertices);
+		indices.reserve(mesh->mNumFaces * 3);
 
 		// walk through each of the mesh's vertices
 		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -121,11 +326,17 @@ private:
 		// now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
 		for (unsigned int i = 0; i < mesh->mNumFaces; i++)
 		{
-			aiFace face = mesh->mFaces[i];
+			const aiFace &face = mesh->mFaces[i];
 			// retrieve all indices of the face and store them in the indices vector
 			for (unsigned int j = 0; j < face.mNumIndices; j++)
 				indices.push_back(face.mIndices[j]);
 		}
+		return data;
+	}
+	// loads the textures of the mesh material, needs the GL context
+	vector<Texture> loadMeshTextures(const aiMesh *mesh, const aiScene *scene)
+	{
+		vector<Texture> textures;
 		// process materials
 		aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
 		// we assume a convention for sampler names in the shaders. Each diffuse texture should be named
@@ -148,8 +359,7 @@ private:
 		std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
 		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
-		// return a mesh object created from the extracted mesh data
-		return Mesh(vertices, indices, textures);
+		return textures;
 	}
 
 	vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
@@ -159,29 +369,30 @@ private:
 		{
 			aiString str;
 			mat->GetTexture(type, i, &str);
-			// check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-			bool skip = false;
-			for (unsigned int j = 0; j < textures_loaded.size(); j++)
-			{
-				if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-				{
-					textures.push_back(textures_loaded[j]);
-					skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-					break;
-				}
-			}
-			if (!skip)
-			{ // if texture hasn't been loaded already, load it
-				Texture texture;
-				texture.id = TextureFromFile(str.C_Str(), this->directory);
-				texture.type = typeName;
-				texture.path = str.C_Str();
-				textures.push_back(texture);
-				textures_loaded.push_back(texture); // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-			}
+			textures.push_back(loadTexture(str.C_Str(), typeName));
 		}
 		return textures;
 	}
+
+	Texture loadTexture(const char *path, const string &typeName)
+	{
+		// check if texture was loaded before and if so, skip loading a new texture
+		unordered_map<string, size_t>::iterator loaded = loadedIndex.find(path);
+		if (loaded != loadedIndex.end())
+			return textures_loaded[loaded->second];
+		// other models may already hold the same file, the cache shares it. the UVs are flipped by aiProcess_FlipUVs, not the image
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		Texture texture;
+		// mip levels of colors are averaged in linear light, of normal maps renormalized
+		TextureKind kind = typeName == "texture_diffuse" ? TEXTURE_COLOR : (typeName == "texture_normal" ? TEXTURE_NORMAL : TEXTURE_DATA);
+		texture.id = TextureCache::shared().acquire(this->directory + '/' + path, false, false, GL_REPEAT, textureStreamer, kind);
+		texture.type = typeName;
+		texture.path = path;
+		loadedIndex[texture.path] = textures_loaded.size();
+		textures_loaded.push_back(texture); // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+		textureMilliseconds += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		return texture;
+	}
 };
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
@@ -0,0 +1,228 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <tool/shader.h>
+#include <tool/gl_state.h>
+#include <tool/mesh.h>
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+
+// Collects the draws of a pass and submits them sorted by state instead of in scene order.
+// Every draw gets a 64-bit key:
+//   opaque       0 | program:10 | material:13 | vao:16 | depth:24     state first, then front to back
+//   transparent  1 | inverted depth:24 | program:10 | material:13 | vao:16     back to front
+// The keys are radix sorted, so flush() switches program, textures and VAO only when the key changes.
+// Meshes in a GeometryArena share its VAO and are drawn with their base vertex, only textures separate them.
+class RenderQueue
+{
+public:
+    struct Stats
+    {
+        unsigned int draws = 0;
+        unsigned int programChanges = 0;
+        unsigned int materialChanges = 0;
+        unsigned int vertexArrayChanges = 0;
+    };
+    // counted by the last flush()
+    Stats stats;
+
+    // camera used for the depth part of the keys
+    // ------------------------------------------------------------------------
+    void setView(const glm::mat4 &view, float farPlane = 100.0f)
+    {
+        this->view = view;
+        this->farPlane = farPlane;
+    }
+
+    // a draw of raw geometry (e.g. a BufferGeometry), the textures are bound by the caller
+    // ------------------------------------------------------------------------
+    void add(Shader &shader, GeometryView geometry, const glm::mat4 &model, bool transparent = false)
+    {
+        push(shader, geometry.VAO, geometry.count, geometry.indexType, (size_t)geometry.indexOffset(), geometry.baseVertex, nullptr, 0, model, transparent);
+    }
+    // a draw of a mesh with its textures, meshes using the same textures share a material id
+    // ------------------------------------------------------------------------
+    void add(Shader &shader, const Mesh &mesh, const glm::mat4 &model, bool transparent = false)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (const Texture &texture : mesh.textures)
+        {
+            hash ^= texture.id;
+            hash *= 1099511628211ull;
+        }
+        push(shader, mesh.VAO, mesh.indexCount, mesh.indexType, mesh.firstIndex() * indexSize(mesh.indexType), mesh.baseVertex(), &mesh,
+             denseId(materialIds, hash) + 1, model, transparent);
+    }
+
+    // sort and draw everything added since the last flush. transparent draws are blended
+    // with the blend function set by the caller.
+    // ------------------------------------------------------------------------
+    void flush()
+    {
+        stats = Stats();
+        sort();
+
+        Shader *shader = nullptr;
+        uint32_t material = 0;
+        GLuint vao = 0;
+        bool blending = false;
+        UniformHandle modelHandle;
+        for (const SortEntry &entry : sorted)
+        {
+            const DrawItem &item = items[entry.item];
+            bool transparent = (entry.key >> 63) != 0;
+            if (transparent && !blending)
+            {
+                GLState::enable(GL_BLEND);
+                blending = true;
+            }
+            if (item.shader != shader)
+            {
+                shader = item.shader;
+                shader->use();
+                modelHandle = shader->uniform("model");
+                material = 0;
+                stats.programChanges++;
+            }
+            if (item.mesh != nullptr)
+                item.mesh->BindVertexFormat(*shader);
+            if (item.mesh != nullptr && item.material != material)
+            {
+                item.mesh->BindTextures(*shader);
+                material = item.material;
+                stats.materialChanges++;
+            }
+            if (item.vao != vao || stats.draws == 0)
+            {
+                GLState::bindVertexArray(item.vao);
+                vao = item.vao;
+                stats.vertexArrayChanges++;
+            }
+            shader->setMat4(modelHandle, item.model);
+            glDrawElementsBaseVertex(GL_TRIANGLES, item.count, item.indexType, (void *)item.indexOffset, item.baseVertex);
+            stats.draws++;
+        }
+        if (blending)
+            GLState::disable(GL_BLEND);
+        GLState::unbindVertexArray();
+
+        items.clear();
+        sorted.clear();
+    }
+
+    size_t size() const
+    {
+        return items.size();
+    }
+
+private:
+    struct DrawItem
+    {
+        Shader *shader;
+        GLuint vao;
+        GLsizei count;
+        GLenum indexType;
+        size_t indexOffset; // bytes into the element buffer
+        GLint baseVertex;
+        const Mesh *mesh;
+        uint32_t material;
+        glm::mat4 model;
+    };
+    struct SortEntry
+    {
+        uint64_t key;
+        uint32_t item;
+    };
+
+    std::vector<DrawItem> items;
+    std::vector<SortEntry> sorted;
+    std::vector<SortEntry> scratch;
+    glm::mat4 view = glm::mat4(1.0f);
+    float farPlane = 100.0f;
+
+    // small ids that fit in the key fields, kept across frames so keys stay stable
+    std::unordered_map<uint64_t, uint32_t> programIds;
+    std::unordered_map<uint64_t, uint32_t> materialIds;
+    std::unordered_map<uint64_t, uint32_t> vertexArrayIds;
+
+    static uint32_t denseId(std::unordered_map<uint64_t, uint32_t> &ids, uint64_t value)
+    {
+        std::unordered_map<uint64_t, uint32_t>::iterator found = ids.find(value);
+        if (found != ids.end())
+            return found->second;
+        uint32_t id = (uint32_t)ids.size();
+        ids[value] = id;
+        return id;
+    }
+
+    void push(Shader &shader, GLuint vao, GLsizei count, GLenum indexType, size_t indexOffset, GLint baseVertex, const Mesh *mesh, uint32_t material,
+              const glm::mat4 &model, bool transparent)
+    {
+        // distance along the view direction, quantized to 24 bits
+        float distance = -(view * model[3]).z / farPlane;
+        distance = distance < 0.0f ? 0.0f : (distance > 1.0f ? 1.0f : distance);
+        uint64_t depth = (uint64_t)(distance * 0xFFFFFF);
+
+        uint64_t program = denseId(programIds, shader.ID) & 0x3FF;
+        uint64_t materialBits = material & 0x1FFF;
+        uint64_t vertexArray = denseId(vertexArrayIds, vao) & 0xFFFF;
+        uint64_t key;
+        if (!transparent)
+            key = (program << 53) | (materialBits << 40) | (vertexArray << 24) | depth;
+        else
+            key = (1ull << 63) | ((0xFFFFFF - depth) << 39) | (program << 29) | (materialBits << 16) | vertexArray;
+
+        SortEntry entry;
+        entry.key = key;
+        entry.item = (uint32_t)items.size();
+        sorted.push_back(entry);
+
+        DrawItem item;
+        item.shader = &shader;
+        item.vao = vao;
+        item.count = count;
+        item.indexType = indexType;
+        item.indexOffset = indexOffset;
+        item.baseVertex = baseVertex;
+        item.mesh = mesh;
+        item.material = material;
+        item.model = model;
+        items.push_back(item);
+    }
+
+    // LSD radix sort, 8 bits per pass. passes where every key has the same byte are skipped.
+    // ------------------------------------------------------------------------
+    void sort()
+    {
+        scratch.resize(sorted.size());
+        for (int shift = 0; shift < 64; shift += 8)
+        {
+            size_t counts[256];
+            memset(counts, 0, sizeof(counts));
+            for (const SortEntry &entry : sorted)
+                counts[(entry.key >> shift) & 0xFF]++;
+            if (counts[(sorted.empty() ? 0 : sorted[0].key >> shift) & 0xFF] == sorted.size())
+                continue;
+
+            size_t offset = 0;
+            for (size_t &count : counts)
+            {
+                size_t bucket = count;
+                count = offset;
+                offset += bucket;
+            }
+            for (const SortEntry &entry : sorted)
+                scratch[counts[(entry.key >> shift) & 0xFF]++] = entry;
+            sorted.swap(scratch);
+        }
+    }
+};
+
+#endif
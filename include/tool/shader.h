@@ -3,23 +3,127 @@
 
 #include <glad/glad.h>
 
+#include <tool/gl_state.h>
+
 #include <glm/glm.hpp>
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <filesystem>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <utility>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// location of an active uniform, resolved once when the program is linked.
+// setting a uniform through a handle does no string hashing and no driver query.
+struct UniformHandle
+{
+    GLint location = -1;
+
+    bool valid() const { return location >= 0; }
+};
+
+// binding points of the shared uniform blocks (see uniform_buffer.h)
+enum UniformBlockBinding
+{
+    CAMERA_BLOCK_BINDING = 0,
+    LIGHT_BLOCK_BINDING = 1
+};
+
+// compile time defines injected after the #version line, e.g. {{"NR_POINT_LIGHTS", "32"}, {"USE_SHADOWS", "1"}}
+typedef std::vector<std::pair<std::string, std::string>> ShaderDefines;
 
 class Shader
 {
 public:
+    typedef std::unordered_map<std::string, GLint> UniformTable;
+
     unsigned int ID;
     static std::string dirName;
+    // shared GLSL modules, searched by #include after the directory of the including file
+    static inline std::string includeDir = "./static/shader/";
+    // every file read to build this program, includes as well
+    std::vector<std::string> sourceFiles;
+    // outputs captured by transform feedback (interleaved into one buffer), set before submit()
+    std::vector<std::string> feedbackVaryings;
+    // incremented each time a hot reload replaces the program, uniform handles have to be looked up again
+    unsigned int generation = 0;
+
+    // when false, the name based setters query glGetUniformLocation on every call (the old behaviour, kept for comparison)
+    static inline bool useLocationCache = true;
+    // number of glGetUniformLocation calls issued since the counter was last reset
+    static inline unsigned long locationQueries = 0;
+
+    // linked program binaries are kept here, keyed by a hash of the sources and the driver strings
+    static inline std::string cacheDir = "./output/shader_cache/";
+    static inline bool useProgramCache = true;
+    // startup statistics: programs restored from the cache / built from source, total construction time
+    static inline unsigned int programsFromCache = 0;
+    static inline unsigned int programsCompiled = 0;
+    static inline double buildSeconds = 0.0;
+
+    // uniform blocks with one of these names are bound to their binding point when the program is linked,
+    // a sample can register its own blocks before creating its shaders
+    static inline std::unordered_map<std::string, GLuint> blockBindings = {
+        {"CameraBlock", CAMERA_BLOCK_BINDING},
+        {"LightBlock", LIGHT_BLOCK_BINDING}};
 
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
-    Shader(const char *vertexPath, const char *fragmentPath, const char *geometryPath = nullptr)
+    Shader(const char *vertexPath, const char *fragmentPath, const char *geometryPath = nullptr, const ShaderDefines &defines = ShaderDefines()) : ID(0)
     {
+        submit(vertexPath, fragmentPath, geometryPath, defines);
+        finish();
+    }
+    // empty program, filled in later through submit() (see ShaderLibrary)
+    Shader() : ID(0) {}
+
+    // a Shader owns its program: it can be moved but not copied, the program is deleted with it
+    Shader(const Shader &) = delete;
+    Shader &operator=(const Shader &) = delete;
+    Shader(Shader &&other) noexcept : ID(0)
+    {
+        swap(other);
+    }
+    Shader &operator=(Shader &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            swap(other);
+        }
+        return *this;
+    }
+    ~Shader()
+    {
+        if (GLState::contextCurrent())
+            release();
+    }
+
+    // read the sources and hand compile/link to the driver without waiting for the result.
+    // status queries are deferred to finish(), so several programs can be compiled in parallel.
+    // ------------------------------------------------------------------------
+    void submit(const char *vertexPath, const char *fragmentPath, const char *geometryPath = nullptr, const ShaderDefines &defines = ShaderDefines())
+    {
+        std::chrono::steady_clock::time_point buildStart = std::chrono::steady_clock::now();
+        // a program built earlier by this object is replaced
+        release();
+        programPaths[0] = vertexPath;
+        programPaths[1] = fragmentPath;
+        programPaths[2] = geometryPath != nullptr ? geometryPath : "";
+        programDefines = defines;
+        linked = false;
 
         std::string vert_string = vertexPath;
         std::string frag_string = fragmentPath;
@@ -35,153 +139,498 @@ public:
             gemo_char = gemo_string.insert(2, dirName).c_str();
         }
 
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
+        // 1. retrieve the vertex/fragment source code from filePath, expanding #include and applying the defines
+        sourceFiles.clear();
+        std::string vertexCode = loadSource(vert_char, defines);
+        std::string fragmentCode = loadSource(frag_char, defines);
         std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            // open files
-            vShaderFile.open(vert_char);
-            fShaderFile.open(frag_char);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-            // if geometry shader path is present, also load a geometry shader
-            if (geometryPath != nullptr)
-            {
-                gShaderFile.open(gemo_char);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
-        }
-        catch (std::ifstream::failure &e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-        }
-        const char *vShaderCode = vertexCode.c_str();
-        const char *fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
         if (geometryPath != nullptr)
+            geometryCode = loadSource(gemo_char, defines);
+        // 2. try the program binary cache first, falling back to compiling from source when the driver rejects it
+        cacheKey = programCacheKey(vertexCode, fragmentCode, geometryCode + feedbackKey());
+        if (loadProgramBinary(cacheKey))
         {
-            const char *gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            linked = true;
+            loadUniformLocations();
+            bindUniformBlocks();
+            programsFromCache++;
+            buildSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+            return;
         }
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if (geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+        // 3. compile shaders and link, the results are checked in finish()
+        pendingStages[0] = compileStage(GL_VERTEX_SHADER, vertexCode);
+        pendingStages[1] = compileStage(GL_FRAGMENT_SHADER, fragmentCode);
+        pendingStages[2] = geometryPath != nullptr ? compileStage(GL_GEOMETRY_SHADER, geometryCode) : 0;
+        link();
+        buildSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+    }
+    // the same for a compute program (GL 4.3), finish() completes it like the others
+    // ------------------------------------------------------------------------
+    void submitCompute(const char *computePath, const ShaderDefines &defines = ShaderDefines())
+    {
+        std::chrono::steady_clock::time_point buildStart = std::chrono::steady_clock::now();
+        release();
+        programPaths[0] = computePath;
+        programPaths[1] = "";
+        programPaths[2] = "";
+        programDefines = defines;
+        linked = false;
+
+        std::string comp_string = computePath;
+        sourceFiles.clear();
+        std::string computeCode = loadSource(comp_string.insert(2, dirName), defines);
+        cacheKey = programCacheKey(computeCode, "", "");
+        if (loadProgramBinary(cacheKey))
+        {
+            linked = true;
+            loadUniformLocations();
+            bindUniformBlocks();
+            programsFromCache++;
+            buildSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+            return;
+        }
+        pendingStages[0] = compileStage(GL_COMPUTE_SHADER, computeCode);
+        link();
+        buildSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+    }
+    // true when finish() would not block; without KHR_parallel_shader_compile the driver cannot tell us, so assume ready
+    // ------------------------------------------------------------------------
+    bool isReady() const
+    {
+        if (!pending || !parallelCompileSupported())
+            return true;
+        GLint done = GL_FALSE;
+        glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
+    bool isPending() const
+    {
+        return pending;
+    }
+    bool isLinked() const
+    {
+        return linked;
+    }
+    // wait for the submitted program, report errors, store the binary and introspect uniforms.
+    // returns whether the program linked.
+    // ------------------------------------------------------------------------
+    bool finish()
+    {
+        if (!pending)
+            return linked;
+        std::chrono::steady_clock::time_point finishStart = std::chrono::steady_clock::now();
+        const char *stageNames[3] = {"VERTEX", "FRAGMENT", "GEOMETRY"};
+        if (programPaths[1].empty())
+            stageNames[0] = "COMPUTE";
+        for (int i = 0; i < 3; i++)
+            if (pendingStages[i] != 0)
+                checkCompileErrors(pendingStages[i], stageNames[i]);
+        linked = checkCompileErrors(ID, "PROGRAM");
+        if (linked)
+            saveProgramBinary(cacheKey);
+        loadUniformLocations();
+        bindUniformBlocks();
         // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if (geometryPath != nullptr)
-            glDeleteShader(geometry);
+        for (GLuint &stage : pendingStages)
+        {
+            if (stage != 0)
+                glDeleteShader(stage);
+            stage = 0;
+        }
+        pending = false;
+        programsCompiled++;
+        buildSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - finishStart).count();
+        return linked;
+    }
+    // start building a fresh copy of this program from the same files and defines (hot reload)
+    // ------------------------------------------------------------------------
+    void resubmit(Shader &next) const
+    {
+        next.feedbackVaryings = feedbackVaryings;
+        if (programPaths[1].empty())
+            next.submitCompute(programPaths[0].c_str(), programDefines);
+        else
+            next.submit(programPaths[0].c_str(), programPaths[1].c_str(), programPaths[2].empty() ? nullptr : programPaths[2].c_str(), programDefines);
+    }
+    // take over the linked program of another build and delete the current one
+    // ------------------------------------------------------------------------
+    void replaceProgram(Shader &next)
+    {
+        GLState::forgetProgram(ID);
+        glDeleteProgram(ID);
+        ID = next.ID;
+        uniformLocations = next.uniformLocations;
+        sourceFiles = next.sourceFiles;
+        next.ID = 0;
+        generation++;
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use()
     {
-        glUseProgram(ID);
+        GLState::useProgram(ID);
+    }
+    // look up a uniform once, keep the handle and use it inside the render loop
+    // ------------------------------------------------------------------------
+    UniformHandle uniform(const std::string &name) const
+    {
+        UniformHandle handle;
+        handle.location = location(name);
+        return handle;
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        glUniform1i(location(name), (int)value);
+    }
+    void setBool(UniformHandle handle, bool value) const
+    {
+        glUniform1i(handle.location, (int)value);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(location(name), value);
+    }
+    void setInt(UniformHandle handle, int value) const
+    {
+        glUniform1i(handle.location, value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1f(location(name), value);
+    }
+    void setFloat(UniformHandle handle, float value) const
+    {
+        glUniform1f(handle.location, value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform2fv(location(name), 1, &value[0]);
     }
     void setVec2(const std::string &name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2f(location(name), x, y);
+    }
+    void setVec2(UniformHandle handle, const glm::vec2 &value) const
+    {
+        glUniform2fv(handle.location, 1, &value[0]);
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform3fv(location(name), 1, &value[0]);
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(location(name), x, y, z);
+    }
+    void setVec3(UniformHandle handle, const glm::vec3 &value) const
+    {
+        glUniform3fv(handle.location, 1, &value[0]);
+    }
+    void setVec3(UniformHandle handle, float x, float y, float z) const
+    {
+        glUniform3f(handle.location, x, y, z);
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(location(name), 1, &value[0]);
     }
     void setVec4(const std::string &name, float x, float y, float z, float w)
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(location(name), x, y, z, w);
+    }
+    void setVec4(UniformHandle handle, const glm::vec4 &value) const
+    {
+        glUniform4fv(handle.location, 1, &value[0]);
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(location(name), 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat2(UniformHandle handle, const glm::mat2 &mat) const
+    {
+        glUniformMatrix2fv(handle.location, 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(location(name), 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat3(UniformHandle handle, const glm::mat3 &mat) const
+    {
+        glUniformMatrix3fv(handle.location, 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(location(name), 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat4(UniformHandle handle, const glm::mat4 &mat) const
+    {
+        glUniformMatrix4fv(handle.location, 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    // active uniform name -> location
+    std::shared_ptr<const UniformTable> uniformLocations;
+    // compile state between submit() and finish()
+    GLuint pendingStages[3] = {0, 0, 0};
+    bool pending = false;
+    bool linked = false;
+    std::string cacheKey;
+    // what submit() was called with, kept for rebuilding
+    std::string programPaths[3];
+    ShaderDefines programDefines;
+
+    void swap(Shader &other) noexcept
+    {
+        std::swap(ID, other.ID);
+        std::swap(sourceFiles, other.sourceFiles);
+        std::swap(feedbackVaryings, other.feedbackVaryings);
+        std::swap(generation, other.generation);
+        std::swap(uniformLocations, other.uniformLocations);
+        std::swap(pendingStages, other.pendingStages);
+        std::swap(pending, other.pending);
+        std::swap(linked, other.linked);
+        std::swap(cacheKey, other.cacheKey);
+        std::swap(programPaths, other.programPaths);
+        std::swap(programDefines, other.programDefines);
+    }
+    void release()
+    {
+        for (GLuint &stage : pendingStages)
+        {
+            if (stage != 0)
+                glDeleteShader(stage);
+            stage = 0;
+        }
+        if (ID != 0)
+        {
+            GLState::forgetProgram(ID);
+            glDeleteProgram(ID);
+        }
+        ID = 0;
+        pending = false;
+    }
+
+    // attach the compiled stages and start linking, transform feedback outputs have to be declared before
+    void link()
+    {
+        ID = glCreateProgram();
+        for (GLuint stage : pendingStages)
+            if (stage != 0)
+                glAttachShader(ID, stage);
+        if (!feedbackVaryings.empty())
+        {
+            std::vector<const char *> names;
+            for (const std::string &name : feedbackVaryings)
+                names.push_back(name.c_str());
+            glTransformFeedbackVaryings(ID, (GLsizei)names.size(), names.data(), GL_INTERLEAVED_ATTRIBS);
+        }
+        if (programBinarySupported())
+            glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(ID);
+        pending = true;
+    }
+    // the captured outputs are part of the linked binary, so part of its cache key
+    std::string feedbackKey() const
+    {
+        std::string key;
+        for (const std::string &name : feedbackVaryings)
+            key += "|feedback:" + name;
+        return key;
+    }
+
+    // read one stage and run the small preprocessor over it
+    // ------------------------------------------------------------------------
+    std::string loadSource(const std::string &path, const ShaderDefines &defines)
+    {
+        std::vector<std::string> included;
+        std::string code = expandIncludes(path, included, 0);
+        sourceFiles.insert(sourceFiles.end(), included.begin(), included.end());
+        return injectDefines(code, defines);
+    }
+
+    // #include "file" is resolved next to the including file first, then in includeDir.
+    // every file is pasted at most once per stage, #line keeps compiler messages pointing at the right line.
+    static std::string expandIncludes(const std::string &path, std::vector<std::string> &included, int depth)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+            return "";
+        }
+        included.push_back(path);
+        std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+
+        std::stringstream result;
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line))
+        {
+            lineNumber++;
+            size_t first = line.find_first_not_of(" \t");
+            if (first == std::string::npos || line.compare(first, 8, "#include") != 0)
+            {
+                result << line << '\n';
+                continue;
+            }
+            size_t open = line.find('"', first);
+            size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+            if (close == std::string::npos || depth > 16)
+            {
+                std::cout << "ERROR::SHADER::BAD_INCLUDE " << path << ":" << lineNumber << std::endl;
+                result << '\n';
+                continue;
+            }
+            std::string name = line.substr(open + 1, close - open - 1);
+            std::string includePath = directory + name;
+            if (!std::ifstream(includePath))
+                includePath = includeDir + name;
+            if (std::find(included.begin(), included.end(), includePath) != included.end())
+            {
+                result << '\n';
+                continue;
+            }
+            result << "#line 1\n"
+                   << expandIncludes(includePath, included, depth + 1)
+                   << "#line " << lineNumber + 1 << '\n';
+        }
+        return result.str();
+    }
+
+    static std::string injectDefines(const std::string &code, const ShaderDefines &defines)
+    {
+        if (defines.empty())
+            return code;
+        std::string block;
+        for (const std::pair<std::string, std::string> &define : defines)
+            block += "#define " + define.first + " " + define.second + "\n";
+        // #version has to stay the first directive
+        size_t version = code.find("#version");
+        if (version == std::string::npos)
+            return block + "#line 1\n" + code;
+        size_t lineEnd = code.find('\n', version);
+        if (lineEnd == std::string::npos)
+            return code + "\n" + block;
+        long versionLine = std::count(code.begin(), code.begin() + version, '\n') + 1;
+        return code.substr(0, lineEnd + 1) + block + "#line " + std::to_string(versionLine + 1) + "\n" + code.substr(lineEnd + 1);
+    }
+
+    static GLuint compileStage(GLenum type, const std::string &code)
+    {
+        const char *source = code.c_str();
+        GLuint stage = glCreateShader(type);
+        glShaderSource(stage, 1, &source, NULL);
+        glCompileShader(stage);
+        return stage;
+    }
+
+    static bool hasExtension(const char *name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            const GLubyte *extension = glGetStringi(GL_EXTENSIONS, (GLuint)i);
+            if (extension && std::string((const char *)extension) == name)
+                return true;
+        }
+        return false;
+    }
+
+    static bool parallelCompileSupported()
+    {
+        static int supported = -1;
+        if (supported < 0)
+            supported = hasExtension("GL_KHR_parallel_shader_compile") || hasExtension("GL_ARB_parallel_shader_compile");
+        return supported == 1;
+    }
+
+    // resolve a uniform name through the table built at link time
+    // ------------------------------------------------------------------------
+    GLint location(const std::string &name) const
+    {
+        if (!useLocationCache || !uniformLocations)
+        {
+            locationQueries++;
+            return glGetUniformLocation(ID, name.c_str());
+        }
+        UniformTable::const_iterator it = uniformLocations->find(name);
+        return it != uniformLocations->end() ? it->second : -1;
+    }
+
+    // connect the active uniform blocks with a known name to their binding point
+    // ------------------------------------------------------------------------
+    void bindUniformBlocks()
+    {
+        GLint count = 0;
+        GLint maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+        std::vector<GLchar> nameBuffer(maxLength > 0 ? maxLength : 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            glGetActiveUniformBlockName(ID, (GLuint)i, (GLsizei)nameBuffer.size(), &length, nameBuffer.data());
+            std::unordered_map<std::string, GLuint>::const_iterator binding = blockBindings.find(std::string(nameBuffer.data(), length));
+            if (binding != blockBindings.end())
+                glUniformBlockBinding(ID, (GLuint)i, binding->second);
+        }
+    }
+    // introspect all active uniforms once after linking.
+    // arrays are reported as "name[0]", so the bare name and every element are registered as well.
+    // ------------------------------------------------------------------------
+    void loadUniformLocations()
+    {
+        std::shared_ptr<UniformTable> table = std::make_shared<UniformTable>();
+
+        GLint count = 0;
+        GLint maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> nameBuffer(maxLength > 0 ? maxLength : 1);
+        table->reserve(count);
+
+        for (GLint i = 0; i < count; i++)
+        {
+            GLint size = 0;
+            GLenum type = 0;
+            GLsizei length = 0;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+
+            std::string name(nameBuffer.data(), length);
+            GLint loc = glGetUniformLocation(ID, name.c_str());
+            // members of uniform blocks have no location
+            if (loc < 0)
+                continue;
+            (*table)[name] = loc;
+
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+            {
+                std::string base = name.substr(0, name.size() - 3);
+                (*table)[base] = loc;
+                for (GLint e = 1; e < size; e++)
+                {
+                    std::string element = base + "[" + std::to_string(e) + "]";
+                    (*table)[element] = glGetUniformLocation(ID, element.c_str());
+                }
+            }
+        }
+        uniformLocations = table;
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -205,6 +654,107 @@ private:
                           << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success == GL_TRUE;
+    }
+
+    // program binary cache
+    // ------------------------------------------------------------------------
+    static bool programBinarySupported()
+    {
+        if (!useProgramCache || glGetProgramBinary == NULL || glProgramBinary == NULL || glProgramParameteri == NULL)
+            return false;
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    // 64-bit FNV-1a over the program sources and the driver that produced the binary
+    static std::string programCacheKey(const std::string &vertexCode, const std::string &fragmentCode, const std::string &geometryCode)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        std::string parts[6] = {vertexCode, fragmentCode, geometryCode, "", "", ""};
+        const GLubyte *vendor = glGetString(GL_VENDOR);
+        const GLubyte *renderer = glGetString(GL_RENDERER);
+        const GLubyte *version = glGetString(GL_VERSION);
+        if (vendor)
+            parts[3] = (const char *)vendor;
+        if (renderer)
+            parts[4] = (const char *)renderer;
+        if (version)
+            parts[5] = (const char *)version;
+        for (const std::string &part : parts)
+        {
+            for (unsigned char c : part)
+            {
+                hash ^= c;
+                hash *= 1099511628211ull;
+            }
+            // separator, so that moving text between stages changes the key
+            hash ^= 0xff;
+            hash *= 1099511628211ull;
+        }
+        char name[17];
+        snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+        return name;
+    }
+
+    bool loadProgramBinary(const std::string &key)
+    {
+        if (!programBinarySupported())
+            return false;
+        std::ifstream file(cacheDir + key + ".bin", std::ios::binary | std::ios::ate);
+        if (!file)
+            return false;
+        std::streamoff fileSize = file.tellg();
+        file.seekg(0);
+        GLenum format = 0;
+        uint32_t length = 0;
+        file.read((char *)&format, sizeof(format));
+        file.read((char *)&length, sizeof(length));
+        // a truncated or corrupt entry: the length has to match what is left of the file before anything is allocated
+        std::streamoff header = sizeof(format) + sizeof(length);
+        if (!file || length == 0 || fileSize - header != (std::streamoff)length)
+            return false;
+        std::vector<char> binary(length);
+        file.read(binary.data(), length);
+        if (!file)
+            return false;
+
+        ID = glCreateProgram();
+        glProgramBinary(ID, format, binary.data(), (GLsizei)length);
+        GLint success = GL_FALSE;
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        if (success != GL_TRUE)
+        {
+            // driver update or a different GPU: rebuild from source and overwrite the entry
+            glDeleteProgram(ID);
+            ID = 0;
+            return false;
+        }
+        return true;
+    }
+
+    void saveProgramBinary(const std::string &key)
+    {
+        if (!programBinarySupported())
+            return;
+        GLint length = 0;
+        glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        glGetProgramBinary(ID, length, NULL, &format, binary.data());
+
+        std::error_code error;
+        std::filesystem::create_directories(cacheDir, error);
+        std::ofstream file(cacheDir + key + ".bin", std::ios::binary | std::ios::trunc);
+        if (!file)
+            return;
+        uint32_t size = (uint32_t)length;
+        file.write((const char *)&format, sizeof(format));
+        file.write((const char *)&size, sizeof(size));
+        file.write(binary.data(), length);
     }
 };
 
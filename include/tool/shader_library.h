@@ -0,0 +1,142 @@
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include <tool/shader.h>
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+
+// Submits every program up front so the driver can compile them in parallel
+// (KHR_parallel_shader_compile), and only waits for a program the first time it is used.
+// While a program is still compiling, get() hands out the fallback program instead.
+class ShaderLibrary
+{
+public:
+    // called once, right after the program has been linked (set sampler units etc.)
+    typedef std::function<void(Shader &)> ReadyCallback;
+
+    // submit a program for compilation, returns immediately.
+    // a name that exists already is replaced: references to the old program are no longer valid, and it stops
+    // being the fallback if it was
+    // ------------------------------------------------------------------------
+    void add(const std::string &name, const char *vertexPath, const char *fragmentPath, const char *geometryPath = nullptr, ReadyCallback onReady = nullptr, const ShaderDefines &defines = ShaderDefines())
+    {
+        std::unordered_map<std::string, std::unique_ptr<Entry>>::iterator existing = entries.find(name);
+        if (existing != entries.end())
+        {
+            Entry *old = existing->second.get();
+            order.erase(std::find(order.begin(), order.end(), old));
+            if (fallback == &old->shader)
+                fallback = nullptr;
+        }
+        std::unique_ptr<Entry> entry(new Entry());
+        entry->shader.submit(vertexPath, fragmentPath, geometryPath, defines);
+        entry->onReady = onReady;
+        order.push_back(entry.get());
+        entries[name] = std::move(entry);
+    }
+    // a program specialised by a define set. every distinct permutation is built once and then reused.
+    // ------------------------------------------------------------------------
+    Shader &permutation(const char *vertexPath, const char *fragmentPath, const ShaderDefines &defines, const char *geometryPath = nullptr)
+    {
+        std::string key = std::string(vertexPath) + "|" + fragmentPath + "|" + (geometryPath != nullptr ? geometryPath : "");
+        for (const std::pair<std::string, std::string> &define : defines)
+            key += "|" + define.first + "=" + define.second;
+        if (entries.find(key) == entries.end())
+            add(key, vertexPath, fragmentPath, geometryPath, nullptr, defines);
+        return wait(key);
+    }
+    // program used in place of any program that is not ready yet. it is finished immediately.
+    // ------------------------------------------------------------------------
+    void setFallback(const std::string &name)
+    {
+        fallback = &wait(name);
+    }
+    // non blocking: has the driver finished this program?
+    // ------------------------------------------------------------------------
+    bool ready(const std::string &name)
+    {
+        Entry &entry = find(name);
+        return !entry.shader.isPending() || entry.shader.isReady();
+    }
+    // the program if it is ready, otherwise the fallback. blocks only when there is no fallback.
+    // ------------------------------------------------------------------------
+    Shader &get(const std::string &name)
+    {
+        Entry &entry = find(name);
+        if (entry.finished)
+            return entry.shader;
+        if (fallback != nullptr && !entry.shader.isReady())
+            return *fallback;
+        return finish(entry);
+    }
+    // the program itself, waiting for the driver if needed
+    // ------------------------------------------------------------------------
+    Shader &wait(const std::string &name)
+    {
+        Entry &entry = find(name);
+        return entry.finished ? entry.shader : finish(entry);
+    }
+    // finish every program whose compilation has completed, call once per frame
+    // ------------------------------------------------------------------------
+    void poll()
+    {
+        for (Entry *entry : order)
+            if (!entry->finished && entry->shader.isReady())
+                finish(*entry);
+    }
+    void waitAll()
+    {
+        for (Entry *entry : order)
+            if (!entry->finished)
+                finish(*entry);
+    }
+    unsigned int pendingCount() const
+    {
+        unsigned int count = 0;
+        for (const Entry *entry : order)
+            if (!entry->finished)
+                count++;
+        return count;
+    }
+
+private:
+    struct Entry
+    {
+        Shader shader;
+        ReadyCallback onReady;
+        bool finished = false;
+    };
+
+    std::unordered_map<std::string, std::unique_ptr<Entry>> entries;
+    std::vector<Entry *> order; // submission order
+    Shader *fallback = nullptr;
+
+    Entry &find(const std::string &name)
+    {
+        if (entries.find(name) == entries.end())
+            std::cout << "ERROR::SHADER_LIBRARY::UNKNOWN_PROGRAM " << name << std::endl;
+        return *entries.at(name);
+    }
+
+    Shader &finish(Entry &entry)
+    {
+        entry.shader.finish();
+        entry.finished = true;
+        if (entry.onReady)
+        {
+            GLint current = 0;
+            glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+            entry.shader.use();
+            entry.onReady(entry.shader);
+            GLState::useProgram(current);
+        }
+        return entry.shader;
+    }
+};
+
+#endif
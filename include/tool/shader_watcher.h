@@ -0,0 +1,204 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <tool/shader.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <filesystem>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+// Hot reload for shaders: watches the source files of registered programs (includes too)
+// and rebuilds a program in the background when one of them changes.
+// The new program replaces the old one in update() only if it links, otherwise the old one stays.
+// The rebuild is submitted in one update() and picked up in a later one: with KHR_parallel_shader_compile once the
+// driver reports completion, so the frame never waits for the compiler. Without it the driver compiles inside the
+// submit or the status query, and the frame that does it stalls for that long; splitting the two over frames
+// keeps it to one stall per frame at least.
+// On Linux changes come from inotify, elsewhere the file modification times are polled.
+class ShaderWatcher
+{
+public:
+    // called after a program was replaced, to set samplers again and refresh uniform handles
+    typedef std::function<void(Shader &)> ReloadCallback;
+
+    ShaderWatcher()
+    {
+#ifdef __linux__
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd < 0)
+            std::cout << "ERROR::SHADER_WATCHER::INOTIFY_INIT_FAILED, falling back to polling" << std::endl;
+#endif
+    }
+    ~ShaderWatcher()
+    {
+#ifdef __linux__
+        if (inotifyFd >= 0)
+            close(inotifyFd);
+#endif
+    }
+    ShaderWatcher(const ShaderWatcher &) = delete;
+    ShaderWatcher &operator=(const ShaderWatcher &) = delete;
+
+    void watch(Shader &shader, ReloadCallback onReload = nullptr)
+    {
+        std::unique_ptr<Watched> watched(new Watched());
+        watched->shader = &shader;
+        watched->onReload = onReload;
+        watchFiles(*watched);
+        programs.push_back(std::move(watched));
+    }
+
+    // call once per frame, before any drawing: this is the only place programs are swapped
+    // ------------------------------------------------------------------------
+    void update()
+    {
+        collectChanges();
+        for (std::unique_ptr<Watched> &watched : programs)
+        {
+            if (watched->dirty && !watched->rebuild)
+            {
+                // deferred link: submit now, pick the result up in a later frame.
+                // isReady() is always true without the parallel compile extension, so it is not asked in this one
+                watched->dirty = false;
+                watched->rebuild.reset(new Shader());
+                watched->shader->resubmit(*watched->rebuild);
+                continue;
+            }
+            if (watched->rebuild && watched->rebuild->isReady())
+                swapIn(*watched);
+        }
+    }
+
+    unsigned int reloadCount() const
+    {
+        return reloads;
+    }
+
+private:
+    struct Watched
+    {
+        Shader *shader;
+        ReloadCallback onReload;
+        std::unique_ptr<Shader> rebuild;
+        std::vector<std::string> files; // canonical paths
+        std::vector<std::filesystem::file_time_type> times;
+        bool dirty = false;
+    };
+
+    std::vector<std::unique_ptr<Watched>> programs;
+    unsigned int reloads = 0;
+#ifdef __linux__
+    int inotifyFd = -1;
+    std::vector<std::pair<int, std::string>> watchedDirs; // watch descriptor -> canonical directory
+#endif
+
+    static std::string canonical(const std::string &path)
+    {
+        std::error_code error;
+        std::filesystem::path result = std::filesystem::weakly_canonical(path, error);
+        return error ? path : result.string();
+    }
+
+    void watchFiles(Watched &watched)
+    {
+        watched.files.clear();
+        watched.times.clear();
+        for (const std::string &file : watched.shader->sourceFiles)
+        {
+            std::string path = canonical(file);
+            std::error_code error;
+            watched.files.push_back(path);
+            watched.times.push_back(std::filesystem::last_write_time(path, error));
+#ifdef __linux__
+            // watch the directory, editors usually save by writing a new file and renaming it over the old one
+            std::string directory = std::filesystem::path(path).parent_path().string();
+            bool known = false;
+            for (const std::pair<int, std::string> &dir : watchedDirs)
+                known = known || dir.second == directory;
+            if (!known && inotifyFd >= 0)
+            {
+                int wd = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+                if (wd >= 0)
+                    watchedDirs.push_back(std::make_pair(wd, directory));
+            }
+#endif
+        }
+    }
+
+    void markChanged(const std::string &path)
+    {
+        for (std::unique_ptr<Watched> &watched : programs)
+            for (const std::string &file : watched->files)
+                if (file == path)
+                    watched->dirty = true;
+    }
+
+    void collectChanges()
+    {
+#ifdef __linux__
+        if (inotifyFd >= 0)
+        {
+            alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+            ssize_t length;
+            while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+            {
+                for (char *at = buffer; at < buffer + length;)
+                {
+                    const inotify_event *event = (const inotify_event *)at;
+                    for (const std::pair<int, std::string> &dir : watchedDirs)
+                        if (dir.first == event->wd && event->len > 0)
+                            markChanged(dir.second + "/" + event->name);
+                    at += sizeof(inotify_event) + event->len;
+                }
+            }
+            return;
+        }
+#endif
+        for (std::unique_ptr<Watched> &watched : programs)
+        {
+            for (size_t i = 0; i < watched->files.size(); i++)
+            {
+                std::error_code error;
+                std::filesystem::file_time_type time = std::filesystem::last_write_time(watched->files[i], error);
+                if (!error && time != watched->times[i])
+                {
+                    watched->times[i] = time;
+                    watched->dirty = true;
+                }
+            }
+        }
+    }
+
+    void swapIn(Watched &watched)
+    {
+        std::unique_ptr<Shader> next = std::move(watched.rebuild);
+        if (!next->finish())
+        {
+            // the failed program is deleted together with next
+            std::cout << "SHADER_WATCHER::RELOAD_FAILED, keeping the previous program " << watched.shader->ID << std::endl;
+            return;
+        }
+        watched.shader->replaceProgram(*next);
+        // an #include may have been added or removed
+        watchFiles(watched);
+        reloads++;
+        // update() runs at the frame boundary, every pass calls use() again before drawing
+        if (watched.onReload)
+        {
+            watched.shader->use();
+            watched.onReload(*watched.shader);
+        }
+        std::cout << "SHADER_WATCHER::RELOADED program " << watched.shader->ID << std::endl;
+    }
+};
+
+#endif
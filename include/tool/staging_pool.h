@@ -0,0 +1,201 @@
+#ifndef STAGING_POOL_H
+#define STAGING_POOL_H
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+
+// Reusable CPU memory for pixel data on its way to GL (decoded images and their mip chains).
+// A texture load takes a Buffer, fills it on a worker, uploads from it on the GL thread and drops it; the memory
+// goes back to the pool instead of the heap, so the next load writes into pages that are already resident.
+// Idle memory is kept up to idleLimit bytes, the largest idle buffers are freed first. Buffers are not zero filled.
+//   acquire(bytes)  smallest idle buffer that fits (and is not more than twice too large), or a new one; sizes are
+//                   rounded up to eighths of a power of two so images of similar size share buffers
+// Thread safe, buffers may outlive the pool (they keep its state alive).
+class StagingPool
+{
+public:
+    struct Stats
+    {
+        unsigned int allocated = 0; // buffers taken from the heap
+        unsigned int reused = 0;    // acquires served from idle buffers
+        size_t idleBytes = 0;
+        size_t peakBytes = 0; // most memory held at once, idle and in use
+    };
+
+private:
+    struct State
+    {
+        struct Idle
+        {
+            std::unique_ptr<unsigned char[]> memory;
+            size_t capacity;
+        };
+        std::mutex mutex;
+        std::vector<Idle> idle;
+        size_t idleLimit = 0;
+        size_t heldBytes = 0;
+        Stats stats;
+
+        // caller holds the mutex
+        void shrink(size_t limit)
+        {
+            while (stats.idleBytes > limit && !idle.empty())
+            {
+                size_t largest = 0;
+                for (size_t i = 1; i < idle.size(); i++)
+                    if (idle[i].capacity > idle[largest].capacity)
+                        largest = i;
+                stats.idleBytes -= idle[largest].capacity;
+                heldBytes -= idle[largest].capacity;
+                idle.erase(idle.begin() + largest);
+            }
+        }
+    };
+
+public:
+    class Buffer
+    {
+    public:
+        Buffer() = default;
+        Buffer(const Buffer &) = delete;
+        Buffer &operator=(const Buffer &) = delete;
+        Buffer(Buffer &&other) noexcept
+        {
+            swap(other);
+        }
+        Buffer &operator=(Buffer &&other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                swap(other);
+            }
+            return *this;
+        }
+        ~Buffer()
+        {
+            release();
+        }
+
+        unsigned char *data() const
+        {
+            return memory.get();
+        }
+        // the size asked for, the allocation may be larger
+        size_t size() const
+        {
+            return length;
+        }
+
+    private:
+        friend class StagingPool;
+        std::shared_ptr<State> state;
+        std::unique_ptr<unsigned char[]> memory;
+        size_t capacity = 0;
+        size_t length = 0;
+
+        void release()
+        {
+            if (memory == nullptr || state == nullptr)
+                return;
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->idle.push_back({std::move(memory), capacity});
+            state->stats.idleBytes += capacity;
+            state->shrink(state->idleLimit);
+            capacity = 0;
+            length = 0;
+        }
+        void swap(Buffer &other)
+        {
+            std::swap(state, other.state);
+            std::swap(memory, other.memory);
+            std::swap(capacity, other.capacity);
+            std::swap(length, other.length);
+        }
+    };
+
+    static StagingPool &shared()
+    {
+        static StagingPool pool;
+        return pool;
+    }
+
+    explicit StagingPool(size_t idleLimit = 64 * 1024 * 1024) : state(std::make_shared<State>())
+    {
+        state->idleLimit = idleLimit;
+    }
+    StagingPool(const StagingPool &) = delete;
+    StagingPool &operator=(const StagingPool &) = delete;
+
+    Buffer acquire(size_t bytes)
+    {
+        Buffer buffer;
+        buffer.state = state;
+        buffer.length = bytes;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            size_t best = state->idle.size();
+            for (size_t i = 0; i < state->idle.size(); i++)
+            {
+                size_t capacity = state->idle[i].capacity;
+                // a small image does not get to hold on to a large buffer
+                if (capacity >= bytes && capacity <= bytes * 2 && (best == state->idle.size() || capacity < state->idle[best].capacity))
+                    best = i;
+            }
+            if (best < state->idle.size())
+            {
+                buffer.memory = std::move(state->idle[best].memory);
+                buffer.capacity = state->idle[best].capacity;
+                state->idle.erase(state->idle.begin() + best);
+                state->stats.idleBytes -= buffer.capacity;
+                state->stats.reused++;
+                return buffer;
+            }
+            bytes = sizeClass(bytes);
+            state->stats.allocated++;
+            state->heldBytes += bytes;
+            state->stats.peakBytes = std::max(state->stats.peakBytes, state->heldBytes);
+        }
+        // default initialized, the caller writes every byte anyway
+        buffer.memory.reset(new unsigned char[bytes > 0 ? bytes : 1]);
+        buffer.capacity = bytes;
+        return buffer;
+    }
+
+    Stats stats() const
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->stats;
+    }
+    // 0 turns reuse off, every buffer goes back to the heap when it is dropped
+    void setIdleLimit(size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->idleLimit = bytes;
+        state->shrink(bytes);
+    }
+    // free every idle buffer, e.g. after a loading screen
+    void trim()
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->shrink(0);
+    }
+
+private:
+    std::shared_ptr<State> state;
+
+    // at most 12.5% larger than asked for
+    static size_t sizeClass(size_t bytes)
+    {
+        size_t step = 4096;
+        while (step * 16 <= bytes)
+            step *= 2;
+        return (bytes + step - 1) / step * step;
+    }
+};
+
+#endif
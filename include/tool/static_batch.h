@@ -0,0 +1,253 @@
+#ifndef STATIC_BATCH_H
+#define STATIC_BATCH_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <geometry/GeometryView.h>
+
+#include <tool/shader.h>
+#include <tool/mesh.h>
+#include <tool/gl_state.h>
+
+#include <vector>
+#include <tuple>
+#include <numeric>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+// Objects that do not move, drawn with a few calls per pass instead of a glDrawElements and a model uniform each.
+// add() collects an object (its geometry, model matrix and four material parameters), build() sorts the objects by
+// geometry and uploads them once: matrix and parameters into a buffer texture (5 RGBA32F texels per object, read by
+// static/shader/static_batch.glsl) and one object index per instance (attribute OBJECT_LOCATION, divisor 1).
+// Every geometry becomes one draw command over its objects, draw() submits them
+//   MULTI_DRAW_INDIRECT  GL 4.3: baseInstance selects the objects of a command, one glMultiDrawElementsIndirect per
+//                        vertex array and index type (one for all meshes of a GeometryArena)
+//   INSTANCED            GL 3.3: one glDrawElementsInstancedBaseVertex per geometry, without base instance the index
+//                        attribute is moved to the objects of each command instead
+// Shaders drawing the batch are compiled with defines() and take the matrix from objectModel() (static_batch.glsl).
+class StaticBatch
+{
+public:
+    enum Path
+    {
+        MULTI_DRAW_INDIRECT,
+        INSTANCED
+    };
+
+    static const GLuint OBJECT_LOCATION = 9;
+
+    struct Stats
+    {
+        unsigned int objects = 0;
+        unsigned int commands = 0; // geometries, set by build()
+        unsigned int calls = 0;    // draw calls of the last draw()
+    };
+    Stats stats;
+
+    static Path preferredPath()
+    {
+        return GLAD_GL_VERSION_4_3 ? MULTI_DRAW_INDIRECT : INSTANCED;
+    }
+
+    static ShaderDefines defines()
+    {
+        return ShaderDefines{std::make_pair("STATIC_BATCH", "1")};
+    }
+
+    explicit StaticBatch(Path path = preferredPath()) : batchPath(path)
+    {
+        glGenBuffers(1, &objectBuffer);
+        glGenBuffers(1, &indexBuffer);
+        glGenTextures(1, &objectTexture);
+        if (batchPath == MULTI_DRAW_INDIRECT)
+            glGenBuffers(1, &commandBuffer);
+    }
+    StaticBatch(const StaticBatch &) = delete;
+    StaticBatch &operator=(const StaticBatch &) = delete;
+    ~StaticBatch()
+    {
+        if (!GLState::contextCurrent())
+            return;
+        GLState::forgetTexture(objectTexture);
+        glDeleteTextures(1, &objectTexture);
+        glDeleteBuffers(1, &objectBuffer);
+        glDeleteBuffers(1, &indexBuffer);
+        if (commandBuffer != 0)
+            glDeleteBuffers(1, &commandBuffer);
+    }
+
+    Path path() const
+    {
+        return batchPath;
+    }
+
+    // params are free for the shader, e.g. metallic and roughness; the batch is drawn as it was at the last build()
+    // ------------------------------------------------------------------------
+    void add(GeometryView geometry, const glm::mat4 &model, const glm::vec4 &params = glm::vec4(0.0f))
+    {
+        objects.push_back({{geometry.VAO, geometry.indexType, geometry.firstIndex, geometry.count, geometry.baseVertex}, model, params});
+    }
+    // the full level of a mesh, also when it lives in a GeometryArena (rebuild after the arena defragmented)
+    void add(const Mesh &mesh, const glm::mat4 &model, const glm::vec4 &params = glm::vec4(0.0f))
+    {
+        objects.push_back({{mesh.VAO, mesh.indexType, mesh.firstIndex() + mesh.lods[0].firstIndex, mesh.lods[0].indexCount, mesh.baseVertex()}, model, params});
+    }
+    void clear()
+    {
+        objects.clear();
+    }
+    size_t size() const
+    {
+        return objects.size();
+    }
+
+    // ------------------------------------------------------------------------
+    void build()
+    {
+        // the same geometry next to each other, the objects of a command are a contiguous range
+        std::stable_sort(objects.begin(), objects.end(), [](const Object &a, const Object &b) { return a.geometry.key() < b.geometry.key(); });
+
+        commands.clear();
+        groups.clear();
+        for (size_t i = 0; i < objects.size(); i++)
+        {
+            const Geometry &geometry = objects[i].geometry;
+            if (i > 0 && geometry.key() == objects[i - 1].geometry.key())
+            {
+                commands.back().instanceCount++;
+                continue;
+            }
+            if (groups.empty() || groups.back().VAO != geometry.VAO || groups.back().indexType != geometry.indexType)
+                groups.push_back({geometry.VAO, geometry.indexType, (GLuint)commands.size(), 0});
+            commands.push_back({(GLuint)geometry.count, 1, geometry.firstIndex, geometry.baseVertex, (GLuint)i});
+            groups.back().commandCount++;
+        }
+
+        std::vector<glm::vec4> texels;
+        texels.reserve(objects.size() * 5);
+        for (const Object &object : objects)
+        {
+            for (int column = 0; column < 4; column++)
+                texels.push_back(object.model[column]);
+            texels.push_back(object.params);
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, objectBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, texels.size() * sizeof(glm::vec4), texels.data(), GL_STATIC_DRAW);
+        GLState::bindTexture(0, GL_TEXTURE_BUFFER, objectTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, objectBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        // instance i of a command reads object baseInstance + i
+        std::vector<GLuint> indices(objects.size());
+        std::iota(indices.begin(), indices.end(), 0u);
+        glBindBuffer(GL_ARRAY_BUFFER, indexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        if (batchPath == MULTI_DRAW_INDIRECT)
+        {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(Command), commands.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+        stats.objects = (unsigned int)objects.size();
+        stats.commands = (unsigned int)commands.size();
+    }
+
+    // the objects for objectModel()/objectParams(), on the given texture unit
+    // ------------------------------------------------------------------------
+    void bindObjects(Shader &shader, unsigned int unit) const
+    {
+        shader.setInt("batchObjects", (int)unit);
+        GLState::bindTexture(unit, GL_TEXTURE_BUFFER, objectTexture);
+    }
+
+    // draw every object of the last build(), the shader is in use
+    // ------------------------------------------------------------------------
+    void draw()
+    {
+        stats.calls = 0;
+        if (batchPath == MULTI_DRAW_INDIRECT)
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        for (const Group &group : groups)
+        {
+            // the index attribute is set up for the draw only, other batches or draws may use the same vertex array
+            GLState::bindVertexArray(group.VAO);
+            glBindBuffer(GL_ARRAY_BUFFER, indexBuffer);
+            glEnableVertexAttribArray(OBJECT_LOCATION);
+            glVertexAttribDivisor(OBJECT_LOCATION, 1);
+            if (batchPath == MULTI_DRAW_INDIRECT)
+            {
+                glVertexAttribIPointer(OBJECT_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void *)0);
+                glMultiDrawElementsIndirect(GL_TRIANGLES, group.indexType, (void *)(group.firstCommand * sizeof(Command)), (GLsizei)group.commandCount, 0);
+                stats.calls++;
+            }
+            else
+            {
+                for (GLuint i = group.firstCommand; i < group.firstCommand + group.commandCount; i++)
+                {
+                    const Command &command = commands[i];
+                    glVertexAttribIPointer(OBJECT_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void *)(command.baseInstance * sizeof(GLuint)));
+                    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)command.count, group.indexType, (void *)(command.firstIndex * indexSize(group.indexType)),
+                                                      (GLsizei)command.instanceCount, command.baseVertex);
+                    stats.calls++;
+                }
+            }
+            glDisableVertexAttribArray(OBJECT_LOCATION);
+            glVertexAttribDivisor(OBJECT_LOCATION, 0);
+        }
+        if (batchPath == MULTI_DRAW_INDIRECT)
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        GLState::bindVertexArray(0);
+    }
+
+private:
+    struct Geometry
+    {
+        GLuint VAO;
+        GLenum indexType;
+        GLuint firstIndex;
+        GLsizei count;
+        GLint baseVertex;
+
+        std::tuple<GLuint, GLenum, GLuint, GLsizei, GLint> key() const
+        {
+            return std::make_tuple(VAO, indexType, firstIndex, count, baseVertex);
+        }
+    };
+    struct Object
+    {
+        Geometry geometry;
+        glm::mat4 model;
+        glm::vec4 params;
+    };
+    // DrawElementsIndirectCommand
+    struct Command
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+    // commands drawn from the same vertex array with the same index type
+    struct Group
+    {
+        GLuint VAO;
+        GLenum indexType;
+        GLuint firstCommand;
+        GLuint commandCount;
+    };
+
+    Path batchPath;
+    GLuint objectBuffer = 0, objectTexture = 0, indexBuffer = 0, commandBuffer = 0;
+    std::vector<Object> objects;
+    std::vector<Command> commands;
+    std::vector<Group> groups;
+};
+
+#endif
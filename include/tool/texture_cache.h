@@ -0,0 +1,223 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <tool/gl_state.h>
+#include <tool/thread_pool.h>
+#include <tool/texture_streamer.h>
+#include <tool/image_loader.h>
+#include <tool/dds.h>
+
+#include <string>
+#include <unordered_map>
+#include <filesystem>
+#include <iostream>
+
+// Textures shared by everything that loads images from disk: two models (or a model and a sample) asking for the
+// same file with the same parameters get the same texture name, decoded and uploaded once.
+//   acquire()   texture for a file, the key is the canonical path plus gamma, flip, wrap and kind; counts a reference
+//   release()   drops a reference, the texture is deleted with the last one
+// Files that fail to load are not kept: acquire() returns 0 for them (a streamed one keeps its placeholder), and the
+// next acquire() of the file tries again.
+// Lookups go through hash maps in both directions, stats counts hits/misses and the bytes of the resident textures
+// (all mip levels). With a TextureStreamer the misses are loaded in the background, otherwise ImageLoader decodes
+// the image and builds its mip chain on the thread pool and it is uploaded before acquire() returns.
+// A block compressed copy next to the image (same name, .dds, written by src/54_texture_compress) replaces it
+// when it is not older than the image, with its own mip chain. Flipped loads always use the image.
+// Like model.h, include tool/stb_image.h (with STB_IMAGE_IMPLEMENTATION in main.cpp) before this file.
+class TextureCache
+{
+public:
+    struct Stats
+    {
+        unsigned long long hits = 0;
+        unsigned long long misses = 0;
+        unsigned int resident = 0;
+        unsigned long long residentBytes = 0;
+
+        double hitRate() const
+        {
+            unsigned long long lookups = hits + misses;
+            return lookups > 0 ? (double)hits / lookups : 0.0;
+        }
+    };
+    Stats stats;
+
+    // load the .dds written for an image instead of the image
+    static inline bool preferCompressed = true;
+
+    static TextureCache &shared()
+    {
+        static TextureCache cache;
+        return cache;
+    }
+
+    TextureCache() = default;
+    TextureCache(const TextureCache &) = delete;
+    TextureCache &operator=(const TextureCache &) = delete;
+
+    // gamma: stored as GL_SRGB, flip: first row of the file at the bottom, streamer: load in the background,
+    // kind: how the mip levels are filtered
+    // ------------------------------------------------------------------------
+    GLuint acquire(const std::string &path, bool gamma = false, bool flip = false, GLenum wrap = GL_REPEAT, TextureStreamer *streamer = nullptr,
+                   TextureKind kind = TEXTURE_DATA)
+    {
+        std::string key = makeKey(path, gamma, flip, wrap, kind);
+        std::unordered_map<std::string, GLuint>::iterator found = byKey.find(key);
+        if (found != byKey.end())
+        {
+            stats.hits++;
+            entries[found->second].refs++;
+            return found->second;
+        }
+        stats.misses++;
+
+        Entry entry;
+        entry.key = key;
+        if (preferCompressed && !flip)
+            entry.texture = loadCompressed(path, gamma, wrap, entry.bytes);
+        if (entry.texture == 0 && streamer != nullptr)
+        {
+            entry.texture = streamer->request(path, gamma, flip, wrap, kind);
+            entry.streamer = streamer;
+            entry.bytes = 4;
+            // the real size is known once the image is uploaded, a file that fails is looked up again next time
+            streamer->cacheLoaded = [this](GLuint texture, size_t bytes) { resize(texture, bytes); };
+            streamer->cacheFailed = [this](GLuint texture) { evict(texture); };
+        }
+        else if (entry.texture == 0)
+        {
+            entry.texture = load(path, gamma, flip, wrap, kind, entry.bytes);
+            // not cached, the next acquire() tries the file again
+            if (entry.texture == 0)
+                return 0;
+        }
+
+        byKey[key] = entry.texture;
+        entries[entry.texture] = entry;
+        stats.resident++;
+        stats.residentBytes += entry.bytes;
+        return entry.texture;
+    }
+
+    // another reference to a texture handed out by acquire(), for code that copies the name
+    void retain(GLuint texture)
+    {
+        std::unordered_map<GLuint, Entry>::iterator found = entries.find(texture);
+        if (found != entries.end())
+            found->second.refs++;
+    }
+
+    void release(GLuint texture)
+    {
+        std::unordered_map<GLuint, Entry>::iterator found = entries.find(texture);
+        if (found == entries.end() || --found->second.refs > 0)
+            return;
+        Entry &entry = found->second;
+        // without a context (after glfwTerminate) the texture is already gone with it
+        if (GLState::contextCurrent())
+        {
+            if (entry.streamer != nullptr && !entry.streamer->isLoaded(texture))
+                entry.streamer->cancel(texture);
+            glDeleteTextures(1, &texture);
+            GLState::forgetTexture(texture);
+        }
+        stats.resident--;
+        stats.residentBytes -= entry.bytes;
+        if (!entry.key.empty())
+            byKey.erase(entry.key);
+        entries.erase(found);
+    }
+
+    unsigned int refCount(GLuint texture) const
+    {
+        std::unordered_map<GLuint, Entry>::const_iterator found = entries.find(texture);
+        return found != entries.end() ? found->second.refs : 0;
+    }
+
+private:
+    struct Entry
+    {
+        GLuint texture = 0;
+        unsigned int refs = 1;
+        size_t bytes = 0;
+        TextureStreamer *streamer = nullptr;
+        std::string key;
+    };
+    std::unordered_map<std::string, GLuint> byKey;
+    std::unordered_map<GLuint, Entry> entries;
+
+    // "./a/../b.png" and "b.png" name the same file, parameters that change the texture follow the path
+    static std::string makeKey(const std::string &path, bool gamma, bool flip, GLenum wrap, TextureKind kind)
+    {
+        std::error_code error;
+        std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+        std::string key = error ? std::filesystem::path(path).lexically_normal().string() : canonical.string();
+        key += '|';
+        key += gamma ? 's' : 'l';
+        key += flip ? 'f' : 'n';
+        key += std::to_string(wrap);
+        key += '|';
+        key += std::to_string((int)kind);
+        return key;
+    }
+
+    void resize(GLuint texture, size_t bytes)
+    {
+        std::unordered_map<GLuint, Entry>::iterator found = entries.find(texture);
+        if (found == entries.end())
+            return;
+        stats.residentBytes += bytes;
+        stats.residentBytes -= found->second.bytes;
+        found->second.bytes = bytes;
+    }
+
+    // a streamed file that failed: later acquire() calls load it again, the placeholder stays with the references it has
+    void evict(GLuint texture)
+    {
+        std::unordered_map<GLuint, Entry>::iterator found = entries.find(texture);
+        if (found == entries.end() || found->second.key.empty())
+            return;
+        byKey.erase(found->second.key);
+        found->second.key.clear();
+    }
+
+    // the compressed copy of path when there is an up to date one the driver can sample, 0 otherwise
+    static GLuint loadCompressed(const std::string &path, bool gamma, GLenum wrap, size_t &bytes)
+    {
+        std::filesystem::path source(path);
+        std::filesystem::path compressed = source;
+        compressed.replace_extension(".dds");
+        std::error_code error;
+        if (source.extension() != ".dds")
+        {
+            std::filesystem::file_time_type compressedTime = std::filesystem::last_write_time(compressed, error);
+            if (error || compressedTime < std::filesystem::last_write_time(source, error))
+                return 0;
+        }
+        DdsFile file;
+        if (!file.open(compressed.string()))
+            return 0;
+        bytes = file.dataSize();
+        return file.upload(gamma, wrap);
+    }
+
+    // decoded on a worker so the flip flag can be set for that thread only, the samples own the global one
+    static GLuint load(const std::string &path, bool gamma, bool flip, GLenum wrap, TextureKind kind, size_t &bytes)
+    {
+        std::future<LoadedImage> loading = ThreadPool::shared().submit([path, flip, kind]() {
+            return ImageLoader::load(path, flip, kind, &ThreadPool::shared());
+        });
+        LoadedImage image = loading.get();
+        bytes = image.dataSize();
+        if (!image.valid())
+        {
+            std::cout << "Texture failed to load at path: " << path << std::endl;
+            return 0;
+        }
+        return ImageLoader::upload(image, gamma, wrap);
+    }
+};
+
+#endif
@@ -0,0 +1,311 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+
+#include <tool/gl_state.h>
+#include <tool/thread_pool.h>
+#include <tool/image_loader.h>
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <unordered_set>
+#include <functional>
+#include <iostream>
+#include <cstring>
+
+// Loads textures without stalling the frame loop.
+//   request()  returns a texture name right away, holding a 1x1 placeholder; the file is decoded and its mip chain
+//              built on the thread pool by ImageLoader (or read from its mip cache)
+//   update()   call once per frame on the GL thread: uploads the images decoded since the last call, up to a byte budget,
+//              through a ring of pixel unpack buffers, every level at once. The texture name stays the same,
+//              so whatever already holds it (Mesh::textures, a material) shows the real image from then on.
+//   isLoaded() / pending() / stats tell when the data has arrived, finish() waits for everything.
+//   cancel()   before deleting a texture that is still waiting, its image is dropped instead of uploaded
+// Decode tasks set the stb flip flag of their worker thread explicitly, the global flag of the GL thread is not used.
+// The ring buffers are persistently mapped when glBufferStorage is available (GL 4.4), otherwise every upload
+// orphans its buffer with glMapBufferRange. Images larger than a ring slot (all levels) are uploaded from client memory.
+// Like model.h, include tool/stb_image.h (with STB_IMAGE_IMPLEMENTATION in main.cpp) before this file.
+class TextureStreamer
+{
+public:
+    static const int SLOT_COUNT = 4;
+
+    struct Stats
+    {
+        unsigned int requested = 0;
+        unsigned int loaded = 0;
+        unsigned int failed = 0;
+        unsigned long long uploadedBytes = 0;
+    };
+    Stats stats;
+    // called on the GL thread after a texture got its image, with the bytes uploaded for all levels
+    std::function<void(GLuint texture, size_t bytes)> onLoaded;
+    // called on the GL thread when the image of a texture could not be loaded, the texture keeps the placeholder
+    std::function<void(GLuint texture)> onFailed;
+
+    explicit TextureStreamer(size_t slotBytes = 16 * 1024 * 1024, ThreadPool &pool = ThreadPool::shared())
+        : slotBytes(slotBytes), pool(pool), shared(std::make_shared<Shared>())
+    {
+        persistent = glBufferStorage != NULL;
+        glGenBuffers(SLOT_COUNT, buffers);
+        for (int i = 0; i < SLOT_COUNT; i++)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[i]);
+            if (persistent)
+            {
+                GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                glBufferStorage(GL_PIXEL_UNPACK_BUFFER, slotBytes, NULL, flags);
+                mapped[i] = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, slotBytes, flags);
+            }
+            else
+                glBufferData(GL_PIXEL_UNPACK_BUFFER, slotBytes, NULL, GL_STREAM_DRAW);
+            fences[i] = 0;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        const unsigned char placeholderPixel[4] = {128, 128, 128, 255};
+        memcpy(placeholder, placeholderPixel, sizeof(placeholder));
+    }
+    TextureStreamer(const TextureStreamer &) = delete;
+    TextureStreamer &operator=(const TextureStreamer &) = delete;
+    ~TextureStreamer()
+    {
+        // decodes still running hold the shared state and free their pixels into it, nothing to wait for here
+        {
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            shared->ready.clear();
+            shared->closed = true;
+        }
+        if (!GLState::contextCurrent())
+            return;
+        for (int i = 0; i < SLOT_COUNT; i++)
+            if (fences[i] != 0)
+                glDeleteSync(fences[i]);
+        if (persistent)
+            for (int i = 0; i < SLOT_COUNT; i++)
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[i]);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(SLOT_COUNT, buffers);
+    }
+
+    // gamma: the file holds sRGB colors (albedo), stored as GL_SRGB so sampling returns linear values
+    // flip:  first row of the file at the bottom, like stbi_set_flip_vertically_on_load(true)
+    // kind:  how the mip levels are filtered
+    // ------------------------------------------------------------------------
+    GLuint request(const std::string &path, bool gamma = false, bool flip = false, GLenum wrap = GL_REPEAT, TextureKind kind = TEXTURE_DATA)
+    {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        GLState::bindTexture(0, GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+        // the placeholder has no mip levels, without this the texture is incomplete and samples black
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        waiting.insert(texture);
+        stats.requested++;
+
+        std::shared_ptr<Shared> state = shared;
+        ThreadPool *workers = &pool;
+        pool.submit([state, path, texture, gamma, flip, wrap, kind, workers]() {
+            Decoded decoded;
+            decoded.texture = texture;
+            decoded.gamma = gamma;
+            decoded.wrap = wrap;
+            decoded.path = path;
+            decoded.image = ImageLoader::load(path, flip, kind, workers);
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (!state->closed)
+                state->ready.push_back(std::move(decoded));
+        });
+        return texture;
+    }
+
+    // upload what has been decoded, stops after budgetBytes (one image always goes through)
+    // ------------------------------------------------------------------------
+    void update(size_t budgetBytes = 32 * 1024 * 1024)
+    {
+        std::deque<Decoded> batch;
+        {
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            batch.swap(shared->ready);
+        }
+        size_t uploaded = 0;
+        while (!batch.empty())
+        {
+            Decoded &decoded = batch.front();
+            size_t size = decoded.image.dataSize();
+            if (size > 0 && uploaded > 0 && uploaded + size > budgetBytes)
+                break;
+            if (!upload(decoded))
+                break;
+            uploaded += size;
+            batch.pop_front();
+        }
+        if (!batch.empty())
+        {
+            // over budget or the ring is full: keep the rest for the next frame, in order
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            shared->ready.insert(shared->ready.begin(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+        }
+    }
+
+    // block until every requested texture is uploaded, for loading screens and tools
+    void finish()
+    {
+        while (!waiting.empty())
+        {
+            update((size_t)-1);
+            if (!waiting.empty())
+                std::this_thread::yield();
+        }
+    }
+
+    bool isLoaded(GLuint texture) const
+    {
+        return waiting.find(texture) == waiting.end();
+    }
+    size_t pending() const
+    {
+        return waiting.size();
+    }
+    void cancel(GLuint texture)
+    {
+        if (waiting.erase(texture) > 0)
+            stats.requested--;
+    }
+
+private:
+    struct Decoded
+    {
+        GLuint texture = 0;
+        bool gamma = false;
+        GLenum wrap = GL_REPEAT;
+        std::string path;
+        LoadedImage image;
+    };
+    // shared with the decode tasks, which may outlive the streamer
+    struct Shared
+    {
+        std::mutex mutex;
+        std::deque<Decoded> ready;
+        bool closed = false;
+    };
+
+    // the same for a TextureCache loading through the streamer, kept apart so the hooks above stay the caller's
+    friend class TextureCache;
+    std::function<void(GLuint texture, size_t bytes)> cacheLoaded;
+    std::function<void(GLuint texture)> cacheFailed;
+
+    size_t slotBytes;
+    ThreadPool &pool;
+    std::shared_ptr<Shared> shared;
+    // requested and not uploaded yet, only touched on the GL thread
+    std::unordered_set<GLuint> waiting;
+
+    bool persistent = false;
+    GLuint buffers[SLOT_COUNT];
+    unsigned char *mapped[SLOT_COUNT] = {};
+    GLsync fences[SLOT_COUNT];
+    int nextSlot = 0;
+    unsigned char placeholder[4];
+
+    // false when the ring has no free slot yet, the image stays queued
+    bool upload(Decoded &decoded)
+    {
+        if (waiting.find(decoded.texture) == waiting.end())
+            return true; // cancelled, the texture name may already belong to something else
+        if (!decoded.image.valid())
+        {
+            std::cout << "Texture failed to load at path: " << decoded.path << std::endl;
+            waiting.erase(decoded.texture);
+            stats.failed++;
+            if (cacheFailed)
+                cacheFailed(decoded.texture);
+            if (onFailed)
+                onFailed(decoded.texture);
+            return true;
+        }
+        size_t size = decoded.image.dataSize();
+        int slot = -1;
+        if (size <= slotBytes)
+        {
+            slot = acquireSlot();
+            if (slot < 0)
+                return false;
+        }
+
+        GLenum internalFormat = decoded.gamma ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+        const std::vector<DdsFile::Level> &levels = decoded.image.levels;
+        GLState::bindTexture(0, GL_TEXTURE_2D, decoded.texture);
+        if (slot >= 0)
+        {
+            // all levels back to back in the slot, each glTexImage2D reads its level at an offset
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[slot]);
+            unsigned char *target = mapped[slot];
+            if (!persistent)
+                target = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            size_t offset = 0;
+            for (const DdsFile::Level &level : levels)
+            {
+                memcpy(target + offset, level.data, level.size);
+                offset += level.size;
+            }
+            if (!persistent)
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            offset = 0;
+            for (size_t i = 0; i < levels.size(); i++)
+            {
+                glTexImage2D(GL_TEXTURE_2D, (GLint)i, internalFormat, levels[i].width, levels[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, (void *)offset);
+                offset += levels[i].size;
+            }
+            if (persistent)
+                fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        else
+            for (size_t i = 0; i < levels.size(); i++)
+                glTexImage2D(GL_TEXTURE_2D, (GLint)i, internalFormat, levels[i].width, levels[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, levels[i].data);
+        ImageLoader::setParameters(decoded.image, decoded.wrap);
+
+        decoded.image = LoadedImage();
+        waiting.erase(decoded.texture);
+        stats.loaded++;
+        stats.uploadedBytes += size;
+        if (cacheLoaded)
+            cacheLoaded(decoded.texture, size);
+        if (onLoaded)
+            onLoaded(decoded.texture, size);
+        return true;
+    }
+
+    // a slot whose previous upload the GPU has finished reading
+    int acquireSlot()
+    {
+        for (int i = 0; i < SLOT_COUNT; i++)
+        {
+            int slot = (nextSlot + i) % SLOT_COUNT;
+            if (fences[slot] != 0)
+            {
+                GLenum status = glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+                if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                    continue;
+                glDeleteSync(fences[slot]);
+                fences[slot] = 0;
+            }
+            nextSlot = (slot + 1) % SLOT_COUNT;
+            return slot;
+        }
+        return -1;
+    }
+};
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <type_traits>
+#include <algorithm>
+
+// Fixed set of worker threads for CPU work that must stay off the GL thread: mesh conversion, image decoding,
+// mip generation. The workers never touch GL; results are handed back to the thread that owns the context.
+//   submit(task)            run a task, returns a future for its result
+//   parallelFor(n, body)    run body(0..n-1) spread over the workers, the calling thread helps and waits
+// ThreadPool::shared() is created on first use with one worker per hardware thread minus the caller.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int threadCount)
+    {
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back([this]() { work(); });
+    }
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    static ThreadPool &shared()
+    {
+        static ThreadPool pool(defaultThreadCount());
+        return pool;
+    }
+    static unsigned int defaultThreadCount()
+    {
+        unsigned int cores = std::thread::hardware_concurrency();
+        return cores > 1 ? cores - 1 : 1;
+    }
+
+    unsigned int size() const
+    {
+        return (unsigned int)workers.size();
+    }
+
+    template <typename Function>
+    std::future<typename std::invoke_result<Function>::type> submit(Function &&function)
+    {
+        typedef typename std::invoke_result<Function>::type Result;
+        std::shared_ptr<std::packaged_task<Result()>> task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+        std::future<Result> result = task->get_future();
+        push([task]() { (*task)(); });
+        return result;
+    }
+
+    // blocks until every index is done. indices are handed out one at a time, so uneven work
+    // (a model with one huge and many small meshes) still balances.
+    void parallelFor(size_t count, const std::function<void(size_t)> &body)
+    {
+        if (count == 0)
+            return;
+        if (count == 1 || workers.empty())
+        {
+            for (size_t i = 0; i < count; i++)
+                body(i);
+            return;
+        }
+        struct Range
+        {
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> done{0};
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+        std::shared_ptr<Range> range = std::make_shared<Range>();
+        std::function<void()> run = [range, count, &body]() {
+            size_t completed = 0;
+            for (size_t i = range->next++; i < count; i = range->next++)
+            {
+                body(i);
+                completed++;
+            }
+            if (completed > 0 && range->done.fetch_add(completed) + completed == count)
+            {
+                std::lock_guard<std::mutex> lock(range->mutex);
+                range->finished.notify_all();
+            }
+        };
+        size_t helpers = std::min(count - 1, workers.size());
+        for (size_t i = 0; i < helpers; i++)
+            push(run);
+        run();
+        std::unique_lock<std::mutex> lock(range->mutex);
+        range->finished.wait(lock, [&]() { return range->done.load() == count; });
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void push(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+
+    void work()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+#endif
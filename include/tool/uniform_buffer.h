@@ -0,0 +1,174 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+#include <tool/shader.h>
+#include <tool/gl_state.h>
+
+// C++ mirrors of the shared uniform blocks in static/shader/*_block.glsl.
+// every struct follows the std140 rules (vec3 aligned to 16 bytes, arrays and structs to 16 bytes),
+// the padding is explicit and checked below, so the whole struct can be copied into the buffer as is.
+
+// camera_block.glsl
+struct CameraBlock
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 viewPos;
+    float pad0;
+};
+
+// light.glsl: DirectionLight
+struct DirectionLightStd140
+{
+    glm::vec3 direction;
+    float pad0;
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    float pad3;
+};
+
+// light.glsl: PointLight
+struct PointLightStd140
+{
+    glm::vec3 position;
+    float constant;
+    float linear;
+    float quadratic;
+    float pad0[2];
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    float pad3;
+};
+
+// light.glsl: SpotLight
+struct SpotLightStd140
+{
+    glm::vec3 position;
+    float pad0;
+    glm::vec3 direction;
+    float cutOff;
+    float outerCutOff;
+    float constant;
+    float linear;
+    float quadratic;
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    float pad3;
+};
+
+// light_block.glsl, MAX_POINT_LIGHTS has to match the array size there
+const unsigned int MAX_POINT_LIGHTS = 32;
+struct LightBlock
+{
+    DirectionLightStd140 dirLight;
+    SpotLightStd140 spotLight;
+    PointLightStd140 pointLights[MAX_POINT_LIGHTS];
+    int pointLightCount;
+    int pad0[3];
+};
+
+static_assert(sizeof(glm::vec3) == 12 && sizeof(glm::mat4) == 64, "glm types must not be padded");
+static_assert(offsetof(CameraBlock, viewPos) == 128 && sizeof(CameraBlock) == 144, "CameraBlock does not match std140");
+static_assert(offsetof(DirectionLightStd140, specular) == 48 && sizeof(DirectionLightStd140) == 64, "DirectionLight does not match std140");
+static_assert(offsetof(PointLightStd140, quadratic) == 20 && offsetof(PointLightStd140, ambient) == 32 && offsetof(PointLightStd140, specular) == 64 && sizeof(PointLightStd140) == 80, "PointLight does not match std140");
+static_assert(offsetof(SpotLightStd140, cutOff) == 28 && offsetof(SpotLightStd140, ambient) == 48 && sizeof(SpotLightStd140) == 96, "SpotLight does not match std140");
+static_assert(offsetof(LightBlock, spotLight) == 64 && offsetof(LightBlock, pointLights) == 160 && offsetof(LightBlock, pointLightCount) == 160 + 80 * MAX_POINT_LIGHTS, "LightBlock does not match std140");
+
+// statistics shared by all uniform buffers
+struct UniformBufferStats
+{
+    // number of buffer updates issued since the counter was last reset
+    static inline unsigned long uploads = 0;
+};
+
+// one uniform buffer holding a block struct, attached to a fixed binding point.
+// the shaders find it through Shader::blockBindings, so no per program setup is needed.
+// owns the buffer: move-only, deleted with the object (or earlier by dispose()).
+template <typename T>
+class UniformBuffer
+{
+public:
+    T data;
+    unsigned int ID;
+    GLuint binding;
+
+    explicit UniformBuffer(GLuint binding) : data(), ID(0), binding(binding)
+    {
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        bind();
+    }
+    UniformBuffer(const UniformBuffer &) = delete;
+    UniformBuffer &operator=(const UniformBuffer &) = delete;
+    UniformBuffer(UniformBuffer &&other) noexcept : data(other.data), ID(other.ID), binding(other.binding)
+    {
+        other.ID = 0;
+    }
+    UniformBuffer &operator=(UniformBuffer &&other) noexcept
+    {
+        if (this != &other)
+        {
+            dispose();
+            data = other.data;
+            ID = other.ID;
+            binding = other.binding;
+            other.ID = 0;
+        }
+        return *this;
+    }
+    ~UniformBuffer()
+    {
+        if (GLState::contextCurrent())
+            dispose();
+    }
+
+    // attach to the binding point, once per frame is enough
+    // ------------------------------------------------------------------------
+    void bind() const
+    {
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, ID);
+    }
+    // copy data to the buffer
+    // ------------------------------------------------------------------------
+    void upload() const
+    {
+        upload(0, sizeof(T));
+    }
+    // copy part of data, e.g. only the lights in use
+    // ------------------------------------------------------------------------
+    void upload(size_t offset, size_t size) const
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferSubData(GL_UNIFORM_BUFFER, (GLintptr)offset, (GLsizeiptr)size, (const char *)&data + offset);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        UniformBufferStats::uploads++;
+    }
+
+    // delete the buffer now, can be called more than once
+    void dispose()
+    {
+        if (ID == 0)
+            return;
+        glDeleteBuffers(1, &ID);
+        ID = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,236 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <tool/shader.h>
+#include <geometry/GeometryView.h>
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+// How the attributes of a mesh are stored in its vertex buffer. The attribute locations stay the same
+// as with the plain Vertex struct (0 position, 1 normal, 2 uv, 3 tangent, 4 bitangent), only the types change:
+//   POSITION_UNORM16    xyz as unsigned shorts relative to the mesh bounds, the shader rescales them
+//                       with the positionOffset/positionScale uniforms set by Mesh
+//   NORMAL_OCTAHEDRAL   normal as 2 snorm16 on the octahedron, tangent as 2 snorm8 plus the bitangent sign,
+//                       the bitangent is rebuilt as cross(normal, tangent) * sign
+//   TEXCOORD_HALF       uv as half floats, TEXCOORD_UNORM16 for uvs known to be inside [0, 1]
+// Shaders read the attributes through static/shader/vertex_format.glsl compiled with defines().
+struct VertexFormat
+{
+    enum PositionEncoding
+    {
+        POSITION_FLOAT,
+        POSITION_UNORM16
+    };
+    enum NormalEncoding
+    {
+        NORMAL_FLOAT,
+        NORMAL_OCTAHEDRAL
+    };
+    enum TexCoordEncoding
+    {
+        TEXCOORD_FLOAT,
+        TEXCOORD_HALF,
+        TEXCOORD_UNORM16
+    };
+
+    PositionEncoding position = POSITION_FLOAT;
+    NormalEncoding normal = NORMAL_FLOAT;
+    TexCoordEncoding texCoord = TEXCOORD_FLOAT;
+
+    // 56 bytes, the Vertex struct as it is
+    static VertexFormat full()
+    {
+        return VertexFormat();
+    }
+    // 24 bytes: float position, octahedral normal/tangent, half float uv
+    static VertexFormat compact()
+    {
+        VertexFormat format;
+        format.normal = NORMAL_OCTAHEDRAL;
+        format.texCoord = TEXCOORD_HALF;
+        return format;
+    }
+    // 20 bytes: compact() with 16 bit positions
+    static VertexFormat quantized()
+    {
+        VertexFormat format = compact();
+        format.position = POSITION_UNORM16;
+        return format;
+    }
+
+    bool isFull() const
+    {
+        return position == POSITION_FLOAT && normal == NORMAL_FLOAT && texCoord == TEXCOORD_FLOAT;
+    }
+
+    bool operator==(const VertexFormat &other) const
+    {
+        return position == other.position && normal == other.normal && texCoord == other.texCoord;
+    }
+
+    GLsizei stride() const
+    {
+        return positionBytes() + normalBytes() + texCoordBytes();
+    }
+
+    // defines the shader has to be compiled with to read this format
+    ShaderDefines defines() const
+    {
+        ShaderDefines defines;
+        if (position == POSITION_UNORM16)
+            defines.push_back(std::make_pair("VERTEX_QUANTIZED_POSITION", "1"));
+        if (normal == NORMAL_OCTAHEDRAL)
+            defines.push_back(std::make_pair("VERTEX_OCTAHEDRAL", "1"));
+        return defines;
+    }
+
+    // pack the vertices into the layout of this format, bounds are the mesh bounds used for POSITION_UNORM16
+    // ------------------------------------------------------------------------
+    template <typename VertexType>
+    std::vector<unsigned char> encode(const std::vector<VertexType> &vertices, const Bounds &bounds) const
+    {
+        return encode(vertices.data(), vertices.size(), bounds);
+    }
+    template <typename VertexType>
+    std::vector<unsigned char> encode(const VertexType *vertices, size_t count, const Bounds &bounds) const
+    {
+        GLsizei size = stride();
+        std::vector<unsigned char> data(count * size);
+        glm::vec3 scale = dequantizeScale(bounds);
+        for (size_t i = 0; i < count; i++)
+        {
+            const VertexType &vertex = vertices[i];
+            unsigned char *out = &data[i * size];
+
+            if (position == POSITION_UNORM16)
+            {
+                uint64_t packed = glm::packUnorm4x16(glm::vec4((vertex.Position - bounds.min) / scale, 0.0f));
+                write(out, packed);
+            }
+            else
+                write(out, vertex.Position);
+
+            if (normal == NORMAL_OCTAHEDRAL)
+            {
+                write(out, glm::packSnorm2x16(octEncode(vertex.Normal)));
+                float sign = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
+                write(out, glm::packSnorm4x8(glm::vec4(octEncode(vertex.Tangent), sign, 0.0f)));
+            }
+            else
+            {
+                write(out, vertex.Normal);
+                write(out, vertex.Tangent);
+                write(out, vertex.Bitangent);
+            }
+
+            if (texCoord == TEXCOORD_HALF)
+                write(out, glm::packHalf2x16(vertex.TexCoords));
+            else if (texCoord == TEXCOORD_UNORM16)
+                write(out, glm::packUnorm2x16(vertex.TexCoords));
+            else
+                write(out, vertex.TexCoords);
+        }
+        return data;
+    }
+
+    // attribute pointers for a vertex buffer filled by encode(), the buffer has to be bound to GL_ARRAY_BUFFER
+    // ------------------------------------------------------------------------
+    void setupAttributes() const
+    {
+        GLsizei size = stride();
+        size_t offset = 0;
+
+        glEnableVertexAttribArray(0);
+        if (position == POSITION_UNORM16)
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, size, (void *)offset);
+        else
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, size, (void *)offset);
+        offset += positionBytes();
+
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(3);
+        if (normal == NORMAL_OCTAHEDRAL)
+        {
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, size, (void *)offset);
+            glVertexAttribPointer(3, 3, GL_BYTE, GL_TRUE, size, (void *)(offset + 4));
+            glDisableVertexAttribArray(4);
+        }
+        else
+        {
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, size, (void *)offset);
+            glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, size, (void *)(offset + 12));
+            glEnableVertexAttribArray(4);
+            glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, size, (void *)(offset + 24));
+        }
+        offset += normalBytes();
+
+        glEnableVertexAttribArray(2);
+        if (texCoord == TEXCOORD_HALF)
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, size, (void *)offset);
+        else if (texCoord == TEXCOORD_UNORM16)
+            glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, size, (void *)offset);
+        else
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, size, (void *)offset);
+    }
+
+    // position = positionOffset + quantized * positionScale
+    static glm::vec3 dequantizeScale(const Bounds &bounds)
+    {
+        glm::vec3 scale = bounds.max - bounds.min;
+        return glm::max(scale, glm::vec3(1e-6f));
+    }
+
+    // unit vector to the [-1, 1] square, the lower half of the octahedron is folded over the diagonals
+    static glm::vec2 octEncode(glm::vec3 n)
+    {
+        float length = glm::abs(n.x) + glm::abs(n.y) + glm::abs(n.z);
+        if (length == 0.0f)
+            return glm::vec2(0.0f);
+        n /= length;
+        glm::vec2 p(n.x, n.y);
+        if (n.z < 0.0f)
+        {
+            p.x = (1.0f - glm::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+            p.y = (1.0f - glm::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+        }
+        return p;
+    }
+    static glm::vec3 octDecode(glm::vec2 p)
+    {
+        glm::vec3 n(p.x, p.y, 1.0f - glm::abs(p.x) - glm::abs(p.y));
+        float t = glm::max(-n.z, 0.0f);
+        n.x += n.x >= 0.0f ? -t : t;
+        n.y += n.y >= 0.0f ? -t : t;
+        return glm::normalize(n);
+    }
+
+private:
+    GLsizei positionBytes() const
+    {
+        return position == POSITION_UNORM16 ? 8 : 12;
+    }
+    GLsizei normalBytes() const
+    {
+        return normal == NORMAL_OCTAHEDRAL ? 8 : 36;
+    }
+    GLsizei texCoordBytes() const
+    {
+        return texCoord == TEXCOORD_FLOAT ? 8 : 4;
+    }
+
+    template <typename T>
+    static void write(unsigned char *&out, const T &value)
+    {
+        memcpy(out, &value, sizeof(T));
+        out += sizeof(T);
+    }
+};
+
+#endif
@@ -98,6 +98,7 @@ int main(int argc, char *argv[])
   glDeleteVertexArrays(1, &VAO);
   glDeleteBuffers(1, &VBO);
 
+  GLState::contextDestroyed();
   glfwTerminate();
   return 0;
 }
@@ -224,6 +224,7 @@ int main(int argc, char *argv[])
   glDeleteBuffers(1, &VBO);
   glDeleteBuffers(1, &EBO);
 
+  GLState::contextDestroyed();
   glfwTerminate();
   return 0;
 }
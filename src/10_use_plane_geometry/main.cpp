@@ -128,15 +128,16 @@ int main(int argc, char *argv[])
 
     glBindVertexArray(planeGeometry.VAO);
 
-    // glDrawElements(GL_TRIANGLES, planeGeometry.indices.size(), GL_UNSIGNED_INT, 0);
-    glDrawElements(GL_POINTS, planeGeometry.indices.size(), GL_UNSIGNED_INT, 0);
-    glDrawElements(GL_LINE_LOOP, planeGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    // glDrawElements(GL_TRIANGLES, planeGeometry.indexCount, planeGeometry.indexType, 0);
+    glDrawElements(GL_POINTS, planeGeometry.indexCount, planeGeometry.indexType, 0);
+    glDrawElements(GL_LINE_LOOP, planeGeometry.indexCount, planeGeometry.indexType, 0);
 
     glfwSwapBuffers(window);
     glfwPollEvents();
   }
 
   planeGeometry.dispose();
+  GLState::contextDestroyed();
   glfwTerminate();
   return 0;
 }
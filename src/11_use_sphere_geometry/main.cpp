@@ -129,15 +129,16 @@ int main(int argc, char *argv[])
 
     glBindVertexArray(sphereGeometry.VAO);
 
-    // glDrawElements(GL_TRIANGLES, sphereGeometry.indices.size(), GL_UNSIGNED_INT, 0);
-    glDrawElements(GL_POINTS, sphereGeometry.indices.size(), GL_UNSIGNED_INT, 0);
-    // glDrawElements(GL_LINE_LOOP, sphereGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    // glDrawElements(GL_TRIANGLES, sphereGeometry.indexCount, sphereGeometry.indexType, 0);
+    glDrawElements(GL_POINTS, sphereGeometry.indexCount, sphereGeometry.indexType, 0);
+    // glDrawElements(GL_LINE_LOOP, sphereGeometry.indexCount, sphereGeometry.indexType, 0);
 
     glfwSwapBuffers(window);
     glfwPollEvents();
   }
 
   sphereGeometry.dispose();
+  GLState::contextDestroyed();
   glfwTerminate();
   return 0;
 }
@@ -132,15 +132,16 @@ int main(int argc, char *argv[])
 
     glBindVertexArray(boxGeometry.VAO);
 
-    glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
-    // glDrawElements(GL_POINTS, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
-    // glDrawElements(GL_LINE_LOOP, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
+    // glDrawElements(GL_POINTS, boxGeometry.indexCount, boxGeometry.indexType, 0);
+    // glDrawElements(GL_LINE_LOOP, boxGeometry.indexCount, boxGeometry.indexType, 0);
 
     glfwSwapBuffers(window);
     glfwPollEvents();
   }
 
   boxGeometry.dispose();
+  GLState::contextDestroyed();
   glfwTerminate();
   return 0;
 }
@@ -164,7 +164,7 @@ int main(int argc, char *argv[])
       float angle = 20.f * i;
       model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
       ourShader.setMat4("model", model);
-      glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+      glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
     }
 
     glm::mat4 model = glm::mat4(1.0f);
@@ -173,7 +173,7 @@ int main(int argc, char *argv[])
     ourShader.setMat4("model", model);
 
     glBindVertexArray(planeGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, planeGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, planeGeometry.indexCount, planeGeometry.indexType, 0);
 
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(1.0, 0.0, 0.0));
@@ -181,7 +181,7 @@ int main(int argc, char *argv[])
     ourShader.setMat4("model", model);
 
     glBindVertexArray(sphereGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, sphereGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, sphereGeometry.indexCount, sphereGeometry.indexType, 0);
 
     glfwSwapBuffers(window);
     glfwPollEvents();
@@ -190,6 +190,7 @@ int main(int argc, char *argv[])
   boxGeometry.dispose();
   planeGeometry.dispose();
   sphereGeometry.dispose();
+  GLState::contextDestroyed();
   glfwTerminate();
   return 0;
 }
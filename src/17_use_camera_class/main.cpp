@@ -217,7 +217,7 @@ int main(int argc, char *argv[])
 
     ourShader.setMat4("model", model);
     glBindVertexArray(boxGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
 
     // 渲染 gui
     ImGui::Render();
@@ -230,6 +230,7 @@ int main(int argc, char *argv[])
   boxGeometry.dispose();
   planeGeometry.dispose();
   sphereGeometry.dispose();
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
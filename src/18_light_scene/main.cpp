@@ -224,7 +224,7 @@ int main(int argc, char *argv[])
 
     ourShader.setMat4("model", model);
     glBindVertexArray(boxGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
 
     // 绘制灯光物体
     lightObjectShader.use();
@@ -234,7 +234,7 @@ int main(int argc, char *argv[])
     lightObjectShader.setMat4("view", view);
     lightObjectShader.setMat4("projection", projection);
     glBindVertexArray(sphereGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, sphereGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, sphereGeometry.indexCount, sphereGeometry.indexType, 0);
 
     // 渲染 gui
     ImGui::Render();
@@ -247,6 +247,7 @@ int main(int argc, char *argv[])
   boxGeometry.dispose();
   planeGeometry.dispose();
   sphereGeometry.dispose();
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
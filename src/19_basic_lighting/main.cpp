@@ -234,7 +234,7 @@ int main(int argc, char *argv[])
     ourShader.setVec3("lightPos", lightPos);
     ourShader.setVec3("viewPos", camera.Position);
     glBindVertexArray(sphereGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, sphereGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, sphereGeometry.indexCount, sphereGeometry.indexType, 0);
 
     // 绘制灯光物体
     lightObjectShader.use();
@@ -246,7 +246,7 @@ int main(int argc, char *argv[])
     lightObjectShader.setMat4("view", view);
     lightObjectShader.setMat4("projection", projection);
     glBindVertexArray(boxGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
 
     // 渲染 gui
     ImGui::Render();
@@ -259,6 +259,7 @@ int main(int argc, char *argv[])
   planeGeometry.dispose();
   boxGeometry.dispose();
   sphereGeometry.dispose();
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
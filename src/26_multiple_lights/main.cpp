@@ -277,7 +277,7 @@ int main(int argc, char *argv[])
       ourShader.setMat4("model", model);
 
       glBindVertexArray(boxGeometry.VAO);
-      glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+      glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
     }
 
     // 绘制灯光物体
@@ -292,7 +292,7 @@ int main(int argc, char *argv[])
     lightObjectShader.setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
 
     glBindVertexArray(sphereGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, sphereGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, sphereGeometry.indexCount, sphereGeometry.indexType, 0);
 
     for (unsigned int i = 0; i < 4; i++)
     {
@@ -303,7 +303,7 @@ int main(int argc, char *argv[])
       lightObjectShader.setVec3("lightColor", pointLightColors[i]);
 
       glBindVertexArray(sphereGeometry.VAO);
-      glDrawElements(GL_TRIANGLES, sphereGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+      glDrawElements(GL_TRIANGLES, sphereGeometry.indexCount, sphereGeometry.indexType, 0);
     }
 
     // 渲染 gui
@@ -317,6 +317,7 @@ int main(int argc, char *argv[])
   boxGeometry.dispose();
   planeGeometry.dispose();
   sphereGeometry.dispose();
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
@@ -17,6 +17,7 @@
 
 #include <tool/mesh.h>
 #include <tool/model.h>
+#include <tool/render_queue.h>
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
@@ -103,7 +104,9 @@ int main(int argc, char *argv[])
   // 2.鼠标事件
   glfwSetCursorPosCallback(window, mouse_callback);
 
-  Shader ourShader("./shader/vertex.glsl", "./shader/fragment.glsl");
+  // 模型使用压缩顶点格式（16 位位置、八面体法线、半精度纹理坐标），着色器按格式编译
+  VertexFormat modelFormat = VertexFormat::quantized();
+  Shader ourShader("./shader/vertex.glsl", "./shader/fragment.glsl", nullptr, modelFormat.defines());
   Shader lightObjectShader("./shader/light_object_vert.glsl", "./shader/light_object_frag.glsl");
 
   PlaneGeometry planeGeometry(1.0, 1.0, 1.0, 1.0);
@@ -186,12 +189,26 @@ int main(int argc, char *argv[])
       glm::vec3(0.0f, 0.0f, 1.0f),
       glm::vec3(0.0f, 1.0f, 0.0f)};
 
+  // 贴图在线程池中解码，每帧上传一部分，加载期间先显示灰色占位贴图
+  TextureStreamer textureStreamer;
+  Model::textureStreamer = &textureStreamer;
+
+  // 模型的网格都从同一块顶点、索引缓冲中分配，共用一个 VAO，按基准顶点绘制，渲染队列不再切换 VAO
+  GeometryArena geometryArena(modelFormat);
+  Model::geometryArena = &geometryArena;
+
   // Model ourModel("./static/model/nanosuit/nanosuit.obj");
-  Model ourModel("./static/model/nanosuit/nanosuit.obj");
+  // 只保留位置和索引（可用于拾取），法线、纹理坐标上传后释放
+  Model ourModel("./static/model/nanosuit/nanosuit.obj", false, RETAIN_POSITIONS, modelFormat);
+  ourModel.printMemoryReport();
+
+  // 按着色器、贴图、VAO 排序后再绘制，减少状态切换
+  RenderQueue renderQueue;
 
   while (!glfwWindowShouldClose(window))
   {
     processInput(window);
+    textureStreamer.update();
 
     float currentFrame = glfwGetTime();
     deltaTime = currentFrame - lastTime;
@@ -214,6 +231,18 @@ int main(int argc, char *argv[])
     // ImGui::Begin("controls");
     // ImGui::Text("%.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
     // ImGui::End();
+    ImGui::Begin("render queue");
+    ImGui::Text("draws: %u", renderQueue.stats.draws);
+    ImGui::Text("program changes: %u", renderQueue.stats.programChanges);
+    ImGui::Text("material changes: %u", renderQueue.stats.materialChanges);
+    ImGui::Text("vao changes: %u", renderQueue.stats.vertexArrayChanges);
+    GeometryArena::Stats arenaStats = geometryArena.stats();
+    ImGui::Text("geometry arena: %u meshes, %.1f / %.1f MB", arenaStats.allocations, (arenaStats.vertexBytes + arenaStats.indexBytes) / (1024.0 * 1024.0),
+                (arenaStats.vertexCapacity + arenaStats.indexCapacity) / (1024.0 * 1024.0));
+    ImGui::Text("textures: %u / %u loaded", textureStreamer.stats.loaded, textureStreamer.stats.requested);
+    const TextureCache::Stats &textureCache = TextureCache::shared().stats;
+    ImGui::Text("texture cache: %u resident, %.1f MB, hit rate %.0f%%", textureCache.resident, textureCache.residentBytes / (1024.0 * 1024.0), textureCache.hitRate() * 100.0);
+    ImGui::End();
     //  *************************************************************************
 
     // 渲染指令
@@ -283,16 +312,16 @@ int main(int argc, char *argv[])
       ourShader.setMat4("model", model);
 
       // glBindVertexArray(boxGeometry.VAO);
-      // glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+      // glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
     }
 
     model = glm::mat4(1.0f);
     model = glm::rotate(model, glm::radians(15.0f * (float)glfwGetTime()), glm::vec3(0.0f, 1.0f, 0.0f));
     model = glm::translate(model, glm::vec3(0.0f, -1.0f, 0.0f));
     model = glm::scale(model, glm::vec3(0.13f, 0.13f, 0.13f));
-    ourShader.setMat4("model", model);
-
-    ourModel.Draw(ourShader);
+    renderQueue.setView(view);
+    ourModel.Submit(renderQueue, ourShader, model);
+    renderQueue.flush();
 
     // 绘制灯光物体
     lightObjectShader.use();
@@ -306,7 +335,7 @@ int main(int argc, char *argv[])
     lightObjectShader.setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
 
     glBindVertexArray(sphereGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, sphereGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, sphereGeometry.indexCount, sphereGeometry.indexType, 0);
 
     for (unsigned int i = 0; i < 4; i++)
     {
@@ -317,7 +346,7 @@ int main(int argc, char *argv[])
       lightObjectShader.setVec3("lightColor", pointLightColors[i]);
 
       glBindVertexArray(sphereGeometry.VAO);
-      glDrawElements(GL_TRIANGLES, sphereGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+      glDrawElements(GL_TRIANGLES, sphereGeometry.indexCount, sphereGeometry.indexType, 0);
     }
 
     // 渲染 gui
@@ -331,6 +360,7 @@ int main(int argc, char *argv[])
   boxGeometry.dispose();
   planeGeometry.dispose();
   sphereGeometry.dispose();
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
@@ -1,7 +1,5 @@
 #version 330 core
-layout(location = 0) in vec3 Position;
-layout(location = 1) in vec3 Normal;
-layout(location = 2) in vec2 TexCoords;
+#include "vertex_format.glsl"
 
 out vec2 outTexCoord;
 out vec3 outNormal;
@@ -14,12 +12,13 @@ uniform mat4 view;
 uniform mat4 projection;
 
 void main() {
+  vec3 position = vertexPosition();
 
-  gl_Position = projection * view * model * vec4(Position, 1.0f);
+  gl_Position = projection * view * model * vec4(position, 1.0f);
 
-  outFragPos = vec3(model * vec4(Position, 1.0));
+  outFragPos = vec3(model * vec4(position, 1.0));
 
   outTexCoord = TexCoords;
   // 解决不等比缩放，对法向量产生的影响
-  outNormal = mat3(transpose(inverse(model))) * Normal;
+  outNormal = mat3(transpose(inverse(model))) * vertexNormal();
 }
\ No newline at end of file
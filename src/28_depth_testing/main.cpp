@@ -242,7 +242,7 @@ int main(int argc, char *argv[])
     sceneShader.setMat4("model", model);
 
     glBindVertexArray(planeGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, planeGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, planeGeometry.indexCount, planeGeometry.indexType, 0);
 
     // 绘制砖块
     glBindTexture(GL_TEXTURE_2D, brickMap);
@@ -254,14 +254,14 @@ int main(int argc, char *argv[])
     sceneShader.setMat4("model", model);
 
     glBindVertexArray(boxGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
 
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(-1.0, 0.5, 2.0));
     sceneShader.setMat4("model", model);
 
     glBindVertexArray(boxGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
 
     // 绘制灯光物体
     // ************************************************************
@@ -276,7 +276,7 @@ int main(int argc, char *argv[])
     lightObjectShader.setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
 
     glBindVertexArray(sphereGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, sphereGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, sphereGeometry.indexCount, sphereGeometry.indexType, 0);
 
     for (unsigned int i = 0; i < 4; i++)
     {
@@ -287,7 +287,7 @@ int main(int argc, char *argv[])
       lightObjectShader.setVec3("lightColor", pointLightColors[i]);
 
       glBindVertexArray(sphereGeometry.VAO);
-      glDrawElements(GL_TRIANGLES, sphereGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+      glDrawElements(GL_TRIANGLES, sphereGeometry.indexCount, sphereGeometry.indexType, 0);
     }
     // ************************************************************
 
@@ -302,6 +302,7 @@ int main(int argc, char *argv[])
   boxGeometry.dispose();
   planeGeometry.dispose();
   sphereGeometry.dispose();
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
@@ -1,45 +1,11 @@
 #version 330 core
 out vec4 FragColor;
 
-// 定向光
-struct DirectionLight {
-  vec3 direction;
-
-  vec3 ambient;
-  vec3 diffuse;
-  vec3 specular;
-};
-
-// 点光源
-struct PointLight {
-  vec3 position;
-
-  float constant;
-  float linear;
-  float quadratic;
-
-  vec3 ambient;
-  vec3 diffuse;
-  vec3 specular;
-};
-
-// 聚光灯
-struct SpotLight {
-  vec3 position;
-  vec3 direction;
-  float cutOff;
-  float outerCutOff;
-
-  float constant;
-  float linear;
-  float quadratic;
-
-  vec3 ambient;
-  vec3 diffuse;
-  vec3 specular;
-};
+#include "light.glsl"
 
+#ifndef NR_POINT_LIGHTS
 #define NR_POINT_LIGHTS 4
+#endif
 
 uniform DirectionLight directionLight;
 uniform PointLight pointLights[NR_POINT_LIGHTS];
@@ -57,9 +23,6 @@ uniform float factor; // 变化值
 float near = 0.1;
 float far = 100.0;
 
-vec3 CalcDirectionLight(DirectionLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 float LinearizeDepth(float depth, float near, float far);
 
 void main() {
@@ -82,67 +45,6 @@ void main() {
   // FragColor = vec4(vec3(depth), 1.0);
 }
 
-// 计算定向光
-vec3 CalcDirectionLight(DirectionLight light, vec3 normal, vec3 viewDir) {
-  vec3 lightDir = normalize(light.direction);
-  float diff = max(dot(normal, lightDir), 0.0);
-  vec3 reflectDir = reflect(-lightDir, normal);
-  float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
-
-  // 合并
-  vec3 ambient = light.ambient;
-  vec3 diffuse = light.diffuse * diff;
-  vec3 specular = light.specular * spec;
-
-  return ambient + diffuse + specular;
-}
-
-// 计算点光源
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
-  vec3 lightDir = normalize(light.position - fragPos);
-    // 漫反射着色
-  float diff = max(dot(normal, lightDir), 0.0);
-    // 镜面光着色
-  vec3 reflectDir = reflect(-lightDir, normal);
-  float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
-    // 衰减
-  float distance = length(light.position - fragPos);
-  float attenuation = 1.0 / (light.constant + light.linear * distance +
-    light.quadratic * (distance * distance));    
-    // 合并结果
-  vec3 ambient = light.ambient;
-  vec3 diffuse = light.diffuse * diff;
-  vec3 specular = light.specular * spec;
-  ambient *= attenuation;
-  diffuse *= attenuation;
-  specular *= attenuation;
-  return (ambient + diffuse + specular);
-}
-
-// 计算聚光灯
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
-  vec3 lightDir = normalize(light.position - fragPos);
-  float diff = max(dot(normal, lightDir), 0.0);
-  vec3 reflectDir = reflect(-lightDir, normal);
-  float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
-
-  float distance = length(light.position - fragPos);
-  float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-
-  float theta = dot(lightDir, normalize(-light.direction));
-  float epsilon = light.cutOff - light.outerCutOff;
-  float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
-
-  vec3 ambient = light.ambient;
-  vec3 diffuse = light.diffuse * diff;
-  vec3 specular = light.specular * spec;
-
-  ambient *= attenuation * intensity;
-  diffuse *= attenuation * intensity;
-  specular *= attenuation * intensity;
-  return (ambient + diffuse + specular);
-}
-
 // 计算深度值
 float LinearizeDepth(float depth, float near, float far) {
   float z = depth * 2.0 - 1.0;
@@ -251,7 +251,7 @@ int main(int argc, char *argv[])
     glStencilMask(0x00);
 
     glBindVertexArray(planeGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, planeGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, planeGeometry.indexCount, planeGeometry.indexType, 0);
     glBindVertexArray(0);
 
     // 1.正常绘制对象写入模板缓冲区
@@ -268,14 +268,14 @@ int main(int argc, char *argv[])
     sceneShader.setMat4("model", model);
 
     glBindVertexArray(boxGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
 
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(-1.0, 0.5, 2.0));
     sceneShader.setMat4("model", model);
 
     glBindVertexArray(boxGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
 
     // 2.绘制盒子放大版本，然后禁用模板写入
     // -----------------------------------------------------------
@@ -293,7 +293,7 @@ int main(int argc, char *argv[])
     sceneShader.setMat4("model", model);
 
     glBindVertexArray(boxGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
 
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(-1.0, 0.5, 2.0));
@@ -301,7 +301,7 @@ int main(int argc, char *argv[])
     sceneShader.setMat4("model", model);
 
     glBindVertexArray(boxGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
 
     glBindVertexArray(0);
     glStencilMask(0xff);
@@ -324,7 +324,7 @@ int main(int argc, char *argv[])
     lightObjectShader.setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
 
     glBindVertexArray(sphereGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, sphereGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, sphereGeometry.indexCount, sphereGeometry.indexType, 0);
 
     for (unsigned int i = 0; i < 4; i++)
     {
@@ -335,7 +335,7 @@ int main(int argc, char *argv[])
       lightObjectShader.setVec3("lightColor", pointLightColors[i]);
 
       glBindVertexArray(sphereGeometry.VAO);
-      glDrawElements(GL_TRIANGLES, sphereGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+      glDrawElements(GL_TRIANGLES, sphereGeometry.indexCount, sphereGeometry.indexType, 0);
     }
     // ************************************************************
 
@@ -350,6 +350,7 @@ int main(int argc, char *argv[])
   boxGeometry.dispose();
   planeGeometry.dispose();
   sphereGeometry.dispose();
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
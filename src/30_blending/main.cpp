@@ -247,7 +247,7 @@ int main(int argc, char *argv[])
     sceneShader.setMat4("model", model);
 
     glBindVertexArray(groundGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, groundGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, groundGeometry.indexCount, groundGeometry.indexType, 0);
     glBindVertexArray(0);
     // ********************************************************
 
@@ -262,14 +262,14 @@ int main(int argc, char *argv[])
     sceneShader.setMat4("model", model);
 
     glBindVertexArray(boxGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
 
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(-1.0, 0.5, 2.0));
     sceneShader.setMat4("model", model);
 
     glBindVertexArray(boxGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
     // ----------------------------------------------------------
 
     // 绘制草丛面板
@@ -290,7 +290,7 @@ int main(int argc, char *argv[])
       model = glm::mat4(1.0f);
       model = glm::translate(model, iterator->second);
       sceneShader.setMat4("model", model);
-      glDrawElements(GL_TRIANGLES, grassGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+      glDrawElements(GL_TRIANGLES, grassGeometry.indexCount, grassGeometry.indexType, 0);
     }
     // ----------------------------------------------------------
 
@@ -307,7 +307,7 @@ int main(int argc, char *argv[])
     lightObjectShader.setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
 
     glBindVertexArray(pointLightGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, pointLightGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, pointLightGeometry.indexCount, pointLightGeometry.indexType, 0);
 
     for (unsigned int i = 0; i < 4; i++)
     {
@@ -318,7 +318,7 @@ int main(int argc, char *argv[])
       lightObjectShader.setVec3("lightColor", pointLightColors[i]);
 
       glBindVertexArray(pointLightGeometry.VAO);
-      glDrawElements(GL_TRIANGLES, pointLightGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+      glDrawElements(GL_TRIANGLES, pointLightGeometry.indexCount, pointLightGeometry.indexType, 0);
     }
     // ************************************************************
 
@@ -333,6 +333,7 @@ int main(int argc, char *argv[])
   boxGeometry.dispose();
   groundGeometry.dispose();
   pointLightGeometry.dispose();
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
@@ -21,7 +21,7 @@ void processInput(GLFWwindow *window);
 unsigned int loadTexture(char const *path);
 unsigned int loadCubemap(vector<std::string> faces);
 
-void drawSkyBox(Shader shader, BoxGeometry geometry, unsigned int cubeMap);
+void drawSkyBox(Shader &shader, GeometryView geometry, unsigned int cubeMap);
 
 std::string Shader::dirName;
 
@@ -241,7 +241,7 @@ int main(int argc, char *argv[])
     // glActiveTexture(GL_TEXTURE0);
     // glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
     // glBindVertexArray(skyboxGeometry.VAO);
-    // glDrawElements(GL_TRIANGLES, skyboxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    // glDrawElements(GL_TRIANGLES, skyboxGeometry.indexCount, skyboxGeometry.indexType, 0);
 
     // glBindVertexArray(0);
     // glDepthFunc(GL_LESS);
@@ -286,7 +286,7 @@ int main(int argc, char *argv[])
     sceneShader.setMat4("model", model);
 
     glBindVertexArray(groundGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, groundGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, groundGeometry.indexCount, groundGeometry.indexType, 0);
     glBindVertexArray(0);
     // ********************************************************
 
@@ -301,14 +301,14 @@ int main(int argc, char *argv[])
     sceneShader.setMat4("model", model);
 
     glBindVertexArray(containerGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, containerGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, containerGeometry.indexCount, containerGeometry.indexType, 0);
 
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(-1.0, 0.5, 2.0));
     sceneShader.setMat4("model", model);
 
     glBindVertexArray(containerGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, containerGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, containerGeometry.indexCount, containerGeometry.indexType, 0);
     // ----------------------------------------------------------
 
     // 绘制草丛面板
@@ -329,7 +329,7 @@ int main(int argc, char *argv[])
       model = glm::mat4(1.0f);
       model = glm::translate(model, iterator->second);
       sceneShader.setMat4("model", model);
-      glDrawElements(GL_TRIANGLES, grassGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+      glDrawElements(GL_TRIANGLES, grassGeometry.indexCount, grassGeometry.indexType, 0);
     }
     // ----------------------------------------------------------
 
@@ -346,7 +346,7 @@ int main(int argc, char *argv[])
     lightObjectShader.setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
 
     glBindVertexArray(pointLightGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, pointLightGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, pointLightGeometry.indexCount, pointLightGeometry.indexType, 0);
 
     for (unsigned int i = 0; i < 4; i++)
     {
@@ -357,7 +357,7 @@ int main(int argc, char *argv[])
       lightObjectShader.setVec3("lightColor", pointLightColors[i]);
 
       glBindVertexArray(pointLightGeometry.VAO);
-      glDrawElements(GL_TRIANGLES, pointLightGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+      glDrawElements(GL_TRIANGLES, pointLightGeometry.indexCount, pointLightGeometry.indexType, 0);
     }
     // ************************************************************
 
@@ -373,6 +373,7 @@ int main(int argc, char *argv[])
   skyboxGeometry.dispose();
   groundGeometry.dispose();
   pointLightGeometry.dispose();
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
@@ -502,7 +503,7 @@ unsigned int loadCubemap(vector<std::string> faces)
 }
 
 // *******************method*********************
-void drawSkyBox(Shader shader, BoxGeometry geometry, unsigned int cubeMap)
+void drawSkyBox(Shader &shader, GeometryView geometry, unsigned int cubeMap)
 {
 
   glDepthFunc(GL_LEQUAL);
@@ -520,7 +521,7 @@ void drawSkyBox(Shader shader, BoxGeometry geometry, unsigned int cubeMap)
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_CUBE_MAP, cubeMap);
   glBindVertexArray(geometry.VAO);
-  glDrawElements(GL_TRIANGLES, geometry.indices.size(), GL_UNSIGNED_INT, 0);
+  glDrawElementsBaseVertex(GL_TRIANGLES, geometry.count, geometry.indexType, geometry.indexOffset(), geometry.baseVertex);
 
   glBindVertexArray(0);
   glDepthFunc(GL_LESS);
@@ -24,7 +24,7 @@ void processInput(GLFWwindow *window);
 unsigned int loadTexture(char const *path);
 unsigned int loadCubemap(vector<std::string> faces);
 
-void drawSkyBox(Shader shader, BoxGeometry geometry, unsigned int cubeMap);
+void drawSkyBox(Shader &shader, GeometryView geometry, unsigned int cubeMap);
 
 std::string Shader::dirName;
 
@@ -204,6 +204,7 @@ int main(int argc, char *argv[])
   containerGeometry.dispose();
   sphereGeometry.dispose();
   skyboxGeometry.dispose();
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
@@ -333,7 +334,7 @@ unsigned int loadCubemap(vector<std::string> faces)
 }
 
 // *******************method*********************
-void drawSkyBox(Shader shader, BoxGeometry geometry, unsigned int cubeMap)
+void drawSkyBox(Shader &shader, GeometryView geometry, unsigned int cubeMap)
 {
 
   glDepthFunc(GL_LEQUAL);
@@ -351,7 +352,7 @@ void drawSkyBox(Shader shader, BoxGeometry geometry, unsigned int cubeMap)
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_CUBE_MAP, cubeMap);
   glBindVertexArray(geometry.VAO);
-  glDrawElements(GL_TRIANGLES, geometry.indices.size(), GL_UNSIGNED_INT, 0);
+  glDrawElementsBaseVertex(GL_TRIANGLES, geometry.count, geometry.indexType, geometry.indexOffset(), geometry.baseVertex);
 
   glBindVertexArray(0);
   glDepthFunc(GL_LESS);
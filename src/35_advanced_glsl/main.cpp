@@ -24,7 +24,7 @@ void processInput(GLFWwindow *window);
 unsigned int loadTexture(char const *path);
 unsigned int loadCubemap(vector<std::string> faces);
 
-void drawSkyBox(Shader shader, BoxGeometry geometry, unsigned int cubeMap);
+void drawSkyBox(Shader &shader, GeometryView geometry, unsigned int cubeMap);
 
 std::string Shader::dirName;
 
@@ -190,28 +190,28 @@ int main(int argc, char *argv[])
     model = model * glm::mat4_cast(qu);
     sceneShader1.use();
     sceneShader1.setMat4("model", model);
-    glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
 
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(0.75f, 0.75f, 0.0f));
     model = model * glm::mat4_cast(qu);
     sceneShader2.use();
     sceneShader2.setMat4("model", model);
-    glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
 
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(0.75f, -0.75f, 0.0f));
     model = model * glm::mat4_cast(qu);
     sceneShader3.use();
     sceneShader3.setMat4("model", model);
-    glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
 
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(-0.75f, -0.75f, 0.0f));
     model = model * glm::mat4_cast(qu);
     sceneShader4.use();
     sceneShader4.setMat4("model", model);
-    glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
 
     // 渲染 gui
     ImGui::Render();
@@ -221,6 +221,7 @@ int main(int argc, char *argv[])
     glfwPollEvents();
   }
 
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
@@ -350,7 +351,7 @@ unsigned int loadCubemap(vector<std::string> faces)
 }
 
 // *******************method*********************
-void drawSkyBox(Shader shader, BoxGeometry geometry, unsigned int cubeMap)
+void drawSkyBox(Shader &shader, GeometryView geometry, unsigned int cubeMap)
 {
 
   glDepthFunc(GL_LEQUAL);
@@ -368,7 +369,7 @@ void drawSkyBox(Shader shader, BoxGeometry geometry, unsigned int cubeMap)
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_CUBE_MAP, cubeMap);
   glBindVertexArray(geometry.VAO);
-  glDrawElements(GL_TRIANGLES, geometry.indices.size(), GL_UNSIGNED_INT, 0);
+  glDrawElementsBaseVertex(GL_TRIANGLES, geometry.count, geometry.indexType, geometry.indexOffset(), geometry.baseVertex);
 
   glBindVertexArray(0);
   glDepthFunc(GL_LESS);
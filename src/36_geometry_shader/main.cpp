@@ -24,7 +24,7 @@ void processInput(GLFWwindow *window);
 unsigned int loadTexture(char const *path);
 unsigned int loadCubemap(vector<std::string> faces);
 
-void drawSkyBox(Shader shader, BoxGeometry geometry, unsigned int cubeMap);
+void drawSkyBox(Shader &shader, GeometryView geometry, unsigned int cubeMap);
 
 std::string Shader::dirName;
 
@@ -158,9 +158,9 @@ int main(int argc, char *argv[])
     // ourModel.Draw(sceneShader);
 
     glBindVertexArray(boxGeometry.VAO);
-    glDrawElements(GL_POINTS, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_POINTS, boxGeometry.indexCount, boxGeometry.indexType, 0);
 
-    glDrawElements(GL_LINE_LOOP, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_LINE_LOOP, boxGeometry.indexCount, boxGeometry.indexType, 0);
     glBindVertexArray(0);
 
     normalShader.use();
@@ -168,7 +168,7 @@ int main(int argc, char *argv[])
     normalShader.setMat4("view", view);
     normalShader.setMat4("model", model);
     glBindVertexArray(boxGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, boxGeometry.indexCount, boxGeometry.indexType, 0);
     glBindVertexArray(0);
     // ourModel.Draw(normalShader);
 
@@ -180,6 +180,7 @@ int main(int argc, char *argv[])
     glfwPollEvents();
   }
 
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
@@ -309,7 +310,7 @@ unsigned int loadCubemap(vector<std::string> faces)
 }
 
 // *******************method*********************
-void drawSkyBox(Shader shader, BoxGeometry geometry, unsigned int cubeMap)
+void drawSkyBox(Shader &shader, GeometryView geometry, unsigned int cubeMap)
 {
 
   glDepthFunc(GL_LEQUAL);
@@ -327,7 +328,7 @@ void drawSkyBox(Shader shader, BoxGeometry geometry, unsigned int cubeMap)
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_CUBE_MAP, cubeMap);
   glBindVertexArray(geometry.VAO);
-  glDrawElements(GL_TRIANGLES, geometry.indices.size(), GL_UNSIGNED_INT, 0);
+  glDrawElementsBaseVertex(GL_TRIANGLES, geometry.count, geometry.indexType, geometry.indexOffset(), geometry.baseVertex);
 
   glBindVertexArray(0);
   glDepthFunc(GL_LESS);
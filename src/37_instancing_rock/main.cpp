@@ -3,6 +3,10 @@
 #include <iostream>
 #include <cmath>
 #include <map>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
 
 #include <tool/shader.h>
 #include <tool/camera.h>
@@ -17,6 +21,7 @@
 
 #include <tool/mesh.h>
 #include <tool/model.h>
+#include <tool/instance_culler.h>
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
@@ -24,7 +29,7 @@ void processInput(GLFWwindow *window);
 unsigned int loadTexture(char const *path);
 unsigned int loadCubemap(vector<std::string> faces);
 
-void drawSkyBox(Shader shader, BoxGeometry geometry, unsigned int cubeMap);
+void drawSkyBox(Shader &shader, GeometryView geometry, unsigned int cubeMap);
 
 std::string Shader::dirName;
 
@@ -42,17 +47,37 @@ float lastY = SCREEN_HEIGHT / 2.0f;
 
 Camera camera(glm::vec3(0.0, 0.0, 30.0));
 
+// 岩石的剔除方式
+enum RockCulling
+{
+  CULL_OFF, // 全部绘制
+  CULL_CPU, // CullSet（SSE）剔除后上传可见岩石的编号
+  CULL_GPU  // InstanceCuller：计算着色器（GL 4.3）或变换反馈（GL 3.3），按距离分 LOD
+};
+
 using namespace std;
 
+// 用法：./output/main src/37_instancing_rock/ [岩石数量，默认 100000，可到 1000000] [--benchmark]
+//   --benchmark  从几个固定机位按不同的 LOD 误差各渲染若干帧，输出提交的三角形数量和每帧耗时后退出
 int main(int argc, char *argv[])
 {
   Shader::dirName = argv[1];
+  unsigned int amount = 100000;
+  bool benchmark = false;
+  for (int i = 2; i < argc; i++)
+  {
+    if (std::string(argv[i]) == "--benchmark")
+      benchmark = true;
+    else
+      amount = (unsigned int)std::max(atoi(argv[i]), 1);
+  }
   glfwInit();
   // 设置主要和次要版本
   const char *glsl_version = "#version 330";
 
   // 片段着色器将作用域每一个采样点（采用4倍抗锯齿，则每个像素有4个片段（四个采样点））
   // glfwWindowHint(GLFW_SAMPLES, 4);
+  // 申请 3.3 core，驱动通常会给出支持的最高版本，4.3 以上时使用计算着色器剔除
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -101,8 +126,10 @@ int main(int argc, char *argv[])
   // 3.将鼠标隐藏
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-  Shader sceneShader("./shader/scene_vert.glsl", "./shader/scene_frag.glsl");
-  Shader instanceShader("./shader/instance_vert.glsl", "./shader/scene_frag.glsl");
+  // 岩石数量巨大，使用压缩顶点格式减少顶点带宽
+  VertexFormat modelFormat = VertexFormat::quantized();
+  Shader sceneShader("./shader/scene_vert.glsl", "./shader/scene_frag.glsl", nullptr, modelFormat.defines());
+  Shader instanceShader("./shader/instance_vert.glsl", "./shader/scene_frag.glsl", nullptr, modelFormat.defines());
 
   PlaneGeometry planeGeometry(0.1, 0.1);          // 面板
   BoxGeometry boxGeometry(0.1, 0.1, 0.1);         // 盒子
@@ -111,12 +138,15 @@ int main(int argc, char *argv[])
   float fov = 45.0f;                                                          // 视锥体的角度
   ImVec4 clear_color = ImVec4(25.0 / 255.0, 25.0 / 255.0, 25.0 / 255.0, 1.0); // 25, 25, 25
 
-  Model rock("./static/model/rock/rock.obj");
-  Model planet("./static/model/planet/planet.obj");
+  // 导入时为每个网格生成 4 级 LOD（每级约一半三角形），随网格一起缓存
+  Model::lodLevels = 4;
+  // 上传后不再需要顶点数据，释放内存中的副本
+  Model rock("./static/model/rock/rock.obj", false, RETAIN_NONE, modelFormat);
+  Model planet("./static/model/planet/planet.obj", false, RETAIN_NONE, modelFormat);
+  rock.printMemoryReport();
+  planet.printMemoryReport();
 
-  unsigned int amount = 100000;
-  glm::mat4 *modelMatrices;
-  modelMatrices = new glm::mat4[amount];
+  std::vector<glm::mat4> modelMatrices(amount);
   srand(glfwGetTime()); // initialize random seed
   float radius = 20.0;
   float offset = 1.5f;
@@ -145,67 +175,52 @@ int main(int argc, char *argv[])
     modelMatrices[i] = model;
   }
 
-  // 设置实例化数组
-  unsigned int buffer;
-  glGenBuffers(1, &buffer);
-  glBindBuffer(GL_ARRAY_BUFFER, buffer);
-  glBufferData(GL_ARRAY_BUFFER, amount * sizeof(glm::mat4), &modelMatrices[0], GL_STATIC_DRAW);
-  for (unsigned int i = 0; i < rock.meshes.size(); i++)
+  // 每块岩石的世界空间包围盒，加载时算好，每帧只做平面测试
+  CullSet rockBounds;
+  rockBounds.reserve(amount);
+  for (unsigned int i = 0; i < amount; i++)
+    rockBounds.add(Frustum::transform(rock.bounds, modelMatrices[i]));
+  std::vector<uint32_t> visibleRocks;
+  std::vector<uint32_t> allRocks(amount);
+  for (unsigned int i = 0; i < amount; i++)
+    allRocks[i] = i;
+
+  // 矩阵只上传一次（纹理缓冲），每帧写入的是可见岩石的编号
+  // 岩石模型只有一个网格。LOD 的切换距离按最大的岩石（缩放 0.021）计算，简化误差在屏幕上不超过 maxPixelError 像素，最远绘制到远平面
+  const float ROCK_SCALE = 0.021f;
+  float maxPixelError = 1.0f;
+  float pixelScale = camera.GetPixelScale((float)SCREEN_HEIGHT);
+  InstanceCuller::Path cullPath = InstanceCuller::preferredPath();
+  std::vector<InstanceLod> rockLods = InstanceCuller::levelsOf(rock.meshes[0], ROCK_SCALE, pixelScale, maxPixelError, 100.0f);
+  InstanceCuller rockCuller(modelMatrices, rock.bounds, rockLods, cullPath);
+
+  Shader cullShader;
+  if (cullPath == InstanceCuller::COMPUTE)
+    cullShader.submitCompute("./shader/cull_comp.glsl");
+  else
   {
-    unsigned int VAO = rock.meshes[i].VAO;
-    glBindVertexArray(VAO);
-    // 顶点属性
-    GLsizei vec4Size = sizeof(glm::vec4);
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void *)0);
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void *)(vec4Size));
-    glEnableVertexAttribArray(5);
-    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void *)(2 * vec4Size));
-    glEnableVertexAttribArray(6);
-    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void *)(3 * vec4Size));
-
-    glVertexAttribDivisor(3, 1);
-    glVertexAttribDivisor(4, 1);
-    glVertexAttribDivisor(5, 1);
-    glVertexAttribDivisor(6, 1);
-
-    glBindVertexArray(0);
+    cullShader.feedbackVaryings = {"visibleIndex"};
+    cullShader.submit("./shader/cull_vert.glsl", "./shader/cull_frag.glsl", "./shader/cull_geo.glsl");
   }
+  cullShader.finish();
 
-  float factor = 0.0;
-  while (!glfwWindowShouldClose(window))
-  {
-    processInput(window);
+  int culling = CULL_GPU;
+  int lastCulling = -1;
+  std::vector<GLuint> rockCounts(rockLods.size(), 0);
+  unsigned int frame = 0;
+  double cullMicroseconds = 0.0;
+  size_t planetTriangles = 0;
 
-    float currentFrame = glfwGetTime();
-    deltaTime = currentFrame - lastTime;
-    lastTime = currentFrame;
-
-    // 在标题中显示帧率信息
-    // *************************************************************************
-    int fps_value = (int)round(ImGui::GetIO().Framerate);
-    int ms_value = (int)round(1000.0f / ImGui::GetIO().Framerate);
-
-    std::string FPS = std::to_string(fps_value);
-    std::string ms = std::to_string(ms_value);
-    std::string newTitle = "LearnOpenGL - " + ms + " ms/frame " + FPS;
-    glfwSetWindowTitle(window, newTitle.c_str());
-
-    ImGui_ImplOpenGL3_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
-    ImGui::NewFrame();
-    factor = glfwGetTime();
-    // *************************************************************************
-
-    // 渲染指令
-    // ...
+  // 绘制行星和岩石，行星提交的三角形数量记在 planetTriangles
+  auto drawScene = [&]() {
     glClearColor(clear_color.x, clear_color.y, clear_color.z, clear_color.w);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    float aspect = (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT;
     glm::mat4 view = camera.GetViewMatrix();
-    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
+    glm::mat4 projection = camera.GetProjectionMatrix(aspect);
     glm::mat4 model = glm::mat4(1.0f);
+    Frustum frustum = camera.GetFrustum(aspect);
 
     sceneShader.use();
     sceneShader.setMat4("projection", projection);
@@ -214,7 +229,29 @@ int main(int argc, char *argv[])
     model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
     sceneShader.setMat4("model", model);
 
-    planet.Draw(sceneShader);
+    if (culling != CULL_OFF)
+      planetTriangles = planet.Draw(sceneShader, frustum, model, camera.Position, pixelScale, maxPixelError);
+    else
+    {
+      planet.Draw(sceneShader);
+      planetTriangles = 0;
+      for (const Mesh &mesh : planet.meshes)
+        planetTriangles += mesh.indexCount / 3;
+    }
+
+    // 岩石剔除：CPU 只提交一次剔除，GPU 上每块岩石的结果直接写进绘制命令
+    std::chrono::steady_clock::time_point cullStart = std::chrono::steady_clock::now();
+    if (culling == CULL_GPU)
+      rockCuller.cull(cullShader, frustum, camera.Position);
+    else if (culling == CULL_CPU)
+    {
+      rockBounds.cull(frustum, visibleRocks);
+      rockCuller.setVisible(visibleRocks);
+    }
+    else if (lastCulling != CULL_OFF)
+      rockCuller.setVisible(allRocks);
+    cullMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - cullStart).count();
+    lastCulling = culling;
 
     // for (unsigned int i = 0; i < amount; i++)
     // {
@@ -226,13 +263,113 @@ int main(int argc, char *argv[])
     instanceShader.setMat4("projection", projection);
     instanceShader.setMat4("view", view);
     instanceShader.setInt("diffuseTexture", 0);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, rock.textures_loaded[0].id);
-    for (unsigned int i = 0; i < rock.meshes.size(); i++)
+    GLState::bindTexture(0, GL_TEXTURE_2D, rock.textures_loaded[0].id);
+    rockCuller.bindMatrices(instanceShader, 1);
+    rock.meshes[0].BindVertexFormat(instanceShader);
+    rockCuller.draw(rock.meshes[0]);
+  };
+  // 岩石提交的三角形数量
+  auto rockTriangles = [&]() {
+    size_t triangles = 0;
+    for (size_t i = 0; i < rockCounts.size(); i++)
+      triangles += (size_t)rockCounts[i] * rockCuller.levels()[i].count / 3;
+    return triangles;
+  };
+
+  if (benchmark)
+  {
+    glfwSwapInterval(0);
+    const float errors[] = {0.0f, 0.5f, 1.0f, 2.0f, 4.0f};
+    const glm::vec3 up(0.0f, 1.0f, 0.0f);
+    const Camera views[] = {Camera(glm::vec3(0.0f, 0.0f, 30.0f)), Camera(glm::vec3(0.0f, 1.0f, 22.0f), up, 180.0f, 0.0f),
+                            Camera(glm::vec3(35.0f, 12.0f, 35.0f), up, -135.0f, -15.0f), Camera(glm::vec3(0.0f, 45.0f, 0.1f), up, -90.0f, -89.0f)};
+    const int WARMUP = 5, FRAMES = 20;
+    std::cout << amount << " rocks, " << (cullPath == InstanceCuller::COMPUTE ? "compute" : "transform feedback") << " culling, rock LOD triangles:";
+    for (const MeshLod &level : rock.meshes[0].lods)
+      std::cout << " " << level.indexCount / 3;
+    std::cout << std::endl;
+    for (float error : errors)
     {
-      glBindVertexArray(rock.meshes[i].VAO);
-      glDrawElementsInstanced(GL_TRIANGLES, rock.meshes[i].indices.size(), GL_UNSIGNED_INT, 0, amount);
+      maxPixelError = error;
+      rockCuller.setLevels(InstanceCuller::levelsOf(rock.meshes[0], ROCK_SCALE, pixelScale, maxPixelError, 100.0f));
+      double milliseconds = 0.0;
+      size_t triangles = 0;
+      for (const Camera &view : views)
+      {
+        camera = view;
+        for (int i = 0; i < WARMUP + FRAMES; i++)
+        {
+          std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+          drawScene();
+          glfwSwapBuffers(window);
+          glFinish();
+          if (i < WARMUP)
+            continue;
+          milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+          rockCounts = rockCuller.readCounts();
+          triangles += rockTriangles() + planetTriangles;
+        }
+      }
+      int samples = FRAMES * (int)(sizeof(views) / sizeof(views[0]));
+      char line[160];
+      snprintf(line, sizeof(line), "max pixel error %3.1f: %10zu triangles/frame  %7.2f ms/frame", error, triangles / samples, milliseconds / samples);
+      std::cout << line << std::endl;
     }
+    GLState::contextDestroyed();
+    glfwTerminate();
+    return 0;
+  }
+
+  float factor = 0.0;
+  while (!glfwWindowShouldClose(window))
+  {
+    processInput(window);
+
+    float currentFrame = glfwGetTime();
+    deltaTime = currentFrame - lastTime;
+    lastTime = currentFrame;
+
+    // 在标题中显示帧率信息
+    // *************************************************************************
+    int fps_value = (int)round(ImGui::GetIO().Framerate);
+    int ms_value = (int)round(1000.0f / ImGui::GetIO().Framerate);
+
+    std::string FPS = std::to_string(fps_value);
+    std::string ms = std::to_string(ms_value);
+    std::string newTitle = "LearnOpenGL - " + ms + " ms/frame " + FPS;
+    glfwSetWindowTitle(window, newTitle.c_str());
+
+    ImGui_ImplOpenGL3_NewFrame();
+    ImGui_ImplGlfw_NewFrame();
+    ImGui::NewFrame();
+    factor = glfwGetTime();
+    // *************************************************************************
+
+    // 渲染指令
+    // ...
+    int previousCulling = lastCulling;
+    drawScene();
+    // GPU 剔除的数量需要回读（会等待 GPU），每 30 帧读一次用于显示
+    if (culling != CULL_GPU || previousCulling != CULL_GPU || frame % 30 == 0)
+      rockCounts = rockCuller.readCounts();
+    frame++;
+
+    unsigned int rockCount = 0;
+    for (GLuint count : rockCounts)
+      rockCount += count;
+    ImGui::Begin("frustum culling");
+    ImGui::Combo("rocks", &culling, "off\0CPU (CullSet)\0GPU\0");
+    ImGui::Text("GPU path: %s", cullPath == InstanceCuller::COMPUTE ? "compute + multi draw indirect" : "transform feedback");
+    ImGui::Text("rocks: %u / %u drawn, %u culled", rockCount, amount, amount - rockCount);
+    for (size_t i = 0; i < rockCounts.size(); i++)
+      ImGui::Text("  LOD %zu: %u", i, rockCounts[i]);
+    ImGui::Text("cull submit: %.1f us", cullMicroseconds);
+    // 0 为全部使用完整网格；CPU 剔除和不剔除时岩石总是完整网格
+    if (ImGui::SliderFloat("max pixel error", &maxPixelError, 0.0f, 8.0f))
+      rockCuller.setLevels(InstanceCuller::levelsOf(rock.meshes[0], ROCK_SCALE, pixelScale, maxPixelError, 100.0f));
+    ImGui::Text("triangles: rocks %zu, planet %zu", rockTriangles(), planetTriangles);
+    ImGui::Text("frame: %.2f ms", 1000.0f / ImGui::GetIO().Framerate);
+    ImGui::End();
 
     // 渲染 gui
     ImGui::Render();
@@ -242,6 +379,7 @@ int main(int argc, char *argv[])
     glfwPollEvents();
   }
 
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
@@ -371,7 +509,7 @@ unsigned int loadCubemap(vector<std::string> faces)
 }
 
 // *******************method*********************
-void drawSkyBox(Shader shader, BoxGeometry geometry, unsigned int cubeMap)
+void drawSkyBox(Shader &shader, GeometryView geometry, unsigned int cubeMap)
 {
 
   glDepthFunc(GL_LEQUAL);
@@ -389,7 +527,7 @@ void drawSkyBox(Shader shader, BoxGeometry geometry, unsigned int cubeMap)
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_CUBE_MAP, cubeMap);
   glBindVertexArray(geometry.VAO);
-  glDrawElements(GL_TRIANGLES, geometry.indices.size(), GL_UNSIGNED_INT, 0);
+  glDrawElementsBaseVertex(GL_TRIANGLES, geometry.count, geometry.indexType, geometry.indexOffset(), geometry.baseVertex);
 
   glBindVertexArray(0);
   glDepthFunc(GL_LESS);
@@ -0,0 +1,37 @@
+#version 430 core
+#include "instance_cull.glsl"
+
+// GL 4.3：每个线程剔除一个实例，存活的实例编号写入所属 LOD 的区域，并累加该 LOD 绘制命令的 instanceCount
+layout(local_size_x = 64) in;
+
+// 与 glMultiDrawElementsIndirect 的命令格式一致，baseInstance 是该 LOD 区域的起点
+struct DrawCommand {
+  uint count;
+  uint instanceCount;
+  uint firstIndex;
+  int baseVertex;
+  uint baseInstance;
+};
+
+layout(std430, binding = 0) readonly buffer Spheres {
+  vec4 spheres[];
+};
+layout(std430, binding = 1) writeonly buffer Visible {
+  uint visible[];
+};
+layout(std430, binding = 2) buffer Commands {
+  DrawCommand commands[];
+};
+
+uniform int totalInstances;
+
+void main() {
+  uint i = gl_GlobalInvocationID.x;
+  if (i >= uint(totalInstances))
+    return;
+  int lod = cullInstance(spheres[i]);
+  if (lod < 0)
+    return;
+  uint slot = atomicAdd(commands[lod].instanceCount, 1u);
+  visible[commands[lod].baseInstance + slot] = i;
+}
\ No newline at end of file
@@ -0,0 +1,7 @@
+#version 330 core
+// 剔除时关闭了光栅化，不会执行，只是程序需要一个片段着色器
+out vec4 FragColor;
+
+void main() {
+  FragColor = vec4(0.0);
+}
\ No newline at end of file
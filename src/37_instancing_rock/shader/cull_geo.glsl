@@ -0,0 +1,19 @@
+#version 330 core
+layout(points) in;
+layout(points, max_vertices = 1) out;
+
+flat in int vLod[];
+flat in uint vIndex[];
+
+uniform int currentLod;
+
+// 变换反馈捕获的输出
+out uint visibleIndex;
+
+void main() {
+  if (vLod[0] == currentLod) {
+    visibleIndex = vIndex[0];
+    EmitVertex();
+    EndPrimitive();
+  }
+}
\ No newline at end of file
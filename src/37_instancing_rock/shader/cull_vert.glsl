@@ -0,0 +1,13 @@
+#version 330 core
+#include "instance_cull.glsl"
+
+// GL 3.3：每个实例画一个点，顶点着色器剔除，几何着色器只输出当前 LOD 的实例编号（变换反馈）
+layout(location = 0) in vec4 sphere;
+
+flat out int vLod;
+flat out uint vIndex;
+
+void main() {
+  vLod = cullInstance(sphere);
+  vIndex = uint(gl_VertexID);
+}
\ No newline at end of file
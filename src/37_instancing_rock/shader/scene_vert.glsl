@@ -1,7 +1,5 @@
 #version 330 core
-layout(location = 0) in vec3 Position;
-layout(location = 1) in vec3 Normal;
-layout(location = 2) in vec2 TexCoords;
+#include "vertex_format.glsl"
 
 uniform mat4 model;
 uniform mat4 view;
@@ -11,5 +9,5 @@ out vec2 oTexCoord;
 
 void main() {
   oTexCoord = TexCoords;
-  gl_Position = projection * view * model * vec4(Position, 1.0f);
+  gl_Position = projection * view * model * vec4(vertexPosition(), 1.0f);
 }
\ No newline at end of file
@@ -178,7 +178,7 @@ int main(int argc, char *argv[])
     sceneShader.setMat4("model", model);
 
     glBindVertexArray(groundGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, groundGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, groundGeometry.indexCount, groundGeometry.indexType, 0);
     glBindVertexArray(0);
     // ********************************************************
 
@@ -196,7 +196,7 @@ int main(int argc, char *argv[])
     lightObjectShader.setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
 
     glBindVertexArray(pointLightGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, pointLightGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, pointLightGeometry.indexCount, pointLightGeometry.indexType, 0);
     // ********************************************************
 
     // 渲染 gui
@@ -209,6 +209,7 @@ int main(int argc, char *argv[])
 
   groundGeometry.dispose();
   pointLightGeometry.dispose();
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
@@ -21,8 +21,8 @@ void processInput(GLFWwindow *window);
 unsigned int loadTexture(char const *path);
 
 // method
-void drawMesh(BufferGeometry geometry);
-void drawLightObject(Shader shader, BufferGeometry geometry, glm::vec3 position);
+void drawMesh(GeometryView geometry);
+void drawLightObject(Shader &shader, GeometryView geometry, glm::vec3 position);
 
 std::string Shader::dirName;
 
@@ -212,21 +212,22 @@ int main(int argc, char *argv[])
   floorGeometry.dispose();
   pointLightGeometry.dispose();
 
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
 }
 
 // 绘制物体
-void drawMesh(BufferGeometry geometry)
+void drawMesh(GeometryView geometry)
 {
   glBindVertexArray(geometry.VAO);
-  glDrawElements(GL_TRIANGLES, geometry.indices.size(), GL_UNSIGNED_INT, 0);
+  glDrawElementsBaseVertex(GL_TRIANGLES, geometry.count, geometry.indexType, geometry.indexOffset(), geometry.baseVertex);
   glBindVertexArray(0);
 }
 
 // 绘制灯光物体
-void drawLightObject(Shader shader, BufferGeometry geometry, glm::vec3 position)
+void drawLightObject(Shader &shader, GeometryView geometry, glm::vec3 position)
 {
   glm::mat4 view = camera.GetViewMatrix();
   glm::mat4 projection = glm::mat4(1.0f);
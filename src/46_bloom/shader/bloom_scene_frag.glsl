@@ -2,27 +2,7 @@
 layout(location = 0) out vec4 FragColor;
 layout(location = 1) out vec4 BrightColor;
 
-// 定向光
-struct DirectionLight {
-  vec3 direction;
-
-  vec3 ambient;
-  vec3 diffuse;
-  vec3 specular;
-};
-
-// 点光源
-struct PointLight {
-  vec3 position;
-
-  float constant;
-  float linear;
-  float quadratic;
-
-  vec3 ambient;
-  vec3 diffuse;
-  vec3 specular;
-};
+#include "light.glsl"
 
 in VS_OUT {
   vec3 FragPos;
@@ -30,7 +10,9 @@ in VS_OUT {
   vec2 TexCoords;
 } fs_in;
 
+#ifndef NR_POINT_LIGHTS
 #define NR_POINT_LIGHTS 4
+#endif
 
 uniform DirectionLight directionLight;
 uniform PointLight pointLights[NR_POINT_LIGHTS];
@@ -39,9 +21,6 @@ uniform sampler2D brickMap; // 贴图
 
 uniform vec3 viewPos;
 
-vec3 CalcDirectionLight(DirectionLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-
 void main() {
 
   // 计算光照
@@ -69,40 +48,3 @@ void main() {
 
   FragColor = vec4(color);
 }
-
-// 计算定向光
-vec3 CalcDirectionLight(DirectionLight light, vec3 normal, vec3 viewDir) {
-  vec3 lightDir = normalize(light.direction);
-  float diff = max(dot(normal, lightDir), 0.0);
-  vec3 reflectDir = reflect(-lightDir, normal);
-  float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
-
-  // 合并
-  vec3 ambient = light.ambient;
-  vec3 diffuse = light.diffuse * diff;
-  vec3 specular = light.specular * spec;
-
-  return ambient + diffuse + specular;
-}
-
-// 计算点光源
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
-  vec3 lightDir = normalize(light.position - fragPos);
-    // 漫反射着色
-  float diff = max(dot(normal, lightDir), 0.0);
-    // 镜面光着色
-  vec3 reflectDir = reflect(-lightDir, normal);
-  float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
-    // 衰减
-  float distance = length(light.position - fragPos);
-  float attenuation = 1.0 / (light.constant + light.linear * distance +
-    light.quadratic * (distance * distance));    
-    // 合并结果
-  vec3 ambient = light.ambient;
-  vec3 diffuse = light.diffuse * diff;
-  vec3 specular = light.specular * spec;
-  ambient *= attenuation;
-  diffuse *= attenuation;
-  specular *= attenuation;
-  return (ambient + diffuse + specular);
-}
\ No newline at end of file
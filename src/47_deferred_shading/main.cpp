@@ -5,6 +5,10 @@
 #include <map>
 
 #include <tool/shader.h>
+#include <tool/shader_watcher.h>
+#include <tool/uniform_buffer.h>
+#include <tool/render_queue.h>
+#include <tool/static_batch.h>
 #include <tool/camera.h>
 #include <geometry/BoxGeometry.h>
 #include <geometry/PlaneGeometry.h>
@@ -13,6 +17,10 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <tool/stb_image.h>
 
+// 统计渲染循环中的堆分配次数
+#define ALLOC_COUNTER_IMPLEMENTATION
+#include <tool/alloc_counter.h>
+
 #include <tool/gui.h>
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
@@ -21,8 +29,8 @@ void processInput(GLFWwindow *window);
 unsigned int loadTexture(char const *path);
 
 // method
-void drawMesh(BufferGeometry geometry);
-void drawLightObject(Shader shader, BufferGeometry geometry, glm::vec3 position);
+void drawMesh(GeometryView geometry);
+void drawLightObject(Shader &shader, GeometryView geometry, glm::vec3 position);
 
 std::string Shader::dirName;
 
@@ -110,7 +118,13 @@ int main(int argc, char *argv[])
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
   Shader geometryShader("./shader/g_buffer_vert.glsl", "./shader/g_buffer_frag.glsl");
+  // 从 StaticBatch 中读取模型矩阵的版本
+  Shader geometryBatchShader("./shader/g_buffer_vert.glsl", "./shader/g_buffer_frag.glsl", nullptr, StaticBatch::defines());
+  const unsigned int NR_LIGHTS = MAX_POINT_LIGHTS;
   Shader sceneShader("./shader/scene_vert.glsl", "./shader/scene_frag.glsl");
+  // 对比用：光源不放在 uniform 缓冲中，每帧逐个设置 uniform
+  Shader sceneUniformShader("./shader/scene_vert.glsl", "./shader/scene_frag.glsl", nullptr,
+                            {{"LIGHT_UNIFORMS", "1"}, {"NR_POINT_LIGHTS", std::to_string(NR_LIGHTS)}});
   Shader lightShader("./shader/light_object_vert.glsl", "./shader/light_object_frag.glsl");
 
   PlaneGeometry groundGeometry(10.0, 10.0);            // 地面
@@ -180,7 +194,6 @@ int main(int argc, char *argv[])
       glm::vec3(0.0, -1.0, 3.0),
       glm::vec3(3.0, -1.0, 3.0)};
 
-  const unsigned int NR_LIGHTS = 32;
   std::vector<glm::vec3> lightPositions;
   std::vector<glm::vec3> lightColors;
   srand(13);
@@ -197,14 +210,90 @@ int main(int argc, char *argv[])
     lightColors.push_back(glm::vec3(rColor, gColor, bColor));
   }
 
+  // 相机和光源数据放在 uniform 缓冲中，着色器链接时自动绑定到对应的绑定点
+  UniformBuffer<CameraBlock> cameraBuffer(CAMERA_BLOCK_BINDING);
+  UniformBuffer<LightBlock> lightBuffer(LIGHT_BLOCK_BINDING);
+  for (unsigned int i = 0; i < NR_LIGHTS; i++)
+  {
+    PointLightStd140 &light = lightBuffer.data.pointLights[i];
+    light.position = lightPositions[i];
+    light.ambient = glm::vec3(0.01f, 0.01f, 0.01f);
+    light.diffuse = lightColors[i];
+    light.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+
+    light.linear = 0.09f;
+    light.constant = 1.0f;
+    light.quadratic = 0.032f;
+  }
+  lightBuffer.data.pointLightCount = NR_LIGHTS;
+
+  // 设置采样器，着色器热重载后需要重新执行
+  auto setupSceneShader = [&](Shader &shader)
+  {
+    shader.setInt("gPosition", 0);
+    shader.setInt("gNormal", 1);
+    shader.setInt("gAlbedoSpec", 2);
+  };
   sceneShader.use();
-  sceneShader.setInt("gPosition", 0);
-  sceneShader.setInt("gNormal", 1);
-  sceneShader.setInt("gAlbedoSpec", 2);
+  setupSceneShader(sceneShader);
+
+  // 点光源 uniform 句柄，只在循环外查找一次
+  struct PointLightUniforms
+  {
+    UniformHandle position, ambient, diffuse, specular;
+    UniformHandle linear, constant, quadratic;
+  };
+  std::vector<PointLightUniforms> lightUniforms(NR_LIGHTS);
+  auto setupUniformShader = [&](Shader &shader)
+  {
+    setupSceneShader(shader);
+    for (unsigned int i = 0; i < NR_LIGHTS; i++)
+    {
+      std::string prefix = "pointLights[" + std::to_string(i) + "].";
+      lightUniforms[i].position = shader.uniform(prefix + "position");
+      lightUniforms[i].ambient = shader.uniform(prefix + "ambient");
+      lightUniforms[i].diffuse = shader.uniform(prefix + "diffuse");
+      lightUniforms[i].specular = shader.uniform(prefix + "specular");
+      lightUniforms[i].linear = shader.uniform(prefix + "linear");
+      lightUniforms[i].constant = shader.uniform(prefix + "constant");
+      lightUniforms[i].quadratic = shader.uniform(prefix + "quadratic");
+    }
+  };
+  sceneUniformShader.use();
+  setupUniformShader(sceneUniformShader);
+
+  // 修改 shader 目录下的 glsl 文件后自动重新编译，链接成功才替换
+  ShaderWatcher shaderWatcher;
+  shaderWatcher.watch(geometryShader);
+  shaderWatcher.watch(geometryBatchShader);
+  shaderWatcher.watch(sceneShader, setupSceneShader);
+  shaderWatcher.watch(sceneUniformShader, setupUniformShader);
+  shaderWatcher.watch(lightShader);
+
+  // gbuffer 中的物体按状态和由近到远排序后绘制
+  RenderQueue renderQueue;
+
+  // 圆球不会移动，也可以一次写入静态批次，每帧一次调用绘制全部圆球
+  StaticBatch objectBatch;
+  for (unsigned int i = 0; i < objectPositions.size(); i++)
+    objectBatch.add(objectGeometry, glm::scale(glm::translate(glm::mat4(1.0f), objectPositions[i]), glm::vec3(0.5f)));
+  objectBatch.build();
+  bool useBatch = true;
+  unsigned int gBufferDrawCalls = 0;
+
+  // 灯光上传耗时对比：uniform 缓冲 / 句柄 / 名称查表 / 每次查询驱动
+  int uploadMode = 0;
+  double uploadTime = 0.0;
+  unsigned long bufferUploads = 0;
+  unsigned long uploadQueries = 0;
+
+  unsigned long frameAllocations = 0;
 
   while (!glfwWindowShouldClose(window))
   {
+    AllocCounter::reset();
     processInput(window);
+    shaderWatcher.update();
 
     float currentFrame = glfwGetTime();
     deltaTime = currentFrame - lastTime;
@@ -215,14 +304,27 @@ int main(int argc, char *argv[])
     int fps_value = (int)round(ImGui::GetIO().Framerate);
     int ms_value = (int)round(1000.0f / ImGui::GetIO().Framerate);
 
-    std::string FPS = std::to_string(fps_value);
-    std::string ms = std::to_string(ms_value);
-    std::string newTitle = "LearnOpenGL - " + ms + " ms/frame " + FPS;
-    glfwSetWindowTitle(window, newTitle.c_str());
+    // 写入栈上的缓冲，避免每帧拼接字符串分配内存
+    char newTitle[64];
+    snprintf(newTitle, sizeof(newTitle), "LearnOpenGL - %d ms/frame %d", ms_value, fps_value);
+    glfwSetWindowTitle(window, newTitle);
 
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
+
+    ImGui::Begin("uniform upload");
+    ImGui::Text("heap allocations: %lu/frame", frameAllocations);
+    ImGui::RadioButton("uniform buffer", &uploadMode, 0);
+    ImGui::RadioButton("cached handles", &uploadMode, 1);
+    ImGui::RadioButton("name lookup", &uploadMode, 2);
+    ImGui::RadioButton("glGetUniformLocation", &uploadMode, 3);
+    ImGui::Text("%u lights: %.2f us/frame", NR_LIGHTS, uploadTime * 1000000.0);
+    ImGui::Text("uniform buffer updates: %lu/frame", bufferUploads);
+    ImGui::Text("glGetUniformLocation calls: %lu/frame", uploadQueries);
+    ImGui::Checkbox("static batch", &useBatch);
+    ImGui::Text("g-buffer draw calls: %u", gBufferDrawCalls);
+    ImGui::End();
     // *************************************************************************
 
     // 渲染指令
@@ -235,24 +337,42 @@ int main(int argc, char *argv[])
     glm::mat4 model = glm::mat4(1.0f);
     glm::mat4 view = camera.GetViewMatrix();
     glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
-    geometryShader.use();
-    geometryShader.setMat4("view", view);
-    geometryShader.setMat4("projection", projection);
 
-    for (unsigned int i = 0; i < objectPositions.size(); i++)
+    // 每帧更新一次相机缓冲，所有着色器共用
+    cameraBuffer.data.view = view;
+    cameraBuffer.data.projection = projection;
+    cameraBuffer.data.viewPos = camera.Position;
+    cameraBuffer.bind();
+    cameraBuffer.upload();
+
+    if (useBatch)
     {
-      model = glm::mat4(1.0f);
-      model = glm::translate(model, objectPositions[i]);
-      model = glm::scale(model, glm::vec3(0.5f));
-      geometryShader.setMat4("model", model);
-      drawMesh(objectGeometry);
+      geometryBatchShader.use();
+      // 纹理单元 0 留给 g_buffer_frag 的 sampler2D
+      objectBatch.bindObjects(geometryBatchShader, 3);
+      objectBatch.draw();
+      gBufferDrawCalls = objectBatch.stats.calls;
+    }
+    else
+    {
+      renderQueue.setView(view);
+      for (unsigned int i = 0; i < objectPositions.size(); i++)
+      {
+        model = glm::mat4(1.0f);
+        model = glm::translate(model, objectPositions[i]);
+        model = glm::scale(model, glm::vec3(0.5f));
+        renderQueue.add(geometryShader, objectGeometry, model);
+      }
+      renderQueue.flush();
+      gBufferDrawCalls = renderQueue.stats.draws;
     }
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     // render
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    sceneShader.use();
+    Shader &lightingShader = uploadMode == 0 ? sceneShader : sceneUniformShader;
+    lightingShader.use();
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, gPosition);
 
@@ -262,21 +382,51 @@ int main(int argc, char *argv[])
     glActiveTexture(GL_TEXTURE2);
     glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
 
-    for (unsigned int i = 0; i < lightPositions.size(); i++)
+    double uploadStart = glfwGetTime();
+    UniformBufferStats::uploads = 0;
+    Shader::locationQueries = 0;
+    if (uploadMode == 0)
     {
-      sceneShader.setVec3("pointLights[" + std::to_string(i) + "].position", lightPositions[i]);
-      sceneShader.setVec3("pointLights[" + std::to_string(i) + "].ambient", 0.01f, 0.01f, 0.01f);
-      sceneShader.setVec3("pointLights[" + std::to_string(i) + "].diffuse", lightColors[i]);
-      sceneShader.setVec3("pointLights[" + std::to_string(i) + "].specular", 1.0f, 1.0f, 1.0f);
-
-      sceneShader.setFloat("pointLights[" + std::to_string(i) + "].linear", 0.09f);
-      sceneShader.setFloat("pointLights[" + std::to_string(i) + "].constant", 1.0f);
-      sceneShader.setFloat("pointLights[" + std::to_string(i) + "].quadratic", 0.032f);
+      // 只上传使用中的光源和数量
+      lightBuffer.bind();
+      lightBuffer.upload(offsetof(LightBlock, pointLights), sizeof(PointLightStd140) * NR_LIGHTS);
+      lightBuffer.upload(offsetof(LightBlock, pointLightCount), sizeof(int));
     }
-    sceneShader.setMat4("view", view);
-    sceneShader.setMat4("projection", projection);
-    model = glm::mat4(1.0f);
-    sceneShader.setMat4("model", model);
+    else if (uploadMode == 1)
+    {
+      for (unsigned int i = 0; i < lightPositions.size(); i++)
+      {
+        lightingShader.setVec3(lightUniforms[i].position, lightPositions[i]);
+        lightingShader.setVec3(lightUniforms[i].ambient, 0.01f, 0.01f, 0.01f);
+        lightingShader.setVec3(lightUniforms[i].diffuse, lightColors[i]);
+        lightingShader.setVec3(lightUniforms[i].specular, 1.0f, 1.0f, 1.0f);
+
+        lightingShader.setFloat(lightUniforms[i].linear, 0.09f);
+        lightingShader.setFloat(lightUniforms[i].constant, 1.0f);
+        lightingShader.setFloat(lightUniforms[i].quadratic, 0.032f);
+      }
+    }
+    else
+    {
+      Shader::useLocationCache = uploadMode == 2;
+      for (unsigned int i = 0; i < lightPositions.size(); i++)
+      {
+        lightingShader.setVec3("pointLights[" + std::to_string(i) + "].position", lightPositions[i]);
+        lightingShader.setVec3("pointLights[" + std::to_string(i) + "].ambient", 0.01f, 0.01f, 0.01f);
+        lightingShader.setVec3("pointLights[" + std::to_string(i) + "].diffuse", lightColors[i]);
+        lightingShader.setVec3("pointLights[" + std::to_string(i) + "].specular", 1.0f, 1.0f, 1.0f);
+
+        lightingShader.setFloat("pointLights[" + std::to_string(i) + "].linear", 0.09f);
+        lightingShader.setFloat("pointLights[" + std::to_string(i) + "].constant", 1.0f);
+        lightingShader.setFloat("pointLights[" + std::to_string(i) + "].quadratic", 0.032f);
+      }
+      Shader::useLocationCache = true;
+    }
+    uploadTime = glfwGetTime() - uploadStart;
+    bufferUploads = UniformBufferStats::uploads;
+    uploadQueries = Shader::locationQueries;
+
+    lightingShader.setMat4("model", glm::mat4(1.0f));
     drawMesh(quadGeometry);
 
     // 延迟结合正向渲染
@@ -289,8 +439,6 @@ int main(int argc, char *argv[])
     // 绘制灯光物体
     // ************************************************************
     lightShader.use();
-    lightShader.setMat4("view", view);
-    lightShader.setMat4("projection", projection);
 
     for (unsigned int i = 0; i < lightPositions.size(); i++)
     {
@@ -304,6 +452,8 @@ int main(int argc, char *argv[])
     }
     // ************************************************************
 
+    frameAllocations = AllocCounter::allocations;
+
     // 渲染 gui
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -312,21 +462,22 @@ int main(int argc, char *argv[])
     glfwPollEvents();
   }
 
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
 }
 
 // 绘制物体
-void drawMesh(BufferGeometry geometry)
+void drawMesh(GeometryView geometry)
 {
   glBindVertexArray(geometry.VAO);
-  glDrawElements(GL_TRIANGLES, geometry.indices.size(), GL_UNSIGNED_INT, 0);
+  glDrawElementsBaseVertex(GL_TRIANGLES, geometry.count, geometry.indexType, geometry.indexOffset(), geometry.baseVertex);
   glBindVertexArray(0);
 }
 
 // 绘制灯光物体
-void drawLightObject(Shader shader, BufferGeometry geometry, glm::vec3 position)
+void drawLightObject(Shader &shader, GeometryView geometry, glm::vec3 position)
 {
   glm::mat4 view = camera.GetViewMatrix();
   glm::mat4 projection = glm::mat4(1.0f);
@@ -9,17 +9,17 @@ out VS_OUT {
   vec2 TexCoords;
 } vs_out;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "camera_block.glsl"
+#include "static_batch.glsl"
 
 void main() {
+  mat4 modelMatrix = objectModel();
 
-  gl_Position = projection * view * model * vec4(Position, 1.0f);
+  gl_Position = camera.projection * camera.view * modelMatrix * vec4(Position, 1.0f);
 
-  vs_out.FragPos = vec3(model * vec4(Position, 1.0));
+  vs_out.FragPos = vec3(modelMatrix * vec4(Position, 1.0));
 
   vs_out.TexCoords = TexCoords;
   // 解决不等比缩放，对法向量产生的影响
-  vs_out.Normal = mat3(transpose(inverse(model))) * Normal;
+  vs_out.Normal = mat3(transpose(inverse(modelMatrix))) * Normal;
 }
\ No newline at end of file
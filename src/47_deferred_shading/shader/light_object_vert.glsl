@@ -4,11 +4,11 @@ layout(location = 1) in vec3 Normal;
 layout(location = 2) in vec2 TexCoords;
 out vec2 outTexCoord;
 
+#include "camera_block.glsl"
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main() {
-  gl_Position = projection * view * model * vec4(Position, 1.0f);
+  gl_Position = camera.projection * camera.view * model * vec4(Position, 1.0f);
   outTexCoord = TexCoords;
 }
\ No newline at end of file
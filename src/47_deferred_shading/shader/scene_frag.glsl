@@ -1,22 +1,15 @@
 #version 330 core
 out vec4 FragColor;
 
-// 点光源
-struct PointLight {
-  vec3 position;
-
-  float constant;
-  float linear;
-  float quadratic;
-
-  vec3 ambient;
-  vec3 diffuse;
-  vec3 specular;
-};
-
-#define NR_POINT_LIGHTS 12
-
+// 光源与相机数据来自 uniform 块，每帧只更新一次缓冲
+#include "light.glsl"
+#include "camera_block.glsl"
+#ifdef LIGHT_UNIFORMS
+// 对比用：光源逐个设置为普通 uniform
 uniform PointLight pointLights[NR_POINT_LIGHTS];
+#else
+#include "light_block.glsl"
+#endif
 
 uniform sampler2D gPosition; // 贴图
 uniform sampler2D gNormal; // 贴图
@@ -28,10 +21,6 @@ in VS_OUT {
   vec2 TexCoords;
 } fs_in;
 
-uniform vec3 viewPos;
-
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-
 void main() {
 
   vec3 FragPos = texture(gPosition, fs_in.TexCoords).rgb;
@@ -39,34 +28,18 @@ void main() {
   vec3 Diffuse = texture(gAlbedoSpec, fs_in.TexCoords).rgb;
   float Specular = texture(gAlbedoSpec, fs_in.TexCoords).a;
 
-  vec3 viewDir = normalize(viewPos - FragPos);
+  vec3 viewDir = normalize(camera.viewPos - FragPos);
 
   vec3 result = vec3(0.0f);
   // 点光源
+#ifdef LIGHT_UNIFORMS
   for(int i = 0; i < NR_POINT_LIGHTS; i++) {
     result += CalcPointLight(pointLights[i], Normal, FragPos, viewDir);
   }
+#else
+  for(int i = 0; i < lights.pointLightCount; i++) {
+    result += CalcPointLight(lights.pointLights[i], Normal, FragPos, viewDir);
+  }
+#endif
   FragColor = vec4(result, 1.0);
-}
-
-// 计算点光源
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
-  vec3 lightDir = normalize(light.position - fragPos);
-    // 漫反射着色
-  float diff = max(dot(normal, lightDir), 0.0);
-    // 镜面光着色
-  vec3 reflectDir = reflect(-lightDir, normal);
-  float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
-    // 衰减
-  float distance = length(light.position - fragPos);
-  float attenuation = 1.0 / (light.constant + light.linear * distance +
-    light.quadratic * (distance * distance));    
-    // 合并结果
-  vec3 ambient = light.ambient;
-  vec3 diffuse = light.diffuse * diff;
-  vec3 specular = light.specular * spec;
-  ambient *= attenuation;
-  diffuse *= attenuation;
-  specular *= attenuation;
-  return (ambient + diffuse + specular);
 }
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include <map>
 
 #include <tool/shader.h>
+#include <tool/shader_library.h>
+#include <tool/gl_state.h>
 #include <tool/camera.h>
 #include <geometry/BoxGeometry.h>
 #include <geometry/PlaneGeometry.h>
@@ -13,6 +15,10 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <tool/stb_image.h>
 
+// 统计渲染循环中的堆分配次数
+#define ALLOC_COUNTER_IMPLEMENTATION
+#include <tool/alloc_counter.h>
+
 #include <tool/gui.h>
 #include <tool/mesh.h>
 #include <tool/model.h>
@@ -24,8 +30,8 @@ void processInput(GLFWwindow *window);
 unsigned int loadTexture(char const *path);
 
 // method
-void drawMesh(BufferGeometry geometry);
-void drawLightObject(Shader shader, BufferGeometry geometry, glm::vec3 position);
+void drawMesh(GeometryView geometry);
+void drawLightObject(Shader &shader, GeometryView geometry, glm::vec3 position);
 
 std::string Shader::dirName;
 
@@ -120,12 +126,24 @@ int main(int argc, char *argv[])
   // 3.将鼠标隐藏
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-  Shader gbufferShader("./shader/ssao_geometry_vert.glsl", "./shader/ssao_geometry_frag.glsl");
-  Shader finalShader("./shader/ssao_vert.glsl", "./shader/ssao_lighting_frag.glsl");
-  Shader ssaoShader("./shader/ssao_vert.glsl", "./shader/ssao_lighting_frag.glsl");
-  Shader ssaoBlurShader("./shader/ssao_vert.glsl", "./shader/ssao_frag.glsl");
-
-  Shader lightObjShader("./shader/light_object_vert.glsl", "./shader/light_object_frag.glsl");
+  // 一次性提交所有着色器，驱动并行编译；未完成前渲染循环使用 lightObj 作为替代
+  ShaderLibrary shaders;
+  shaders.add("lightObj", "./shader/light_object_vert.glsl", "./shader/light_object_frag.glsl");
+  shaders.add("gbuffer", "./shader/ssao_geometry_vert.glsl", "./shader/ssao_geometry_frag.glsl");
+  shaders.add("final", "./shader/ssao_vert.glsl", "./shader/ssao_lighting_frag.glsl", nullptr, [](Shader &shader)
+              {
+                shader.setInt("gPosition", 0);
+                shader.setInt("gNormal", 1);
+                shader.setInt("gAlbedo", 2);
+                shader.setInt("ssao", 3); });
+  shaders.add("ssao", "./shader/ssao_vert.glsl", "./shader/ssao_lighting_frag.glsl", nullptr, [](Shader &shader)
+              {
+                shader.setInt("gPosition", 0);
+                shader.setInt("gNormal", 1);
+                shader.setInt("texNoise", 2); });
+  shaders.add("ssaoBlur", "./shader/ssao_vert.glsl", "./shader/ssao_frag.glsl", nullptr, [](Shader &shader)
+              { shader.setInt("ssapInput", 0); });
+  shaders.setFallback("lightObj");
 
   PlaneGeometry groundGeometry(10.0, 10.0);            // 地面
   PlaneGeometry grassGeometry(1.0, 1.0);               // 草丛
@@ -254,26 +272,20 @@ int main(int argc, char *argv[])
   glm::vec3 lightPos = glm::vec3(2.0, 4.0, 2.0);
   glm::vec3 lightColor = glm::vec3(0.2, 0.8, 0.7);
 
-  // 设置shader
-  // -----------------
-  finalShader.use();
-  finalShader.setInt("gPosition", 0);
-  finalShader.setInt("gNormal", 1);
-  finalShader.setInt("gAlbedo", 2);
-  finalShader.setInt("ssao", 3);
-
-  ssaoShader.use();
-  ssaoShader.setInt("gPosition", 0);
-  ssaoShader.setInt("gNormal", 1);
-  ssaoShader.setInt("texNoise", 2);
+  Model modelObject("./static/model/teapot/teapot.obj");
 
-  ssaoBlurShader.use();
-  ssaoBlurShader.setInt("ssapInput", 0);
+  // 渲染循环中的绑定都经过 GLState，重复的状态切换直接跳过
+  GLState::enabled = true;
+  GLState::invalidate();
+  bool stateTracking = GLState::enabled;
+  unsigned long stateIssued = 0;
+  unsigned long stateElided = 0;
 
-  Model modelObject("./static/model/teapot/teapot.obj");
+  unsigned long frameAllocations = 0;
 
   while (!glfwWindowShouldClose(window))
   {
+    AllocCounter::reset();
     processInput(window);
 
     float currentFrame = glfwGetTime();
@@ -285,22 +297,43 @@ int main(int argc, char *argv[])
     int fps_value = (int)round(ImGui::GetIO().Framerate);
     int ms_value = (int)round(1000.0f / ImGui::GetIO().Framerate);
 
-    std::string FPS = std::to_string(fps_value);
-    std::string ms = std::to_string(ms_value);
-    std::string newTitle = "LearnOpenGL - " + ms + " ms/frame " + FPS;
-    glfwSetWindowTitle(window, newTitle.c_str());
+    // 写入栈上的缓冲，避免每帧拼接字符串分配内存
+    char newTitle[64];
+    snprintf(newTitle, sizeof(newTitle), "LearnOpenGL - %d ms/frame %d", ms_value, fps_value);
+    glfwSetWindowTitle(window, newTitle);
 
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
+
+    // 上一帧的状态切换统计
+    ImGui::Begin("gl state");
+    ImGui::Text("heap allocations: %lu/frame", frameAllocations);
+    if (ImGui::Checkbox("skip redundant calls", &stateTracking))
+    {
+      GLState::enabled = stateTracking;
+      GLState::invalidate();
+    }
+    ImGui::Text("issued: %lu/frame", stateIssued);
+    ImGui::Text("elided: %lu/frame", stateElided);
+    ImGui::End();
+    GLState::resetCounters();
     // *************************************************************************
 
+    // 取出本帧使用的着色器（编译完成前为替代着色器）
+    shaders.poll();
+    Shader &gbufferShader = shaders.get("gbuffer");
+    Shader &ssaoShader = shaders.get("ssao");
+    Shader &ssaoBlurShader = shaders.get("ssaoBlur");
+    Shader &finalShader = shaders.get("final");
+    Shader &lightObjShader = shaders.get("lightObj");
+
     // 渲染指令
     // ...
     glClearColor(25.0 / 255.0, 25.0 / 255.0, 25.0 / 255.0, 1.0);
 
     // 1.将场景的position depth normal 渲染到gbuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, gBuffer);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
@@ -321,11 +354,11 @@ int main(int argc, char *argv[])
     gbufferShader.setMat4("model", model);
     gbufferShader.setInt("invertedNormals", 1); // 在立方体内反转法线
 
-    glCullFace(GL_FRONT);
+    GLState::cullFace(GL_FRONT);
     drawMesh(boxGeometry);
     gbufferShader.setInt("invertedNormals", 0);
 
-    glCullFace(GL_BACK);
+    GLState::cullFace(GL_BACK);
 
     // draw model
     model = glm::mat4(1.0f);
@@ -341,36 +374,32 @@ int main(int argc, char *argv[])
     model = glm::scale(model, glm::vec3(0.015f));
     gbufferShader.setMat4("model", model);
     modelObject.Draw(gbufferShader);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
 
     // 2. 生成SSAO 贴图
     // ---------------
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
     glClear(GL_COLOR_BUFFER_BIT);
     ssaoShader.use();
     // Send kernel + rotation
     for (unsigned int i = 0; i < 64; ++i)
       ssaoShader.setVec3("samples[" + std::to_string(i) + "]", ssaoKernel[i]);
     ssaoShader.setMat4("projection", projection);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, gPosition);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, gNormal);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, noiseTexture);
+    GLState::bindTexture(0, GL_TEXTURE_2D, gPosition);
+    GLState::bindTexture(1, GL_TEXTURE_2D, gNormal);
+    GLState::bindTexture(2, GL_TEXTURE_2D, noiseTexture);
 
     drawMesh(quadGeometry);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
 
     // 3. blur SSAO texture to remove noise
     // ------------------------------------
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
     glClear(GL_COLOR_BUFFER_BIT);
     ssaoBlurShader.use();
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
+    GLState::bindTexture(0, GL_TEXTURE_2D, ssaoColorBuffer);
     drawMesh(quadGeometry);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
 
     // 4. lighting pass: traditional deferred Blinn-Phong lighting with added screen-space ambient occlusion
     // -----------------------------------------------------------------------------------------------------
@@ -393,23 +422,19 @@ int main(int argc, char *argv[])
     const float quadratic = 0.032;
     finalShader.setFloat("light.Linear", linear);
     finalShader.setFloat("light.Quadratic", quadratic);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, gPosition);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, gNormal);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, gColorSpec);
-    glActiveTexture(GL_TEXTURE3); // add extra SSAO texture to lighting pass
-    glBindTexture(GL_TEXTURE_2D, ssaoColorBufferBler);
+    GLState::bindTexture(0, GL_TEXTURE_2D, gPosition);
+    GLState::bindTexture(1, GL_TEXTURE_2D, gNormal);
+    GLState::bindTexture(2, GL_TEXTURE_2D, gColorSpec);
+    GLState::bindTexture(3, GL_TEXTURE_2D, ssaoColorBufferBler); // add extra SSAO texture to lighting pass
     drawMesh(quadGeometry);
 
     // 绘制灯光物体
     // 延迟结合正向渲染
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0); // 指定默认的帧缓冲为写缓冲
+    GLState::bindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer);
+    GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0); // 指定默认的帧缓冲为写缓冲
     // 复制gbuffer的深度信息到默认帧缓冲的深度缓冲
     glBlitFramebuffer(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
 
     lightObjShader.use();
     lightObjShader.setMat4("view", view);
@@ -423,6 +448,11 @@ int main(int argc, char *argv[])
 
     drawMesh(pointLightGeometry);
 
+    stateIssued = GLState::issued;
+    stateElided = GLState::elided;
+
+    frameAllocations = AllocCounter::allocations;
+
     // 渲染 gui
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -431,21 +461,22 @@ int main(int argc, char *argv[])
     glfwPollEvents();
   }
 
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
 }
 
 // 绘制物体
-void drawMesh(BufferGeometry geometry)
+void drawMesh(GeometryView geometry)
 {
-  glBindVertexArray(geometry.VAO);
-  glDrawElements(GL_TRIANGLES, geometry.indices.size(), GL_UNSIGNED_INT, 0);
-  glBindVertexArray(0);
+  GLState::bindVertexArray(geometry.VAO);
+  glDrawElementsBaseVertex(GL_TRIANGLES, geometry.count, geometry.indexType, geometry.indexOffset(), geometry.baseVertex);
+  GLState::unbindVertexArray();
 }
 
 // 绘制灯光物体
-void drawLightObject(Shader shader, BufferGeometry geometry, glm::vec3 position)
+void drawLightObject(Shader &shader, GeometryView geometry, glm::vec3 position)
 {
   glm::mat4 view = camera.GetViewMatrix();
   glm::mat4 projection = glm::mat4(1.0f);
@@ -16,6 +16,7 @@
 #include <tool/gui.h>
 #include <tool/mesh.h>
 #include <tool/model.h>
+#include <tool/static_batch.h>
 
 #include <random>
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
@@ -24,8 +25,8 @@ void processInput(GLFWwindow *window);
 unsigned int loadTexture(char const *path);
 
 // method
-void drawMesh(BufferGeometry geometry);
-void drawLightObject(Shader shader, BufferGeometry geometry, glm::vec3 position);
+void drawMesh(GeometryView geometry);
+void drawLightObject(Shader &shader, GeometryView geometry, glm::vec3 position);
 
 std::string Shader::dirName;
 
@@ -118,8 +119,11 @@ int main(int argc, char *argv[])
   // 3.将鼠标隐藏
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-  Shader sceneShader("./shader/scene_vert.glsl", "./shader/scene_texture_frag.glsl");
+  // 逐个物体设置 model 绘制的着色器，和以 StaticBatch::defines() 编译、从批次中读取模型矩阵和材质参数的版本
+  Shader sceneShader("./shader/scene_vert.glsl", "./shader/scene_frag.glsl");
   Shader sceneTextureShader("./shader/scene_vert.glsl", "./shader/scene_texture_frag.glsl");
+  Shader batchShader("./shader/scene_vert.glsl", "./shader/scene_frag.glsl", nullptr, StaticBatch::defines());
+  Shader batchTextureShader("./shader/scene_vert.glsl", "./shader/scene_texture_frag.glsl", nullptr, StaticBatch::defines());
   Shader lightObjShader("./shader/light_object_vert.glsl", "./shader/light_object_frag.glsl");
 
   PlaneGeometry groundGeometry(10.0, 10.0);            // 地面
@@ -147,9 +151,37 @@ int main(int argc, char *argv[])
   int nrColumns = 7;
   float spacing = 2.5;
 
-  sceneShader.use();
-  sceneShader.setVec3("albedo", 0.0f, 0.5f, 0.0f);
-  sceneShader.setFloat("ao", 1.0f);
+  // 每一行金属度递增，每一列粗糙度递增
+  auto sphereModel = [&](int row, int col)
+  {
+    return glm::translate(glm::mat4(1.0f), glm::vec3((col - (nrColumns / 2)) * spacing, (row - (nrRows / 2)) * spacing, 0.0f));
+  };
+  auto sphereMetallic = [&](int row)
+  {
+    return (float)row / (float)nrRows;
+  };
+  auto sphereRoughness = [&](int col)
+  {
+    return glm::clamp((float)col / (float)nrColumns, 0.05f, 1.0f);
+  };
+
+  // 圆球不会移动，模型矩阵和材质参数只在这里写入批次一次，之后每帧一次调用绘制全部圆球
+  StaticBatch sphereBatch;
+  for (int row = 0; row < nrRows; ++row)
+    for (int col = 0; col < nrColumns; ++col)
+      sphereBatch.add(objectGeometry, sphereModel(row, col), glm::vec4(sphereMetallic(row), sphereRoughness(col), 0.0f, 0.0f));
+  sphereBatch.build();
+  bool useBatch = true;
+  bool textured = true;
+  unsigned int sphereDrawCalls = 0;
+
+  Shader *sceneShaders[] = {&sceneShader, &sceneTextureShader, &batchShader, &batchTextureShader};
+  for (Shader *shader : sceneShaders)
+  {
+    shader->use();
+    shader->setVec3("albedo", 0.0f, 0.5f, 0.0f);
+    shader->setFloat("ao", 1.0f);
+  }
 
   // unsigned int albedoMap = loadTexture("./static/texture/solar/TexturesCom_PaintedConcreteFloor_1K_albedo.png");
   // unsigned int normalMap = loadTexture("./static/texture/solar/TexturesCom_PaintedConcreteFloor_1K_normal.png");
@@ -164,11 +196,15 @@ int main(int argc, char *argv[])
   unsigned int aoMap = 0;
 
   // 设置贴图
-  sceneShader.setInt("albedoMap", 0);
-  sceneShader.setInt("normalMap", 1);
-  sceneShader.setInt("metallicMap", 2);
-  sceneShader.setInt("roughnessMap", 3);
-  sceneShader.setInt("aoMap", 4);
+  for (Shader *shader : sceneShaders)
+  {
+    shader->use();
+    shader->setInt("albedoMap", 0);
+    shader->setInt("normalMap", 1);
+    shader->setInt("metallicMap", 2);
+    shader->setInt("roughnessMap", 3);
+    shader->setInt("aoMap", 4);
+  }
 
   while (!glfwWindowShouldClose(window))
   {
@@ -191,6 +227,13 @@ int main(int argc, char *argv[])
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
+
+    ImGui::Begin("static batch");
+    ImGui::Checkbox("static batch", &useBatch);
+    ImGui::Checkbox("textured", &textured);
+    ImGui::Text("%s: %u spheres, %u draw calls", sphereBatch.path() == StaticBatch::MULTI_DRAW_INDIRECT ? "multi draw indirect" : "instanced",
+                sphereBatch.stats.objects, sphereDrawCalls);
+    ImGui::End();
     // *************************************************************************
 
     glClearColor(25.0 / 255.0, 25.0 / 255.0, 25.0 / 255.0, 1.0);
@@ -207,18 +250,19 @@ int main(int argc, char *argv[])
     lightPositions[1].x = camX;
     lightPositions[1].y = camZ;
 
+    Shader &shader = useBatch ? (textured ? batchTextureShader : batchShader) : (textured ? sceneTextureShader : sceneShader);
+    shader.use();
     for (unsigned int i = 0; i < lightPositions.size(); i++)
     {
       glm::vec3 newPos = lightPositions[i] + glm::vec3(sin(glfwGetTime() * 5.0) * 15.0, 0.0, 0.0);
       newPos = lightPositions[i];
-      sceneShader.use();
-      sceneShader.setVec3("lightPositions[" + std::to_string(i) + "]", newPos);
-      sceneShader.setVec3("lightColors[" + std::to_string(i) + "]", lightColors[i]);
+      shader.setVec3("lightPositions[" + std::to_string(i) + "]", newPos);
+      shader.setVec3("lightColors[" + std::to_string(i) + "]", lightColors[i]);
     }
 
-    sceneShader.setMat4("projection", projection);
-    sceneShader.setMat4("view", view);
-    sceneShader.setVec3("camPos", camera.Position);
+    shader.setMat4("projection", projection);
+    shader.setMat4("view", view);
+    shader.setVec3("camPos", camera.Position);
 
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, albedoMap);
@@ -231,20 +275,28 @@ int main(int argc, char *argv[])
     glActiveTexture(GL_TEXTURE4);
     glBindTexture(GL_TEXTURE_2D, aoMap);
 
-    for (int row = 0; row < nrRows; ++row)
+    if (useBatch)
     {
-      sceneShader.setFloat("metallic", (float)row / (float)nrRows);
-      for (int col = 0; col < nrColumns; ++col)
+      // 纹理单元 0~4 是材质贴图
+      sphereBatch.bindObjects(shader, 5);
+      sphereBatch.draw();
+      sphereDrawCalls = sphereBatch.stats.calls;
+    }
+    else
+    {
+      for (int row = 0; row < nrRows; ++row)
       {
-
-        sceneShader.setFloat("roughness", glm::clamp((float)col / (float)nrColumns, 0.05f, 1.0f));
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3((col - (nrColumns / 2)) * spacing, (row - (nrRows / 2)) * spacing, 0.0f));
-        sceneShader.setMat4("model", model);
-
-        // ........render
-        drawMesh(objectGeometry);
+        shader.setFloat("metallic", sphereMetallic(row));
+        for (int col = 0; col < nrColumns; ++col)
+        {
+          shader.setFloat("roughness", sphereRoughness(col));
+          shader.setMat4("model", sphereModel(row, col));
+
+          // ........render
+          drawMesh(objectGeometry);
+        }
       }
+      sphereDrawCalls = nrRows * nrColumns;
     }
 
     // 绘制灯光物体
@@ -274,21 +326,22 @@ int main(int argc, char *argv[])
     glfwPollEvents();
   }
 
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
 }
 
 // 绘制物体
-void drawMesh(BufferGeometry geometry)
+void drawMesh(GeometryView geometry)
 {
   glBindVertexArray(geometry.VAO);
-  glDrawElements(GL_TRIANGLES, geometry.indices.size(), GL_UNSIGNED_INT, 0);
+  glDrawElementsBaseVertex(GL_TRIANGLES, geometry.count, geometry.indexType, geometry.indexOffset(), geometry.baseVertex);
   glBindVertexArray(0);
 }
 
 // 绘制灯光物体
-void drawLightObject(Shader shader, BufferGeometry geometry, glm::vec3 position)
+void drawLightObject(Shader &shader, GeometryView geometry, glm::vec3 position)
 {
   glm::mat4 view = camera.GetViewMatrix();
   glm::mat4 projection = glm::mat4(1.0f);
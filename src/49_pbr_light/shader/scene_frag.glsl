@@ -6,8 +6,13 @@ in vec3 Normal;
 
 // material parameters
 uniform vec3 albedo;
+#ifdef STATIC_BATCH
+// 每个物体的参数来自 StaticBatch：x 金属度，y 粗糙度
+flat in vec4 MaterialParams;
+#else
 uniform float metallic;
 uniform float roughness;
+#endif
 uniform float ao;
 
 // lights
@@ -55,6 +60,10 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0) {
 }
 // ----------------------------------------------------------------------------
 void main() {
+#ifdef STATIC_BATCH
+  float metallic = MaterialParams.x;
+  float roughness = MaterialParams.y;
+#endif
   vec3 N = normalize(Normal);
   vec3 V = normalize(camPos - WorldPos);
 
@@ -6,18 +6,26 @@ layout(location = 2) in vec2 aTexCoords;
 out vec2 TexCoords;
 out vec3 WorldPos;
 out vec3 Normal;
+#ifdef STATIC_BATCH
+flat out vec4 MaterialParams; // x 金属度，y 粗糙度
+#endif
+
+#include "static_batch.glsl"
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
 void main() {
+  mat4 modelMatrix = objectModel();
+#ifdef STATIC_BATCH
+  MaterialParams = objectParams();
+#endif
 
   TexCoords = aTexCoords;
-  WorldPos = vec3(model * vec4(aPos, 1.0f));
+  WorldPos = vec3(modelMatrix * vec4(aPos, 1.0f));
 
    // 解决不等比缩放，对法向量产生的影响
-  Normal = mat3(transpose(inverse(model))) * aNormal;
+  Normal = mat3(transpose(inverse(modelMatrix))) * aNormal;
 
   gl_Position = projection * view * vec4(WorldPos, 1.0f);
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <map>
 
 #include <tool/shader.h>
+#include <tool/shader_library.h>
 #include <tool/camera.h>
 #include <geometry/BoxGeometry.h>
 #include <geometry/PlaneGeometry.h>
@@ -25,8 +26,8 @@ unsigned int loadTexture(char const *path);
 unsigned int loadHdrTexture(char const *path);
 
 // method
-void drawMesh(BufferGeometry geometry);
-void drawLightObject(Shader shader, BufferGeometry geometry, glm::vec3 position);
+void drawMesh(GeometryView geometry);
+void drawLightObject(Shader &shader, GeometryView geometry, glm::vec3 position);
 
 std::string Shader::dirName;
 
@@ -122,16 +123,30 @@ int main(int argc, char *argv[])
   // 3.将鼠标隐藏
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-  Shader sceneShader("./shader/scene_vert.glsl", "./shader/scene_frag.glsl");
-  Shader lightObjShader("./shader/light_object_vert.glsl", "./shader/light_object_frag.glsl");
-  Shader cubemapShader("./shader/cubemap_vert.glsl", "./shader/cubemap_frag.glsl");
-  Shader envmapShader("./shader/envmap_vert.glsl", "./shader/envmap_frag.glsl");
-  Shader irradianceShader("./shader/irradiance_vert.glsl", "./shader/irradiance_frag.glsl");
-
-  Shader prefilterShader("./shader/prefilter_vert.glsl", "./shader/prefilter_frag.glsl");
-  Shader brdfShader("./shader/brdf_vert.glsl", "./shader/brdf_frag.glsl");
-
-  Shader testBrdfShader("./shader/test_brdf_vert.glsl", "./shader/test_brdf_frag.glsl");
+  // 先提交全部着色器让驱动并行编译，再逐个等待，启动耗时取决于最慢的着色器
+  ShaderLibrary shaders;
+  shaders.add("scene", "./shader/scene_vert.glsl", "./shader/scene_frag.glsl");
+  shaders.add("lightObj", "./shader/light_object_vert.glsl", "./shader/light_object_frag.glsl");
+  shaders.add("cubemap", "./shader/cubemap_vert.glsl", "./shader/cubemap_frag.glsl");
+  shaders.add("envmap", "./shader/envmap_vert.glsl", "./shader/envmap_frag.glsl");
+  shaders.add("irradiance", "./shader/irradiance_vert.glsl", "./shader/irradiance_frag.glsl");
+  shaders.add("prefilter", "./shader/prefilter_vert.glsl", "./shader/prefilter_frag.glsl");
+  shaders.add("brdf", "./shader/brdf_vert.glsl", "./shader/brdf_frag.glsl");
+  shaders.add("testBrdf", "./shader/test_brdf_vert.glsl", "./shader/test_brdf_frag.glsl");
+
+  Shader &sceneShader = shaders.wait("scene");
+  Shader &lightObjShader = shaders.wait("lightObj");
+  Shader &cubemapShader = shaders.wait("cubemap");
+  Shader &envmapShader = shaders.wait("envmap");
+  Shader &irradianceShader = shaders.wait("irradiance");
+
+  Shader &prefilterShader = shaders.wait("prefilter");
+  Shader &brdfShader = shaders.wait("brdf");
+  shaders.waitAll();
+
+  // 着色器启动耗时（冷启动需要编译，热启动从 output/shader_cache 读取程序二进制）
+  std::cout << "shader programs: " << Shader::programsFromCache << " from cache, " << Shader::programsCompiled
+            << " compiled, " << Shader::buildSeconds * 1000.0 << " ms" << std::endl;
 
   PlaneGeometry quadGeometry(2.0, 2.0);                // 屏幕四边形
   BoxGeometry boxGeometry(5.0, 5.0, 5.0);              // 盒子
@@ -445,6 +460,7 @@ int main(int argc, char *argv[])
     // -------------------
 
     // 测试预计算 BRDF 纹理
+    // Shader &testBrdfShader = shaders.get("testBrdf");
     // testBrdfShader.use();
     // testBrdfShader.setInt("brdfTexture", 0);
     // glActiveTexture(GL_TEXTURE0);
@@ -478,21 +494,22 @@ int main(int argc, char *argv[])
     glfwPollEvents();
   }
 
+  GLState::contextDestroyed();
   glfwTerminate();
 
   return 0;
 }
 
 // 绘制物体
-void drawMesh(BufferGeometry geometry)
+void drawMesh(GeometryView geometry)
 {
   glBindVertexArray(geometry.VAO);
-  glDrawElements(GL_TRIANGLES, geometry.indices.size(), GL_UNSIGNED_INT, 0);
+  glDrawElementsBaseVertex(GL_TRIANGLES, geometry.count, geometry.indexType, geometry.indexOffset(), geometry.baseVertex);
   glBindVertexArray(0);
 }
 
 // 绘制灯光物体
-void drawLightObject(Shader shader, BufferGeometry geometry, glm::vec3 position)
+void drawLightObject(Shader &shader, GeometryView geometry, glm::vec3 position)
 {
   glm::mat4 view = camera.GetViewMatrix();
   glm::mat4 projection = glm::mat4(1.0f);
@@ -0,0 +1,98 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <filesystem>
+
+#include <tool/shader.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <tool/stb_image.h>
+
+#include <tool/mesh.h>
+#include <tool/model.h>
+
+std::string Shader::dirName;
+
+// 对比模型加载耗时：Assimp 导入（逐个 / 线程池并行转换网格） vs 从二进制网格缓存映射
+// 用法：make dir=53 后在仓库根目录运行，结果输出到控制台
+
+// 每种方式重复加载的次数，取最快的一次
+const int RUNS = 5;
+
+struct LoadTime
+{
+  double geometry = 1e30; // 导入/映射 + 上传缓冲
+  double texture = 1e30;  // 解码 + 上传纹理，两种方式相同
+};
+
+LoadTime measure(const std::string &path, bool useCache, bool parallel)
+{
+  MeshCache::enabled = useCache;
+  Model::parallelImport = parallel;
+  LoadTime best;
+  for (int i = 0; i < RUNS; i++)
+  {
+    Model model(path);
+    if (useCache && !model.loadedFromCache)
+      std::cout << "ERROR::MESH_CACHE::NOT_USED " << path << std::endl;
+    best.geometry = std::min(best.geometry, model.geometryMilliseconds);
+    best.texture = std::min(best.texture, model.textureMilliseconds);
+    // 模型析构时释放纹理引用，缓存随之删除纹理，下一次加载重新解码
+  }
+  return best;
+}
+
+int main(int argc, char *argv[])
+{
+  Shader::dirName = argc > 1 ? argv[1] : "";
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // 只需要上传缓冲用的上下文，不显示窗口
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+  GLFWwindow *window = glfwCreateWindow(64, 64, "LearnOpenGL", NULL, NULL);
+  if (window == NULL)
+  {
+    std::cout << "Failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    return -1;
+  }
+  glfwMakeContextCurrent(window);
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+  {
+    std::cout << "Failed to initialize GLAD" << std::endl;
+    return -1;
+  }
+
+  const char *paths[] = {"./static/model/nanosuit/nanosuit.obj", "./static/model/cerberus/Cerberus.obj"};
+  for (const char *path : paths)
+  {
+    // 第一次启用缓存的加载负责写入缓存文件
+    std::error_code error;
+    std::filesystem::remove(MeshCache::cachePath(path), error);
+    MeshCache::enabled = true;
+    {
+      Model model(path);
+    }
+
+    LoadTime serial = measure(path, false, false);
+    LoadTime parallel = measure(path, false, true);
+    LoadTime cached = measure(path, true, true);
+    double cacheSize = (double)std::filesystem::file_size(MeshCache::cachePath(path), error) / (1024.0 * 1024.0);
+
+    char line[320];
+    snprintf(line, sizeof(line), "%-16s assimp %8.1f ms   parallel %8.1f ms (%u threads)   cache %7.1f ms   %5.1fx   (textures %.1f ms, cache file %.1f MB)",
+             std::filesystem::path(path).filename().string().c_str(), serial.geometry, parallel.geometry, ThreadPool::shared().size() + 1,
+             cached.geometry, serial.geometry / std::max(cached.geometry, 0.001), cached.texture, cacheSize);
+    std::cout << line << std::endl;
+  }
+
+  GLState::contextDestroyed();
+  glfwTerminate();
+  return 0;
+}
@@ -0,0 +1,198 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <tool/stb_image.h>
+
+#include <tool/thread_pool.h>
+#include <tool/mipmap.h>
+#include <tool/block_compression.h>
+#include <tool/dds.h>
+
+// 离线纹理压缩：把图片连同 mip 链编码成 BCn 块压缩格式，写到同名的 .dds 文件（与图片同目录）
+// TextureCache 加载图片时发现更新的 .dds 就直接用 glCompressedTexImage2D 上传，不再解码、生成 mipmap
+// 用法：make dir=54 后在仓库根目录运行 ./output/main src/54_texture_compress/ [--bc7] [--kaiser] [图片...]
+//   不给图片时压缩下面的默认列表；--bc7 让颜色贴图使用 BC7（更清晰，体积是 BC1 的两倍）
+//   --kaiser 用 Kaiser 窗口 sinc 生成 mip 链（更锐利），默认是 2x2 盒式滤波
+// 格式选择：法线贴图 -> BC5（只存 xy，着色器里重建 z），单通道 -> BC4，带透明 -> BC3，其余 -> BC1
+// 每张图输出压缩前后的显存占用，并用驱动解码第 0 层与原图比较（PSNR）
+
+const char *defaultPaths[] = {
+    "./static/texture/TexturesCom_MuddySand2_2x2_2K_albedo.png",
+    "./static/texture/TexturesCom_MuddySand2_2x2_2K_normal.png",
+    "./static/texture/TexturesCom_MuddySand2_2x2_2K_height.png",
+    "./static/model/cerberus/Cerberus_A.jpg",
+    "./static/model/cerberus/Cerberus_N.jpg",
+    "./static/model/cerberus/Cerberus_M.jpg",
+    "./static/model/cerberus/Cerberus_R.jpg",
+    "./static/model/nanosuit/body_dif.png",
+    "./static/model/nanosuit/body_showroom_ddn.png",
+    "./static/model/nanosuit/body_showroom_spec.png",
+    "./static/texture/tiles/TexturesCom_Marble_TilesSquare8_512_albedo.png",
+    "./static/texture/tiles/TexturesCom_Marble_TilesSquare8_512_normal.png"};
+
+const char *formatNames[] = {"BC1", "BC3", "BC4", "BC5", "BC7", "RGBA8"};
+
+bool contains(const std::string &name, const char *part)
+{
+  return name.find(part) != std::string::npos;
+}
+
+// 按文件名和通道判断贴图用途
+TextureKind classify(const std::string &path)
+{
+  std::string name = std::filesystem::path(path).stem().string();
+  std::string lower = name;
+  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+  if (contains(lower, "normal") || contains(lower, "_ddn") || contains(lower, "_nrm") || contains(name, "_N"))
+    return TEXTURE_NORMAL;
+  if (contains(lower, "albedo") || contains(lower, "diff") || contains(lower, "_dif") || contains(name, "_A") || contains(lower, "color"))
+    return TEXTURE_COLOR;
+  return TEXTURE_DATA;
+}
+
+BlockFormat chooseFormat(TextureKind kind, int channels, bool hasAlpha, bool useBC7)
+{
+  if (kind == TEXTURE_NORMAL)
+    return BLOCK_BC5;
+  if (channels == 1)
+    return BLOCK_BC4;
+  if (useBC7)
+    return BLOCK_BC7;
+  return hasAlpha ? BLOCK_BC3 : BLOCK_BC1;
+}
+
+// 第 0 层解码结果与原图的峰值信噪比，只比较格式保存的通道
+double psnr(const unsigned char *source, const unsigned char *decoded, size_t pixels, BlockFormat format)
+{
+  int channels = format == BLOCK_BC4 ? 1 : (format == BLOCK_BC5 ? 2 : (format == BLOCK_BC1 ? 3 : 4));
+  double error = 0.0;
+  for (size_t i = 0; i < pixels; i++)
+    for (int c = 0; c < channels; c++)
+    {
+      double difference = (double)source[i * 4 + c] - decoded[i * 4 + c];
+      error += difference * difference;
+    }
+  error /= (double)pixels * channels;
+  return error > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / error) : 99.0;
+}
+
+int main(int argc, char *argv[])
+{
+  std::vector<std::string> paths;
+  bool useBC7 = false;
+  MipFilter mipFilter = MIP_BOX;
+  for (int i = 2; i < argc; i++)
+  {
+    if (std::string(argv[i]) == "--bc7")
+      useBC7 = true;
+    else if (std::string(argv[i]) == "--kaiser")
+      mipFilter = MIP_KAISER;
+    else
+      paths.push_back(argv[i]);
+  }
+  if (paths.empty())
+    paths.assign(std::begin(defaultPaths), std::end(defaultPaths));
+
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // 只用来检查压缩结果，不显示窗口
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+  GLFWwindow *window = glfwCreateWindow(64, 64, "LearnOpenGL", NULL, NULL);
+  if (window == NULL)
+  {
+    std::cout << "Failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    return -1;
+  }
+  glfwMakeContextCurrent(window);
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+  {
+    std::cout << "Failed to initialize GLAD" << std::endl;
+    return -1;
+  }
+
+  double totalSource = 0.0, totalCompressed = 0.0;
+  for (const std::string &path : paths)
+  {
+    int width, height, channels;
+    unsigned char *pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+    if (pixels == nullptr)
+    {
+      std::cout << "Texture failed to load at path: " << path << std::endl;
+      continue;
+    }
+    bool hasAlpha = false;
+    for (size_t i = 0; channels == 4 && i < (size_t)width * height && !hasAlpha; i++)
+      hasAlpha = pixels[i * 4 + 3] < 255;
+
+    TextureKind kind = classify(path);
+    BlockFormat format = chooseFormat(kind, channels, hasAlpha, useBC7);
+
+    // 生成 mip 链并逐层编码
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<MipLevel> mips = MipChain::build(pixels, width, height, kind, &ThreadPool::shared(), mipFilter);
+    std::vector<std::vector<unsigned char>> levels;
+    for (const MipLevel &mip : mips)
+      levels.push_back(BlockEncoder::encode(format, mip.pixels.data(), mip.width, mip.height, &ThreadPool::shared()));
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::filesystem::path target = std::filesystem::path(path).replace_extension(".dds");
+    if (!DdsFile::save(target.string(), format, width, height, levels))
+    {
+      std::cout << "ERROR::DDS::WRITE_FAILED " << target.string() << std::endl;
+      stbi_image_free(pixels);
+      continue;
+    }
+
+    // 读回 .dds，让驱动解码第 0 层
+    DdsFile file;
+    double quality = 0.0;
+    if (file.open(target.string()))
+    {
+      GLuint texture = file.upload();
+      if (texture != 0)
+      {
+        std::vector<unsigned char> decoded((size_t)width * height * 4);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, decoded.data());
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glDeleteTextures(1, &texture);
+        quality = psnr(pixels, decoded.data(), (size_t)width * height, format);
+      }
+      else
+        std::cout << "ERROR::DDS::FORMAT_NOT_SUPPORTED " << formatNames[format] << std::endl;
+    }
+    stbi_image_free(pixels);
+
+    // 未压缩时按 RGBA8 加 mip 链计算显存
+    double sourceSize = (double)width * height * 4.0 * 4.0 / 3.0 / (1024.0 * 1024.0);
+    double compressedSize = (double)file.dataSize() / (1024.0 * 1024.0);
+    totalSource += sourceSize;
+    totalCompressed += compressedSize;
+
+    char line[320];
+    snprintf(line, sizeof(line), "%-48s %4dx%-4d %s  %6.2f MB -> %5.2f MB (%4.1fx)  PSNR %5.1f dB  %7.1f ms",
+             std::filesystem::path(path).filename().string().c_str(), width, height, formatNames[format], sourceSize, compressedSize,
+             sourceSize / std::max(compressedSize, 1e-6), quality, milliseconds);
+    std::cout << line << std::endl;
+  }
+  if (totalCompressed > 0.0)
+    std::cout << "total " << totalSource << " MB -> " << totalCompressed << " MB" << std::endl;
+
+  GLState::contextDestroyed();
+  glfwTerminate();
+  return 0;
+}
@@ -0,0 +1,143 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <tool/stb_image.h>
+
+#include <tool/texture_streamer.h>
+
+// 测量 static/texture 下所有图片的加载耗时和进程内存峰值（解码 + 生成 mip 链 + 上传）
+// 用法：make dir=55 后在仓库根目录运行 ./output/main src/55_texture_loading/ [--stdio] [--no-pool] [--mip-cache]
+//   默认：源文件 mmap 后 stbi_load_from_memory 解码，像素放进可复用的暂存内存（StagingPool）
+//   --stdio      用 stbi_load 按文件读取
+//   --no-pool    暂存内存用完立即释放，每张图重新分配
+//   --mip-cache  允许使用 output/texture_cache 里的 mip 缓存（默认关闭，只测解码）
+// 内存峰值是整个进程的最大值，对比不同方式需要分别运行
+
+// 整个图片集加载的轮数，第一轮之后暂存内存已经分配好
+const int ROUNDS = 3;
+
+// 进程驻留内存的峰值，MB
+double peakResidentMB()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    return 0.0;
+  return (double)counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return (double)usage.ru_maxrss / (1024.0 * 1024.0); // 字节
+#else
+  return (double)usage.ru_maxrss / 1024.0; // KB
+#endif
+#endif
+}
+
+std::vector<std::string> findImages(const std::string &root)
+{
+  std::vector<std::string> paths;
+  std::error_code error;
+  for (std::filesystem::recursive_directory_iterator it(root, error), end; it != end; it.increment(error))
+  {
+    std::string extension = it->path().extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp")
+      paths.push_back(it->path().string());
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+int main(int argc, char *argv[])
+{
+  bool useMipCache = false, pooled = true;
+  for (int i = 2; i < argc; i++)
+  {
+    std::string option = argv[i];
+    if (option == "--stdio")
+      ImageLoader::mapSources = false;
+    else if (option == "--no-pool")
+      pooled = false;
+    else if (option == "--mip-cache")
+      useMipCache = true;
+  }
+  ImageLoader::cacheMips = useMipCache;
+  if (!pooled)
+    StagingPool::shared().setIdleLimit(0);
+
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // 只需要上传纹理用的上下文，不显示窗口
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+  GLFWwindow *window = glfwCreateWindow(64, 64, "LearnOpenGL", NULL, NULL);
+  if (window == NULL)
+  {
+    std::cout << "Failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    return -1;
+  }
+  glfwMakeContextCurrent(window);
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+  {
+    std::cout << "Failed to initialize GLAD" << std::endl;
+    return -1;
+  }
+
+  std::vector<std::string> paths = findImages("./static/texture");
+  std::cout << paths.size() << " images, source " << (ImageLoader::mapSources ? "mmap" : "stdio") << ", staging "
+            << (pooled ? "pooled" : "not pooled") << ", mip cache " << (useMipCache ? "on" : "off") << std::endl;
+  double startMB = peakResidentMB();
+
+  for (int round = 0; round < ROUNDS; round++)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<GLuint> textures;
+    {
+      TextureStreamer streamer;
+      for (const std::string &path : paths)
+      {
+        bool normal = path.find("normal") != std::string::npos;
+        textures.push_back(streamer.request(path, false, false, GL_REPEAT, normal ? TEXTURE_NORMAL : TEXTURE_DATA));
+      }
+      streamer.finish();
+      glFinish();
+    }
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    glDeleteTextures((GLsizei)textures.size(), textures.data());
+
+    StagingPool::Stats staging = StagingPool::shared().stats();
+    char line[256];
+    snprintf(line, sizeof(line), "round %d  %8.1f ms   peak RSS %7.1f MB   staging allocated %3u reused %3u peak %6.1f MB",
+             round, milliseconds, peakResidentMB(), staging.allocated, staging.reused, staging.peakBytes / (1024.0 * 1024.0));
+    std::cout << line << std::endl;
+  }
+  std::cout << "peak RSS before loading " << startMB << " MB" << std::endl;
+
+  GLState::contextDestroyed();
+  glfwTerminate();
+  return 0;
+}
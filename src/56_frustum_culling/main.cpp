@@ -0,0 +1,89 @@
+#include <glad/glad.h>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include <tool/camera.h>
+#include <tool/frustum.h>
+
+// 视锥剔除基准测试：随机分布的包围盒，逐个测试（cullScalar） vs SoA 批量测试（cull，SSE，-mavx 编译时 AVX）
+// 用法：make dir=56 后运行 ./output/main，不需要窗口
+// 每种规模换 8 个相机朝向，输出保留 / 剔除的数量、每次剔除的 CPU 时间和每微秒测试的包围盒数量
+
+// 每个朝向重复的次数，取最快的一次
+const int RUNS = 20;
+
+template <typename Cull>
+double bestMicroseconds(const Cull &cull)
+{
+  double best = 1e30;
+  for (int i = 0; i < RUNS; i++)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    cull();
+    best = std::min(best, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+  }
+  return best;
+}
+
+float random(float low, float high)
+{
+  return low + (high - low) * (float)rand() / (float)RAND_MAX;
+}
+
+int main()
+{
+#if defined(FRUSTUM_AVX)
+  const char *path = "AVX";
+#elif defined(FRUSTUM_SSE)
+  const char *path = "SSE";
+#else
+  const char *path = "scalar";
+#endif
+  std::cout << "batch path: " << path << std::endl;
+
+  srand(1);
+  const size_t counts[] = {1000, 10000, 100000, 1000000};
+  for (size_t count : counts)
+  {
+    // 以原点为中心、边长 200 的立方体内的小包围盒，相机远平面 100
+    CullSet boxes;
+    boxes.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+      glm::vec3 center(random(-100.0f, 100.0f), random(-100.0f, 100.0f), random(-100.0f, 100.0f));
+      glm::vec3 extent(random(0.2f, 2.0f), random(0.2f, 2.0f), random(0.2f, 2.0f));
+      Bounds bounds;
+      bounds.min = center - extent;
+      bounds.max = center + extent;
+      boxes.add(bounds);
+    }
+
+    std::vector<uint32_t> batch, single;
+    double batchTime = 0.0, scalarTime = 0.0;
+    size_t kept = 0;
+    bool same = true;
+    for (int view = 0; view < 8; view++)
+    {
+      Camera camera(glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f), view * 45.0f, view % 2 == 0 ? 0.0f : 30.0f);
+      Frustum frustum = camera.GetFrustum(16.0f / 9.0f);
+      batchTime += bestMicroseconds([&]() { boxes.cull(frustum, batch); });
+      scalarTime += bestMicroseconds([&]() { boxes.cullScalar(frustum, single); });
+      same = same && batch == single;
+      kept += batch.size();
+    }
+    batchTime /= 8.0;
+    scalarTime /= 8.0;
+    kept /= 8;
+
+    char line[256];
+    snprintf(line, sizeof(line), "%8zu boxes  kept %7zu culled %7zu   batch %9.1f us (%6.0f boxes/us)   scalar %9.1f us (%5.0f boxes/us)  %4.1fx  %s",
+             count, kept, count - kept, batchTime, count / std::max(batchTime, 0.001), scalarTime, count / std::max(scalarTime, 0.001),
+             scalarTime / std::max(batchTime, 0.001), same ? "same result" : "ERROR::CULL::MISMATCH");
+    std::cout << line << std::endl;
+  }
+  return 0;
+}
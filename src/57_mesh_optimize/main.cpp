@@ -0,0 +1,237 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <algorithm>
+
+#include <tool/shader.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <tool/stb_image.h>
+
+#include <tool/mesh.h>
+#include <tool/model.h>
+#include <geometry/SphereGeometry.h>
+#include <geometry/BoxGeometry.h>
+
+std::string Shader::dirName;
+
+// 索引缓冲优化报告：static/model 下的每个模型按导入时的顺序加载（不做优化），再对每个网格逐步执行
+//   合并相同顶点 → 顶点缓存重排（Tipsify）→ 过度绘制排序
+// 输出每一步的 ACMR / ATVR（16 项 FIFO 模拟，MeshOptimizer::analyze）和 GPU 上从 8 个方向绘制时的过度绘制
+// （通过深度测试的片段数 / 覆盖的像素数），最后是程序生成的球体和立方体
+// 用法：make dir=57 后在仓库根目录运行 ./output/main src/57_mesh_optimize/
+
+const int TARGET_SIZE = 512;
+
+struct Stage
+{
+  const char *name;
+  std::vector<MeshData> meshes;
+};
+
+struct StageReport
+{
+  double misses = 0.0;
+  double referenced = 0.0;
+  size_t triangles = 0;
+  size_t vertices = 0;
+  double overdraw = 0.0;
+};
+
+// 从包围球外的 8 个方向绘制，返回 通过深度测试的片段 / 覆盖的像素
+double measureOverdraw(std::vector<Mesh> &meshes, const Bounds &bounds, Shader &shader)
+{
+  glm::vec3 center = bounds.center();
+  float radius = glm::length(bounds.extent());
+  glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f, radius * 0.1f, radius * 6.0f);
+  shader.use();
+  shader.setMat4("projection", projection);
+  shader.setMat4("model", glm::mat4(1.0f));
+
+  GLuint query;
+  glGenQueries(1, &query);
+  GLuint shaded = 0, covered = 0;
+  for (int view = 0; view < 8; view++)
+  {
+    float yaw = view * glm::quarter_pi<float>(), pitch = view % 2 == 0 ? 0.3f : -0.3f;
+    glm::vec3 direction(cos(yaw) * cos(pitch), sin(pitch), sin(yaw) * cos(pitch));
+    shader.setMat4("view", glm::lookAt(center + direction * radius * 2.5f, center, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+    // 第一遍：按网格自己的顺序绘制，统计通过深度测试（需要着色）的片段
+    GLuint samples = 0;
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glBeginQuery(GL_SAMPLES_PASSED, query);
+    for (Mesh &mesh : meshes)
+      mesh.Draw(shader);
+    glEndQuery(GL_SAMPLES_PASSED);
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT, &samples);
+    shaded += samples;
+
+    // 第二遍：只有最终可见的片段通过，即覆盖的像素
+    glDepthFunc(GL_EQUAL);
+    glDepthMask(GL_FALSE);
+    glBeginQuery(GL_SAMPLES_PASSED, query);
+    for (Mesh &mesh : meshes)
+      mesh.Draw(shader);
+    glEndQuery(GL_SAMPLES_PASSED);
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT, &samples);
+    covered += samples;
+  }
+  glDepthFunc(GL_LESS);
+  glDepthMask(GL_TRUE);
+  glDeleteQueries(1, &query);
+  return covered > 0 ? (double)shaded / covered : 0.0;
+}
+
+StageReport report(const std::vector<MeshData> &meshes, Shader &shader)
+{
+  StageReport result;
+  std::vector<Mesh> uploaded;
+  Bounds bounds;
+  for (MeshData data : meshes)
+  {
+    data.prepare(VertexFormat());
+    VertexCacheStats stats = MeshOptimizer::analyze(data.indices.data(), data.indices.size(), data.vertices.size());
+    size_t triangles = data.indices.size() / 3;
+    result.misses += stats.acmr * triangles;
+    result.referenced += stats.atvr > 0.0f ? stats.acmr * triangles / stats.atvr : 0.0;
+    result.triangles += triangles;
+    result.vertices += data.vertices.size();
+    bounds.min = uploaded.empty() ? data.bounds.min : glm::min(bounds.min, data.bounds.min);
+    bounds.max = uploaded.empty() ? data.bounds.max : glm::max(bounds.max, data.bounds.max);
+    uploaded.push_back(Mesh(std::move(data), {}));
+  }
+  result.overdraw = measureOverdraw(uploaded, bounds, shader);
+  return result;
+}
+
+void printStages(const std::string &name, const std::vector<Stage> &stages, Shader &shader)
+{
+  std::cout << name << std::endl;
+  for (const Stage &stage : stages)
+  {
+    StageReport result = report(stage.meshes, shader);
+    char line[256];
+    snprintf(line, sizeof(line), "  %-14s %8zu triangles %8zu vertices   ACMR %5.3f   ATVR %5.3f   overdraw %5.3f", stage.name, result.triangles,
+             result.vertices, result.misses / std::max<size_t>(result.triangles, 1), result.misses / std::max(result.referenced, 1.0), result.overdraw);
+    std::cout << line << std::endl;
+  }
+}
+
+// 对每个网格执行 MeshData::optimize(flags) 之后的副本
+std::vector<MeshData> optimized(const std::vector<MeshData> &meshes, unsigned int flags)
+{
+  std::vector<MeshData> result = meshes;
+  for (MeshData &data : result)
+    data.optimize(flags);
+  return result;
+}
+
+std::vector<Stage> stagesOf(const std::vector<MeshData> &source, bool welded)
+{
+  std::vector<Stage> stages;
+  stages.push_back({welded ? "generated" : "imported", source});
+  // 只重排顶点时三角形保持原来的顺序，看到的是合并相同顶点本身的效果
+  if (!welded)
+    stages.push_back({"welded", optimized(source, OPTIMIZE_VERTEX_FETCH)});
+  stages.push_back({"vertex cache", optimized(source, OPTIMIZE_VERTEX_CACHE | OPTIMIZE_VERTEX_FETCH)});
+  stages.push_back({"+ overdraw", optimized(source, OPTIMIZE_VERTEX_CACHE | OPTIMIZE_OVERDRAW | OPTIMIZE_VERTEX_FETCH)});
+  return stages;
+}
+
+template <typename Geometry>
+MeshData meshDataOf(const Geometry &geometry)
+{
+  MeshData data;
+  data.vertices = geometry.vertices;
+  data.indices = geometry.indices;
+  return data;
+}
+
+int main(int argc, char *argv[])
+{
+  Shader::dirName = argc > 1 ? argv[1] : "src/57_mesh_optimize/";
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // 在离屏帧缓冲中绘制，不显示窗口
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+  GLFWwindow *window = glfwCreateWindow(64, 64, "LearnOpenGL", NULL, NULL);
+  if (window == NULL)
+  {
+    std::cout << "Failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    return -1;
+  }
+  glfwMakeContextCurrent(window);
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+  {
+    std::cout << "Failed to initialize GLAD" << std::endl;
+    return -1;
+  }
+
+  GLuint framebuffer, colorBuffer, depthBuffer;
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glGenRenderbuffers(1, &colorBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, TARGET_SIZE, TARGET_SIZE);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+  glGenRenderbuffers(1, &depthBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, TARGET_SIZE, TARGET_SIZE);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+  glViewport(0, 0, TARGET_SIZE, TARGET_SIZE);
+  glEnable(GL_DEPTH_TEST);
+  // 背面剔除之后剩下的才是排序能减少的过度绘制
+  glEnable(GL_CULL_FACE);
+
+  Shader shader("./shader/depth_vert.glsl", "./shader/depth_frag.glsl");
+
+  // 按导入时的顺序读取，不使用缓存（缓存里是优化过的网格）
+  MeshCache::enabled = false;
+  Model::meshOptimization = 0;
+  std::vector<std::filesystem::path> paths;
+  for (const std::filesystem::directory_entry &entry : std::filesystem::recursive_directory_iterator("./static/model"))
+    if (entry.path().extension() == ".obj")
+      paths.push_back(entry.path());
+  std::sort(paths.begin(), paths.end());
+
+  for (const std::filesystem::path &path : paths)
+  {
+    std::vector<MeshData> source;
+    {
+      Model model(path.string());
+      for (const Mesh &mesh : model.meshes)
+      {
+        MeshData data;
+        data.vertices = mesh.vertices;
+        data.indices = mesh.indices;
+        source.push_back(std::move(data));
+      }
+    }
+    printStages(path.filename().string() + " (" + std::to_string(source.size()) + " meshes)", stagesOf(source, false), shader);
+  }
+
+  // 程序生成的几何体按行排列（BufferGeometry::optimizeIndices 默认关闭）
+  SphereGeometry sphere(1.0f, 64.0f, 32.0f);
+  BoxGeometry box(1.0f, 1.0f, 1.0f, 16.0f, 16.0f, 16.0f);
+  printStages("SphereGeometry 64x32", stagesOf({meshDataOf(sphere)}, true), shader);
+  printStages("BoxGeometry 16x16x16", stagesOf({meshDataOf(box)}, true), shader);
+
+  glDeleteRenderbuffers(1, &colorBuffer);
+  glDeleteRenderbuffers(1, &depthBuffer);
+  glDeleteFramebuffers(1, &framebuffer);
+  GLState::contextDestroyed();
+  glfwTerminate();
+  return 0;
+}
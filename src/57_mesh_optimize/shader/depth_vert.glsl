@@ -0,0 +1,10 @@
+#version 330 core
+#include "vertex_format.glsl"
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main() {
+  gl_Position = projection * view * model * vec4(vertexPosition(), 1.0f);
+}
\ No newline at end of file
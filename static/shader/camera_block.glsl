@@ -0,0 +1,8 @@
+// 相机 uniform 块，每帧由程序更新一次，对应 C++ 中的 CameraBlock（tool/uniform_buffer.h）
+// 用法：#include "camera_block.glsl"，之后通过 camera.view / camera.projection / camera.viewPos 访问
+
+layout(std140) uniform CameraBlock {
+  mat4 view;
+  mat4 projection;
+  vec3 viewPos;
+} camera;
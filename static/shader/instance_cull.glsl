@@ -0,0 +1,24 @@
+// InstanceCuller（tool/instance_culler.h）的剔除和 LOD 选择，计算着色器和变换反馈两条路径共用
+// 每个实例一个世界空间包围球（xyz 球心，w 半径）：先和视锥的 6 个平面比较，再按球面到相机的距离选 LOD
+// MAX_CULL_LODS 与 C++ 中的 InstanceCuller::MAX_LODS 一致
+
+#define MAX_CULL_LODS 8
+
+uniform vec4 frustumPlanes[6]; // 指向视锥内部，已归一化
+uniform vec3 cullCameraPos;
+uniform int lodCount;
+uniform float lodDistances[MAX_CULL_LODS]; // 每级 LOD 使用到的距离，超出最后一级的实例不绘制
+
+// 返回 LOD 编号，被剔除时返回 -1
+int cullInstance(vec4 sphere) {
+  for (int i = 0; i < 6; i++) {
+    if (dot(frustumPlanes[i].xyz, sphere.xyz) + frustumPlanes[i].w < -sphere.w)
+      return -1;
+  }
+  float distance = max(length(sphere.xyz - cullCameraPos) - sphere.w, 0.0);
+  for (int lod = 0; lod < lodCount; lod++) {
+    if (distance < lodDistances[lod])
+      return lod;
+  }
+  return -1;
+}
@@ -0,0 +1,13 @@
+// InstanceCuller（tool/instance_culler.h）绘制时的实例数据
+// 每个实例只有一个编号（location 8，剔除时写入），模型矩阵按编号从纹理缓冲中读取，每个矩阵 4 个 RGBA32F 纹素
+// location 3~7 留给切线等顶点属性
+
+layout(location = 8) in uint instanceIndex;
+
+uniform samplerBuffer instanceMatrices;
+
+mat4 instanceMatrix() {
+  int base = int(instanceIndex) * 4;
+  return mat4(texelFetch(instanceMatrices, base), texelFetch(instanceMatrices, base + 1),
+              texelFetch(instanceMatrices, base + 2), texelFetch(instanceMatrices, base + 3));
+}
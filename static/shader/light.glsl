@@ -0,0 +1,114 @@
+// 公共光照模块：光源结构体与 Phong 光照计算
+// 用法：#include "light.glsl"
+// 带材质的版本用贴图颜色和高光指数，不带的按白色材质、高光指数 32 计算
+
+// 定向光
+struct DirectionLight {
+  vec3 direction;
+
+  vec3 ambient;
+  vec3 diffuse;
+  vec3 specular;
+};
+
+// 点光源
+struct PointLight {
+  vec3 position;
+
+  float constant;
+  float linear;
+  float quadratic;
+
+  vec3 ambient;
+  vec3 diffuse;
+  vec3 specular;
+};
+
+// 聚光灯
+struct SpotLight {
+  vec3 position;
+  vec3 direction;
+  float cutOff;
+  float outerCutOff;
+
+  float constant;
+  float linear;
+  float quadratic;
+
+  vec3 ambient;
+  vec3 diffuse;
+  vec3 specular;
+};
+
+// 计算定向光
+vec3 CalcDirectionLight(DirectionLight light, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, float shininess) {
+  vec3 lightDir = normalize(light.direction);
+  float diff = max(dot(normal, lightDir), 0.0);
+  vec3 reflectDir = reflect(-lightDir, normal);
+  float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+
+  // 合并
+  vec3 ambient = light.ambient * diffuseColor;
+  vec3 diffuse = light.diffuse * diff * diffuseColor;
+  vec3 specular = light.specular * spec * specularColor;
+
+  return ambient + diffuse + specular;
+}
+
+vec3 CalcDirectionLight(DirectionLight light, vec3 normal, vec3 viewDir) {
+  return CalcDirectionLight(light, normal, viewDir, vec3(1.0), vec3(1.0), 32.0);
+}
+
+// 计算点光源
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, float shininess) {
+  vec3 lightDir = normalize(light.position - fragPos);
+    // 漫反射着色
+  float diff = max(dot(normal, lightDir), 0.0);
+    // 镜面光着色
+  vec3 reflectDir = reflect(-lightDir, normal);
+  float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+    // 衰减
+  float distance = length(light.position - fragPos);
+  float attenuation = 1.0 / (light.constant + light.linear * distance +
+    light.quadratic * (distance * distance));
+    // 合并结果
+  vec3 ambient = light.ambient * diffuseColor;
+  vec3 diffuse = light.diffuse * diff * diffuseColor;
+  vec3 specular = light.specular * spec * specularColor;
+  ambient *= attenuation;
+  diffuse *= attenuation;
+  specular *= attenuation;
+  return (ambient + diffuse + specular);
+}
+
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
+  return CalcPointLight(light, normal, fragPos, viewDir, vec3(1.0), vec3(1.0), 32.0);
+}
+
+// 计算聚光灯
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, float shininess) {
+  vec3 lightDir = normalize(light.position - fragPos);
+  float diff = max(dot(normal, lightDir), 0.0);
+  vec3 reflectDir = reflect(-lightDir, normal);
+  float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+
+  float distance = length(light.position - fragPos);
+  float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+  float theta = dot(lightDir, normalize(-light.direction));
+  float epsilon = light.cutOff - light.outerCutOff;
+  float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+
+  vec3 ambient = light.ambient * diffuseColor;
+  vec3 diffuse = light.diffuse * diff * diffuseColor;
+  vec3 specular = light.specular * spec * specularColor;
+
+  ambient *= attenuation * intensity;
+  diffuse *= attenuation * intensity;
+  specular *= attenuation * intensity;
+  return (ambient + diffuse + specular);
+}
+
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
+  return CalcSpotLight(light, normal, fragPos, viewDir, vec3(1.0), vec3(1.0), 32.0);
+}
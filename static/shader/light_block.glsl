@@ -0,0 +1,14 @@
+// 光源 uniform 块，对应 C++ 中的 LightBlock（tool/uniform_buffer.h）
+// 用法：#include "light_block.glsl"，之后通过 lights.pointLights[i] 等访问
+
+#include "light.glsl"
+
+// 需要与 C++ 中的 MAX_POINT_LIGHTS 一致
+#define MAX_POINT_LIGHTS 32
+
+layout(std140) uniform LightBlock {
+  DirectionLight dirLight;
+  SpotLight spotLight;
+  PointLight pointLights[MAX_POINT_LIGHTS];
+  int pointLightCount; // 实际使用的点光源数量
+} lights;
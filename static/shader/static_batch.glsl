@@ -0,0 +1,27 @@
+// 物体的模型矩阵，对应 C++ 中的 StaticBatch（tool/static_batch.h）
+// 用法：#include "static_batch.glsl"，之后通过 objectModel() 取模型矩阵，不再自己声明 model
+//   以 StaticBatch::defines() 编译时（STATIC_BATCH）：每个实例一个物体编号（location 9），模型矩阵和材质参数
+//   从纹理缓冲中读取，每个物体 5 个 RGBA32F 纹素，参数通过 objectParams() 访问
+//   否则模型矩阵仍是 uniform model，逐个物体绘制时照常设置
+
+#ifdef STATIC_BATCH
+layout(location = 9) in uint batchObject;
+
+uniform samplerBuffer batchObjects;
+
+mat4 objectModel() {
+  int base = int(batchObject) * 5;
+  return mat4(texelFetch(batchObjects, base), texelFetch(batchObjects, base + 1),
+              texelFetch(batchObjects, base + 2), texelFetch(batchObjects, base + 3));
+}
+
+vec4 objectParams() {
+  return texelFetch(batchObjects, int(batchObject) * 5 + 4);
+}
+#else
+uniform mat4 model;
+
+mat4 objectModel() {
+  return model;
+}
+#endif
\ No newline at end of file
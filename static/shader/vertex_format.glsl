@@ -0,0 +1,71 @@
+// Mesh 的顶点属性，对应 C++ 中的 VertexFormat（tool/vertex_format.h）
+// 用法：以 format.defines() 编译着色器，#include "vertex_format.glsl"，
+// 之后通过 vertexPosition() / vertexNormal() / TexCoords 访问，不再自己声明 location 0~2
+// 需要切线时先 #define VERTEX_TANGENTS（location 3、4 被占用，不能再用于实例化属性）
+//   VERTEX_QUANTIZED_POSITION  位置为 16 位定点数，按包围盒还原
+//   VERTEX_OCTAHEDRAL          法线、切线为八面体编码，副切线由叉积和符号重建
+
+layout(location = 0) in vec3 Position;
+#ifdef VERTEX_OCTAHEDRAL
+layout(location = 1) in vec2 Normal;
+#else
+layout(location = 1) in vec3 Normal;
+#endif
+layout(location = 2) in vec2 TexCoords;
+
+#ifdef VERTEX_TANGENTS
+#ifdef VERTEX_OCTAHEDRAL
+layout(location = 3) in vec3 Tangent; // xy 为八面体坐标，z 为副切线的符号
+#else
+layout(location = 3) in vec3 Tangent;
+layout(location = 4) in vec3 Bitangent;
+#endif
+#endif
+
+#ifdef VERTEX_QUANTIZED_POSITION
+// 由 Mesh 在绘制前设置：包围盒最小点和尺寸
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+#endif
+
+vec3 octDecode(vec2 p) {
+  vec3 n = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
+vec3 vertexPosition() {
+#ifdef VERTEX_QUANTIZED_POSITION
+  return positionOffset + Position * positionScale;
+#else
+  return Position;
+#endif
+}
+
+vec3 vertexNormal() {
+#ifdef VERTEX_OCTAHEDRAL
+  return octDecode(Normal);
+#else
+  return Normal;
+#endif
+}
+
+#ifdef VERTEX_TANGENTS
+vec3 vertexTangent() {
+#ifdef VERTEX_OCTAHEDRAL
+  return octDecode(Tangent.xy);
+#else
+  return Tangent;
+#endif
+}
+
+vec3 vertexBitangent() {
+#ifdef VERTEX_OCTAHEDRAL
+  return cross(vertexNormal(), vertexTangent()) * (Tangent.z < 0.0 ? -1.0 : 1.0);
+#else
+  return Bitangent;
+#endif
+}
+#endif